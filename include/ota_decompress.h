@@ -0,0 +1,228 @@
+#ifndef OTA_DECOMPRESS_H
+#define OTA_DECOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ota_sink.h"
+
+// Compressed firmware images.
+//
+// A compressed image starts with a 12-byte "OTAZ" prefix (integers
+// little-endian) so the device knows the format and the size to hand to
+// Update.begin() before the first byte is decoded:
+//
+//   "OTAZ", format u8, window_bits u8, lookahead_bits u8, reserved u8 (0),
+//   size u32 (uncompressed image size)
+//
+// followed by the compressed stream:
+//
+//   format 1  zlib (RFC 1950) deflate stream, 32 KB window
+//   format 2  heatshrink LZSS stream with the given window/lookahead bits
+//
+// tools/ota_tool writes both. Images served without the prefix are still
+// accepted: "Content-Encoding: deflate" / "gzip" (or a gzip magic) selects
+// inflate with the size unknown up front, anything else is taken as a raw
+// image. The heatshrink decoder below is portable so the host tool can
+// check its output; inflate uses the miniz copy in the ESP32 ROM.
+
+#ifndef OTA_HEATSHRINK_MAX_WINDOW_BITS
+#define OTA_HEATSHRINK_MAX_WINDOW_BITS 12
+#endif
+
+static const size_t kOtaCompressedHeaderSize = 12;
+
+enum OtaCompression
+{
+    OTA_COMPRESSION_NONE = 0,
+    OTA_COMPRESSION_DEFLATE = 1,   // zlib wrapper
+    OTA_COMPRESSION_HEATSHRINK = 2,
+    OTA_COMPRESSION_GZIP = 3       // Content-Encoding / magic only, never in a prefix
+};
+
+struct OtaCompressedHeader
+{
+    uint8_t format;         // OtaCompression
+    uint8_t window_bits;    // heatshrink only
+    uint8_t lookahead_bits; // heatshrink only
+    uint32_t size;          // uncompressed size, 0 if unknown
+};
+
+inline bool ota_parse_compressed_header(const uint8_t *data, OtaCompressedHeader &header)
+{
+    if (memcmp(data, "OTAZ", 4) != 0 || data[7] != 0 ||
+        (data[4] != OTA_COMPRESSION_DEFLATE && data[4] != OTA_COMPRESSION_HEATSHRINK))
+    {
+        return false;
+    }
+    header.format = data[4];
+    header.window_bits = data[5];
+    header.lookahead_bits = data[6];
+    header.size = (uint32_t)data[8] | ((uint32_t)data[9] << 8) |
+                  ((uint32_t)data[10] << 16) | ((uint32_t)data[11] << 24);
+    return true;
+}
+
+inline void ota_write_compressed_header(const OtaCompressedHeader &header, uint8_t *data)
+{
+    memcpy(data, "OTAZ", 4);
+    data[4] = header.format;
+    data[5] = header.window_bits;
+    data[6] = header.lookahead_bits;
+    data[7] = 0;
+    data[8] = header.size;
+    data[9] = header.size >> 8;
+    data[10] = header.size >> 16;
+    data[11] = header.size >> 24;
+}
+
+// Streaming heatshrink decoder. The bit stream is MSB first: a 1 bit is
+// followed by an 8-bit literal, a 0 bit by a window_bits back-reference
+// distance and a lookahead_bits length (both stored minus one). The window
+// doubles as the output buffer: it is handed to the sink each time it
+// wraps, so there is no copy and no allocation per chunk.
+class OtaHeatshrinkDecoder
+{
+public:
+    bool begin(uint8_t windowBits, uint8_t lookaheadBits, const OtaSink &out)
+    {
+        if (windowBits < 4 || windowBits > OTA_HEATSHRINK_MAX_WINDOW_BITS ||
+            lookaheadBits < 3 || lookaheadBits >= windowBits)
+        {
+            return false;
+        }
+        iWindowBits = windowBits;
+        iLookaheadBits = lookaheadBits;
+        iMask = (1u << windowBits) - 1;
+        iOut = out;
+        iState = kTag;
+        iBits = 0;
+        iBitCount = 0;
+        iHead = 0;
+        memset(iWindow, 0, iMask + 1);
+        return true;
+    }
+
+    // Returns false if the sink rejected output.
+    bool feed(const uint8_t *data, size_t len)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            iBits = (iBits << 8) | data[i];
+            iBitCount += 8;
+            while (iBitCount >= need())
+            {
+                uint8_t count = need();
+                iBitCount -= count;
+                uint32_t v = (iBits >> iBitCount) & ((1u << count) - 1);
+                switch (iState)
+                {
+                case kTag:
+                    iState = v ? kLiteral : kIndex;
+                    break;
+                case kLiteral:
+                    if (!emit(v))
+                        return false;
+                    iState = kTag;
+                    break;
+                case kIndex:
+                    iDistance = v + 1;
+                    iState = kCount;
+                    break;
+                case kCount:
+                    for (uint32_t n = v + 1; n > 0; n--)
+                    {
+                        if (!emit(iWindow[(iHead - iDistance) & iMask]))
+                            return false;
+                    }
+                    iState = kTag;
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Hands the part of the window not yet written to the sink. The padding
+    // bits of the last byte can never complete an operation.
+    bool finish()
+    {
+        size_t pending = iHead & iMask;
+        return pending == 0 || ota_sink_write(iOut, iWindow, pending);
+    }
+
+    uint32_t produced() const { return iHead; }
+
+private:
+    enum State
+    {
+        kTag,
+        kLiteral,
+        kIndex,
+        kCount
+    };
+
+    uint8_t need() const
+    {
+        switch (iState)
+        {
+        case kTag:
+            return 1;
+        case kLiteral:
+            return 8;
+        case kIndex:
+            return iWindowBits;
+        default:
+            return iLookaheadBits;
+        }
+    }
+
+    bool emit(uint8_t b)
+    {
+        iWindow[iHead & iMask] = b;
+        iHead++;
+        return (iHead & iMask) != 0 || ota_sink_write(iOut, iWindow, iMask + 1);
+    }
+
+    uint8_t iWindowBits;
+    uint8_t iLookaheadBits;
+    uint32_t iMask;
+    OtaSink iOut;
+    State iState;
+    uint32_t iBits;
+    uint8_t iBitCount;
+    uint32_t iDistance;
+    uint32_t iHead; // bytes produced so far
+    uint8_t iWindow[1u << OTA_HEATSHRINK_MAX_WINDOW_BITS];
+};
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Client.h>
+
+#include "ota_pipeline.h"
+
+// Decompression stage for the sink chain. ota_decompress_begin() selects
+// the decoder and the downstream sink; compressed bytes are then pushed
+// into ota_decompress_sink(). The inflate window is a static 32 KB buffer.
+bool ota_decompress_begin(const OtaCompressedHeader &header, const OtaSink &out);
+OtaSink ota_decompress_sink();
+
+// Flushes the decoder. Returns true if the stream ended cleanly and, when
+// the size was known, produced exactly that many bytes.
+bool ota_decompress_end();
+
+// Uncompressed bytes handed downstream so far.
+uint32_t ota_decompress_produced();
+
+// Downloads a `length` byte body from `source` into the inactive OTA slot
+// through Update, decompressing on the writer core if the body carries an
+// OTAZ prefix or `content_encoding` is "deflate"/"gzip". Raw images pass
+// straight through. If `expected_sha256` is given, the decompressed image
+// is hashed as it is written and the update is aborted on a mismatch.
+bool ota_image_download(Client &source, size_t length, const char *content_encoding,
+                        const uint8_t *expected_sha256,
+                        const OtaPipelineConfig &config, OtaPipelineStats *stats);
+#endif
+
+#endif
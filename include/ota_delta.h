@@ -0,0 +1,336 @@
+#ifndef OTA_DELTA_H
+#define OTA_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ota_sink.h"
+
+// Delta (binary diff) OTA patches, format "ODP1".
+//
+// Patches are bsdiff-style and produced by tools/ota_tool. They are applied
+// as a stream: the new image comes out in order while old bytes are read at
+// random from the running app partition, so RAM use is two small buffers no
+// matter how large the images are. This header has no Arduino dependencies;
+// the host tool builds the exact same decoder to verify patches offline.
+//
+// Layout (integers little-endian):
+//
+//   header   "ODP1", old_size u32, old_crc u32, new_size u32, new_crc u32,
+//            flags u32 (0)
+//   records  until new_size bytes have been produced:
+//              varint add_len, varint extra_len, zigzag varint seek
+//              add data:   (varint zero_run, varint literal_count,
+//                           literal_count bytes) repeated until add_len
+//                          bytes are covered; each output byte is
+//                          old[old_pos++] + diff, zero runs copy old bytes
+//              extra data: extra_len bytes copied to the output as is
+//              old_pos += seek
+//
+// Old bytes outside [0, old_size) read as zero, as in bspatch. CRCs are the
+// standard (zlib) CRC32 of the whole old/new image.
+
+#ifndef OTA_DELTA_BUFFER_SIZE
+#define OTA_DELTA_BUFFER_SIZE 512
+#endif
+
+static const size_t kOtaDeltaHeaderSize = 24;
+
+struct OtaDeltaHeader
+{
+    uint32_t old_size;
+    uint32_t old_crc;
+    uint32_t new_size;
+    uint32_t new_crc;
+};
+
+class OtaDeltaDecoder
+{
+public:
+    // Reads `len` bytes of the old image starting at `offset`.
+    typedef bool (*ReadOld)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+
+    enum Result
+    {
+        kMoreData,  // record boundary or mid-record, keep feeding
+        kComplete,  // all new_size bytes produced and flushed
+        kBadPatch,
+        kReadFailed,
+        kWriteFailed
+    };
+
+    static bool parseHeader(const uint8_t *data, OtaDeltaHeader &header)
+    {
+        if (memcmp(data, "ODP1", 4) != 0 || get32(data + 20) != 0)
+        {
+            return false;
+        }
+        header.old_size = get32(data + 4);
+        header.old_crc = get32(data + 8);
+        header.new_size = get32(data + 12);
+        header.new_crc = get32(data + 16);
+        return true;
+    }
+
+    static void writeHeader(const OtaDeltaHeader &header, uint8_t *data)
+    {
+        memcpy(data, "ODP1", 4);
+        put32(data + 4, header.old_size);
+        put32(data + 8, header.old_crc);
+        put32(data + 12, header.new_size);
+        put32(data + 16, header.new_crc);
+        put32(data + 20, 0);
+    }
+
+    void begin(const OtaDeltaHeader &header, ReadOld readOld, void *readCtx, const OtaSink &out)
+    {
+        iHeader = header;
+        iReadOld = readOld;
+        iReadCtx = readCtx;
+        iOut = out;
+        iState = header.new_size ? kCtrlAdd : kDone;
+        iValue = 0;
+        iShift = 0;
+        iOldPos = 0;
+        iProduced = 0;
+        iOutFill = 0;
+        iOldBase = 0;
+        iOldLen = 0;
+        iResult = header.new_size ? kMoreData : kComplete;
+    }
+
+    // Consumes patch bytes following the header.
+    Result feed(const uint8_t *data, size_t len)
+    {
+        while (len > 0 && iResult == kMoreData)
+        {
+            size_t used = 1;
+            switch (iState)
+            {
+            case kLiteral:
+                used = len < iLiteral ? len : iLiteral;
+                for (size_t i = 0; i < used && iResult == kMoreData; i++)
+                {
+                    emit((uint8_t)(oldByte() + data[i]));
+                }
+                iLiteral -= used;
+                iAdd -= used;
+                if (iLiteral == 0)
+                {
+                    iState = iAdd ? kZeroRun : afterAdd();
+                }
+                break;
+            case kExtraData:
+                used = len < iExtra ? len : iExtra;
+                for (size_t i = 0; i < used && iResult == kMoreData; i++)
+                {
+                    emit(data[i]);
+                }
+                iExtra -= used;
+                if (iExtra == 0)
+                {
+                    iState = afterExtra();
+                }
+                break;
+            case kDone:
+                iResult = kBadPatch; // trailing garbage
+                break;
+            default:
+                if (varint(data[0]))
+                {
+                    field(iValue);
+                    iValue = 0;
+                    iShift = 0;
+                }
+                break;
+            }
+            data += used;
+            len -= used;
+        }
+        if (iResult == kMoreData && iState == kDone)
+        {
+            iResult = flush() ? kComplete : kWriteFailed;
+        }
+        return iResult;
+    }
+
+    const OtaDeltaHeader &header() const { return iHeader; }
+    uint32_t produced() const { return iProduced; }
+
+private:
+    enum State
+    {
+        kCtrlAdd,
+        kCtrlExtra,
+        kCtrlSeek,
+        kZeroRun,
+        kLiteralCount,
+        kLiteral,
+        kExtraData,
+        kDone
+    };
+
+    static uint32_t get32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    static void put32(uint8_t *p, uint32_t v)
+    {
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+        p[3] = v >> 24;
+    }
+
+    // Accumulates one LEB128 byte; true once the value is complete
+    bool varint(uint8_t b)
+    {
+        if (iShift > 28)
+        {
+            iResult = kBadPatch;
+            return false;
+        }
+        iValue |= (uint32_t)(b & 0x7f) << iShift;
+        iShift += 7;
+        return !(b & 0x80);
+    }
+
+    void field(uint32_t v)
+    {
+        uint32_t left = iHeader.new_size - iProduced;
+        switch (iState)
+        {
+        case kCtrlAdd:
+            iAdd = v;
+            iState = kCtrlExtra;
+            break;
+        case kCtrlExtra:
+            iExtra = v;
+            iState = kCtrlSeek;
+            break;
+        case kCtrlSeek:
+            iSeek = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+            if (iAdd > left || iExtra > left - iAdd)
+            {
+                iResult = kBadPatch;
+                return;
+            }
+            iState = iAdd ? kZeroRun : afterAdd();
+            break;
+        case kZeroRun:
+            if (v > iAdd)
+            {
+                iResult = kBadPatch;
+                return;
+            }
+            for (uint32_t i = 0; i < v && iResult == kMoreData; i++)
+            {
+                emit(oldByte());
+            }
+            iAdd -= v;
+            iState = kLiteralCount;
+            break;
+        case kLiteralCount:
+            if (v > iAdd)
+            {
+                iResult = kBadPatch;
+                return;
+            }
+            iLiteral = v;
+            iState = v ? kLiteral : iAdd ? kZeroRun : afterAdd();
+            break;
+        default:
+            break;
+        }
+    }
+
+    State afterAdd()
+    {
+        return iExtra ? kExtraData : afterExtra();
+    }
+
+    State afterExtra()
+    {
+        iOldPos += iSeek;
+        return iProduced == iHeader.new_size ? kDone : kCtrlAdd;
+    }
+
+    // Next old byte for an add section (advances old_pos)
+    uint8_t oldByte()
+    {
+        int64_t pos = iOldPos++;
+        if (pos < 0 || pos >= (int64_t)iHeader.old_size)
+        {
+            return 0;
+        }
+        if (pos < iOldBase || pos >= iOldBase + (int64_t)iOldLen)
+        {
+            size_t chunk = sizeof(iOldBuf);
+            if (pos + (int64_t)chunk > (int64_t)iHeader.old_size)
+            {
+                chunk = iHeader.old_size - pos;
+            }
+            if (!iReadOld(iReadCtx, (uint32_t)pos, iOldBuf, chunk))
+            {
+                iResult = kReadFailed;
+                return 0;
+            }
+            iOldBase = pos;
+            iOldLen = chunk;
+        }
+        return iOldBuf[pos - iOldBase];
+    }
+
+    void emit(uint8_t b)
+    {
+        iOutBuf[iOutFill++] = b;
+        iProduced++;
+        if (iOutFill == sizeof(iOutBuf) && !flush())
+        {
+            iResult = kWriteFailed;
+        }
+    }
+
+    bool flush()
+    {
+        bool ok = iOutFill == 0 || ota_sink_write(iOut, iOutBuf, iOutFill);
+        iOutFill = 0;
+        return ok;
+    }
+
+    OtaDeltaHeader iHeader;
+    ReadOld iReadOld;
+    void *iReadCtx;
+    OtaSink iOut;
+    State iState;
+    Result iResult;
+    uint32_t iValue;
+    uint8_t iShift;
+    uint32_t iAdd;
+    uint32_t iExtra;
+    int32_t iSeek;
+    uint32_t iLiteral;
+    int64_t iOldPos;
+    uint32_t iProduced;
+    int64_t iOldBase;
+    size_t iOldLen;
+    size_t iOutFill;
+    uint8_t iOldBuf[OTA_DELTA_BUFFER_SIZE];
+    uint8_t iOutBuf[OTA_DELTA_BUFFER_SIZE];
+};
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Client.h>
+
+#include "ota_pipeline.h"
+
+// Reads a `patch_size` byte ODP1 patch from `source` (positioned at the
+// body), checks that it was made against the running image, and writes the
+// rebuilt image into the inactive OTA slot through Update. Returns false
+// without touching flash if the patch does not match the running firmware.
+bool ota_delta_download(Client &source, size_t patch_size, const OtaPipelineConfig &config);
+#endif
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef OTA_DIGEST_H
+#define OTA_DIGEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ota_sink.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && !defined(OTA_DIGEST_SOFTWARE)
+#include <esp_rom_crc.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/version.h>
+#define OTA_DIGEST_MBEDTLS 1
+#endif
+
+// Integrity checks for OTA payloads.
+//
+// OtaSha256 hashes on the ESP32 SHA accelerator through mbedtls (IDF's
+// mbedtls port drives the hardware engine and quietly falls back to
+// software while another context holds it). Defining OTA_DIGEST_SOFTWARE,
+// or building on the host, selects the portable implementation below
+// instead; tools/bench/digest_bench.cpp measures that one.
+//
+// The expected SHA-256 of the (uncompressed) image comes from an
+// "X-Firmware-SHA256" response header or from a manifest written by
+// tools/ota_tool:
+//
+//   OTA-MANIFEST 1
+//   size <image bytes>
+//   sha256 <64 hex digits>
+//   segment <segment bytes>
+//   crc32 <8 hex digits>     one line per segment, in image order
+//
+// The per-segment CRC32s let the resumable and multi-socket downloads
+// reject a bad segment the moment it completes instead of after the whole
+// image has been written.
+
+#ifndef OTA_MANIFEST_MAX_SEGMENTS
+#define OTA_MANIFEST_MAX_SEGMENTS 64
+#endif
+
+static const size_t kOtaSha256Size = 32;
+
+// zlib-compatible CRC32; pass 0 to start, the previous result to continue
+inline uint32_t ota_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+#if defined(OTA_DIGEST_MBEDTLS)
+    return esp_rom_crc32_le(crc, data, len);
+#else
+    static uint32_t table[256];
+    if (!table[1])
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+#endif
+}
+
+class OtaSha256
+{
+public:
+#if defined(OTA_DIGEST_MBEDTLS)
+    OtaSha256() { mbedtls_sha256_init(&iCtx); }
+    ~OtaSha256() { mbedtls_sha256_free(&iCtx); }
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+    void begin() { mbedtls_sha256_starts(&iCtx, 0); }
+    void update(const uint8_t *data, size_t len) { mbedtls_sha256_update(&iCtx, data, len); }
+    void finish(uint8_t digest[kOtaSha256Size]) { mbedtls_sha256_finish(&iCtx, digest); }
+#else
+    void begin() { mbedtls_sha256_starts_ret(&iCtx, 0); }
+    void update(const uint8_t *data, size_t len) { mbedtls_sha256_update_ret(&iCtx, data, len); }
+    void finish(uint8_t digest[kOtaSha256Size]) { mbedtls_sha256_finish_ret(&iCtx, digest); }
+#endif
+
+private:
+    mbedtls_sha256_context iCtx;
+#else
+    void begin()
+    {
+        static const uint32_t kInit[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                          0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(iState, kInit, sizeof(iState));
+        iLength = 0;
+        iFill = 0;
+    }
+
+    void update(const uint8_t *data, size_t len)
+    {
+        iLength += len;
+        if (iFill)
+        {
+            size_t chunk = len < 64 - iFill ? len : 64 - iFill;
+            memcpy(iBlock + iFill, data, chunk);
+            iFill += chunk;
+            data += chunk;
+            len -= chunk;
+            if (iFill < 64)
+                return;
+            transform(iBlock);
+            iFill = 0;
+        }
+        for (; len >= 64; data += 64, len -= 64)
+            transform(data);
+        memcpy(iBlock, data, len);
+        iFill = len;
+    }
+
+    void finish(uint8_t digest[kOtaSha256Size])
+    {
+        uint64_t bits = iLength * 8;
+        uint8_t pad[72] = {0x80};
+        size_t padLen = (iFill < 56 ? 56 : 120) - iFill;
+        for (int i = 0; i < 8; i++)
+            pad[padLen + i] = bits >> (56 - 8 * i);
+        update(pad, padLen + 8);
+        for (int i = 0; i < 8; i++)
+        {
+            digest[4 * i] = iState[i] >> 24;
+            digest[4 * i + 1] = iState[i] >> 16;
+            digest[4 * i + 2] = iState[i] >> 8;
+            digest[4 * i + 3] = iState[i];
+        }
+    }
+
+private:
+    static uint32_t ror(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void transform(const uint8_t *block)
+    {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 |
+                   (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = iState[0], b = iState[1], c = iState[2], d = iState[3];
+        uint32_t e = iState[4], f = iState[5], g = iState[6], h = iState[7];
+        for (int i = 0; i < 64; i++)
+        {
+            uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        iState[0] += a;
+        iState[1] += b;
+        iState[2] += c;
+        iState[3] += d;
+        iState[4] += e;
+        iState[5] += f;
+        iState[6] += g;
+        iState[7] += h;
+    }
+
+    uint32_t iState[8];
+    uint64_t iLength;
+    size_t iFill;
+    uint8_t iBlock[64];
+#endif
+};
+
+// Hashes everything passing through on its way to `out`.
+class OtaDigestSink
+{
+public:
+    void begin(const OtaSink &out)
+    {
+        iOut = out;
+        iBytes = 0;
+        iSha.begin();
+    }
+
+    OtaSink sink()
+    {
+        OtaSink s = {write, this};
+        return s;
+    }
+
+    void finish(uint8_t digest[kOtaSha256Size]) { iSha.finish(digest); }
+    size_t bytes() const { return iBytes; }
+
+private:
+    static bool write(void *ctx, const uint8_t *data, size_t len)
+    {
+        OtaDigestSink &self = *static_cast<OtaDigestSink *>(ctx);
+        self.iSha.update(data, len);
+        self.iBytes += len;
+        return ota_sink_write(self.iOut, data, len);
+    }
+
+    OtaSink iOut;
+    OtaSha256 iSha;
+    size_t iBytes;
+};
+
+// Parses 64 hex digits (surrounding whitespace allowed).
+inline bool ota_parse_sha256(const char *hex, uint8_t digest[kOtaSha256Size])
+{
+    while (*hex == ' ' || *hex == '\t')
+        hex++;
+    for (size_t i = 0; i < 2 * kOtaSha256Size; i++)
+    {
+        char c = hex[i];
+        int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (v < 0)
+            return false;
+        digest[i / 2] = (i & 1) ? digest[i / 2] | v : v << 4;
+    }
+    char end = hex[2 * kOtaSha256Size];
+    return end == 0 || end == ' ' || end == '\r' || end == '\n';
+}
+
+struct OtaManifest
+{
+    uint32_t size;
+    uint8_t sha256[kOtaSha256Size];
+    bool has_sha256;
+    uint32_t segment_size;
+    uint16_t segments;
+    uint32_t crc[OTA_MANIFEST_MAX_SEGMENTS];
+};
+
+// Feeds one manifest line; call with a zeroed manifest for the first line.
+// Unknown keys are skipped so the format can grow.
+inline bool ota_manifest_parse_line(OtaManifest &manifest, const char *line)
+{
+    const char *value = strchr(line, ' ');
+    if (!value)
+        return line[0] == 0 || line[0] == '\r';
+    size_t key = value - line;
+    value++;
+    if (key == 4 && memcmp(line, "size", 4) == 0)
+        manifest.size = strtoul(value, nullptr, 10);
+    else if (key == 6 && memcmp(line, "sha256", 6) == 0)
+        manifest.has_sha256 = ota_parse_sha256(value, manifest.sha256);
+    else if (key == 7 && memcmp(line, "segment", 7) == 0)
+        manifest.segment_size = strtoul(value, nullptr, 10);
+    else if (key == 5 && memcmp(line, "crc32", 5) == 0)
+    {
+        if (manifest.segments == OTA_MANIFEST_MAX_SEGMENTS)
+            return false;
+        manifest.crc[manifest.segments++] = strtoul(value, nullptr, 16);
+    }
+    return true;
+}
+
+// True if the manifest has a CRC for every `segment_size` piece of the image
+inline bool ota_manifest_has_segments(const OtaManifest &manifest, uint32_t segment_size)
+{
+    return manifest.segment_size == segment_size && segment_size > 0 &&
+           manifest.segments == (manifest.size + segment_size - 1) / segment_size;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_partition.h>
+
+// SHA-256 of the first `len` bytes already written to `partition`.
+bool ota_digest_partition(const esp_partition_t *partition, size_t len,
+                          uint8_t digest[kOtaSha256Size]);
+
+// Prints "SHA-256 mismatch" with both digests and returns false if they differ.
+bool ota_digest_check(const uint8_t *actual, const uint8_t *expected);
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef OTA_FLOW_H
+#define OTA_FLOW_H
+
+#include <Arduino.h>
+
+// Idle handling for the OTA read loops. When the socket is empty a loop
+// calls idle() instead of sleeping a fixed time: it blocks until the modem
+// UART receives something (a "+QIURC: \"recv\"" URC, a poll reply) or a
+// timeout expires. The timeout starts at OTA_FLOW_MIN_WAIT_MS and doubles
+// only while the socket stays idle, up to the loop's configured maximum;
+// any data resets it. With ota_uart_attach() instead (see ota_uart.h) the
+// waits end on its receive callbacks' wakeups. Without either they are plain
+// delay()s with the same backoff.
+
+#ifndef OTA_FLOW_MIN_WAIT_MS
+#define OTA_FLOW_MIN_WAIT_MS 2
+#endif
+
+struct OtaFlowStats
+{
+    uint32_t elapsed_ms;
+    uint32_t idle_ms;   // time spent waiting for data
+    uint32_t waits;
+    uint32_t wakeups;   // waits ended early by UART traffic
+};
+
+// Hooks the modem UART's receive callback. Call once after begin().
+void ota_flow_attach(HardwareSerial &serial);
+
+class OtaFlowControl
+{
+public:
+    void begin(uint32_t maxWaitMs);
+    // The socket delivered data: waits start short again.
+    void data() { iWaitMs = OTA_FLOW_MIN_WAIT_MS; }
+    // The socket is empty: wait for modem traffic or the backoff timeout.
+    void idle();
+    // Closes the measurement window.
+    void end();
+
+    const OtaFlowStats &stats() const { return iStats; }
+
+private:
+    uint32_t iMaxWaitMs;
+    uint32_t iWaitMs;
+    uint32_t iStartMs;
+    OtaFlowStats iStats;
+};
+
+// One line: elapsed, idle/busy split and how waits ended.
+void ota_flow_print_stats(const OtaFlowStats &stats, Print &out);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef OTA_HTTP_H
+#define OTA_HTTP_H
+
+#include <Arduino.h>
+#include <ArduinoHttpClient.h>
+
+#include "ota_digest.h"
+
+// Status line and the response headers the OTA code cares about.
+struct OtaHttpResponse
+{
+    int status;
+    long content_length;  // -1 if the server sent none
+    String etag;
+    String last_modified;
+    String content_range;
+    String content_encoding;
+    String sha256;  // X-Firmware-SHA256, hex
+};
+
+// Sends a GET for `path`, optionally limited by a "Range" header value
+// (e.g. "bytes=4096-"), an "If-Range" validator and an "Accept-Encoding"
+// list, then reads the status line and all headers. The body is left
+// unread. Returns false if the request could not be sent or no status line
+// came back.
+bool ota_http_get(HttpClient &http, const char *path, const char *range,
+                  const char *if_range, OtaHttpResponse &response,
+                  const char *accept_encoding = nullptr);
+
+// Fetches and parses an OTA manifest (see ota_digest.h). Returns false if
+// the server has none or it does not parse.
+bool ota_http_get_manifest(HttpClient &http, const char *path, OtaManifest &manifest);
+
+// Parses a "bytes <first>-<last>/<total>" Content-Range value.
+bool ota_parse_content_range(const String &value, uint32_t *first, uint32_t *total);
+
+#endif
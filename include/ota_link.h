@@ -0,0 +1,397 @@
+#ifndef OTA_LINK_H
+#define OTA_LINK_H
+
+#include <Arduino.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// Modem UART link speed. At 115200 baud the UART, not the radio, caps the
+// download at about 11 kB/s. OtaLink finds the modem at whatever rate it is
+// on, turns on RTS/CTS at both ends (AT+IFC=2,2) and steps the rate down
+// from OTA_LINK_MAX_BAUD with AT+IPR until a rate passes a loopback test:
+// a line of test bytes sent with echo on has to come back byte for byte,
+// a few times over. A rate that fails is left again for the next lower
+// one. The working rate is stored in the modem (AT&W) and, on the ESP32,
+// in NVS, so the next boot opens the UART at that rate and only verifies
+// it.
+//
+// Without RTS/CTS nothing stops the modem while the ESP32 stalls on a
+// flash write, and the 128-byte RX FIFO overflows within a millisecond at
+// the top rates; the link then stays at OTA_LINK_NO_FLOW_MAX_BAUD or
+// below. A link that still loses input later is moved down a rate with
+// OtaLink::stepDown().
+//
+// The negotiation talks plain AT over the Stream and runs before TinyGSM
+// takes the modem, so the host build can drive it against the emulator.
+
+#ifndef OTA_LINK_MAX_BAUD
+#define OTA_LINK_MAX_BAUD 921600
+#endif
+
+#ifndef OTA_LINK_NO_FLOW_MAX_BAUD
+#define OTA_LINK_NO_FLOW_MAX_BAUD 230400 // fastest rate without RTS/CTS
+#endif
+
+#ifndef OTA_LINK_SETTLE_MS
+#define OTA_LINK_SETTLE_MS 100 // modem and UART settle after a rate change
+#endif
+
+#ifndef OTA_LINK_LOOPBACK_ROUNDS
+#define OTA_LINK_LOOPBACK_ROUNDS 4
+#endif
+
+// Rates the EC200U's AT+IPR accepts, fastest first
+static const uint32_t kOtaLinkRates[] = {3000000, 1000000, 921600, 460800, 230400, 115200, 57600, 9600};
+static const size_t kOtaLinkRateCount = sizeof(kOtaLinkRates) / sizeof(kOtaLinkRates[0]);
+
+// What the negotiation needs from the local UART
+struct OtaLinkPort
+{
+    Stream *stream;
+    // Switches the UART to `baud` once everything written has gone out
+    void (*set_baud)(void *ctx, uint32_t baud);
+    // RTS/CTS on or off; false if the pins are not wired. May be null.
+    bool (*set_flow_control)(void *ctx, bool on);
+    void *ctx;
+};
+
+struct OtaLinkStats
+{
+    uint32_t baud;        // rate in use, 0 if the modem answered at none
+    bool flow_control;    // RTS/CTS on at both ends
+    bool verified;        // the stored rate passed, nothing was negotiated
+    uint8_t attempts;     // rate changes tried
+    uint8_t fallbacks;    // rates that failed and were left again
+    uint32_t elapsed_ms;
+};
+
+class OtaLink
+{
+public:
+    explicit OtaLink(const OtaLinkPort &port) : iPort(port) { memset(&iStats, 0, sizeof(iStats)); }
+
+    // Checks that the modem answers at `baud` (the rate stored last time)
+    // and passes the loopback test there. On success the link is left as
+    // it is and nothing needs negotiating.
+    bool verify(uint32_t baud)
+    {
+        begin();
+        setBaud(baud);
+        if (!sync())
+        {
+            return finish(0) != 0;
+        }
+        enableFlowControl();
+        if (baud > maxBaud(baud) || !loopback())
+        {
+            return finish(0) != 0;
+        }
+        iStats.verified = true;
+        return finish(baud) != 0;
+    }
+
+    // Finds the modem, trying `current` first, and moves the link to the
+    // fastest rate up to `max_baud` that passes the loopback test. Returns
+    // the rate in use, or 0 if the modem answered at no rate.
+    uint32_t negotiate(uint32_t current, uint32_t max_baud)
+    {
+        begin();
+        uint32_t found = find(current);
+        if (!found)
+        {
+            setBaud(current); // where the modem will be once it is on
+            return finish(0);
+        }
+        current = found;
+        enableFlowControl();
+        max_baud = maxBaud(max_baud);
+
+        for (size_t i = 0; i < kOtaLinkRateCount; i++)
+        {
+            uint32_t rate = kOtaLinkRates[i];
+            if (rate > max_baud)
+            {
+                continue;
+            }
+            if (rate != current)
+            {
+                iStats.attempts++;
+                if (!command("+IPR=", rate))
+                {
+                    continue; // not taken, still at current
+                }
+                setBaud(rate);
+                delay(OTA_LINK_SETTLE_MS);
+            }
+            if (sync() && loopback())
+            {
+                // Keep the rate (and the flow control) over a modem restart
+                if (rate != found || iStats.flow_control)
+                {
+                    command("&W");
+                }
+                return finish(rate);
+            }
+            iStats.fallbacks++;
+            current = recover(rate, current);
+            if (!current)
+            {
+                return finish(0);
+            }
+        }
+        // Nothing passed the test; the modem still answers at current
+        return finish(current);
+    }
+
+    // Moves a link that loses input at `current` to the next lower rate,
+    // not below `min_baud`, that passes the loopback test, and stores it.
+    // Flow control is left as it is. Returns the rate in use, 0 if the
+    // modem was lost.
+    uint32_t stepDown(uint32_t current, uint32_t min_baud)
+    {
+        begin();
+        for (size_t i = 0; i < kOtaLinkRateCount; i++)
+        {
+            uint32_t rate = kOtaLinkRates[i];
+            if (rate >= current || rate < min_baud)
+            {
+                continue;
+            }
+            iStats.attempts++;
+            if (!command("+IPR=", rate))
+            {
+                break; // not taken, still at current
+            }
+            setBaud(rate);
+            delay(OTA_LINK_SETTLE_MS);
+            if (sync() && loopback())
+            {
+                command("&W");
+                return finish(rate);
+            }
+            iStats.fallbacks++;
+            current = find(rate);
+            if (!current)
+            {
+                return finish(0);
+            }
+        }
+        return finish(current);
+    }
+
+    const OtaLinkStats &stats() const { return iStats; }
+
+private:
+    static const uint32_t kSyncTimeoutMs = 200;
+    static const uint8_t kSyncTries = 3;
+    static const uint32_t kCommandTimeoutMs = 1000;
+    static const size_t kLoopbackLen = 96;
+
+    void begin()
+    {
+        memset(&iStats, 0, sizeof(iStats));
+        iStartMs = millis();
+    }
+
+    uint32_t finish(uint32_t baud)
+    {
+        iStats.baud = baud;
+        iStats.elapsed_ms = millis() - iStartMs;
+        return baud;
+    }
+
+    void setBaud(uint32_t baud)
+    {
+        iPort.set_baud(iPort.ctx, baud);
+        drain();
+    }
+
+    void drain()
+    {
+        while (iPort.stream->available() > 0)
+        {
+            iPort.stream->read();
+        }
+    }
+
+    // The modem answers "AT" with OK at the current rate
+    bool sync()
+    {
+        for (uint8_t i = 0; i < kSyncTries; i++)
+        {
+            drain();
+            iPort.stream->print("AT\r\n");
+            if (waitFinal(kSyncTimeoutMs) == 1)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // `baud` first, then every rate the modem may have been left at
+    uint32_t find(uint32_t baud)
+    {
+        setBaud(baud);
+        if (sync())
+        {
+            return baud;
+        }
+        for (size_t i = 0; i < kOtaLinkRateCount; i++)
+        {
+            if (kOtaLinkRates[i] == baud)
+            {
+                continue;
+            }
+            setBaud(kOtaLinkRates[i]);
+            if (sync())
+            {
+                return kOtaLinkRates[i];
+            }
+        }
+        return 0;
+    }
+
+    // `bad` failed the test: ask the modem to go back to `good` (it may
+    // still understand us at `bad`), and look for it if it did not
+    uint32_t recover(uint32_t bad, uint32_t good)
+    {
+        if (bad != good)
+        {
+            command("+IPR=", good);
+            setBaud(good);
+            delay(OTA_LINK_SETTLE_MS);
+        }
+        return find(good);
+    }
+
+    // The highest rate the link may use, given the flow control it has
+    uint32_t maxBaud(uint32_t max_baud) const
+    {
+        if (!iStats.flow_control && max_baud > OTA_LINK_NO_FLOW_MAX_BAUD)
+        {
+            return OTA_LINK_NO_FLOW_MAX_BAUD;
+        }
+        return max_baud;
+    }
+
+    void enableFlowControl()
+    {
+        if (!iPort.set_flow_control || !command("+IFC=2,2"))
+        {
+            return;
+        }
+        iStats.flow_control = iPort.set_flow_control(iPort.ctx, true);
+        if (!iStats.flow_control)
+        {
+            command("+IFC=0,0"); // no RTS/CTS wired on this side
+        }
+    }
+
+    // Echo on, then lines of test bytes that have to come back unchanged.
+    // The modem answers the unknown command with ERROR (the emulator with
+    // OK); either ends the echo.
+    bool loopback()
+    {
+        bool ok = command("E1");
+        for (uint8_t round = 0; ok && round < OTA_LINK_LOOPBACK_ROUNDS; round++)
+        {
+            char line[kLoopbackLen + 8];
+            memcpy(line, "AT+QLB=", 7);
+            for (size_t i = 0; i < kLoopbackLen; i++)
+            {
+                // Letters and digits walk through many bit patterns; the
+                // start moves each round
+                static const char kChars[] = "U5jZ0aK9zq3Mx7Hc1Rw8Ty2Eb4Nv6Gp";
+                line[7 + i] = kChars[(i * 7 + round * 5) % (sizeof(kChars) - 1)];
+            }
+            line[7 + kLoopbackLen] = '\0';
+            drain();
+            iPort.stream->print(line);
+            iPort.stream->print("\r\n");
+            ok = waitFinal(kCommandTimeoutMs) != 0 && strstr(iReply, line) != nullptr;
+        }
+        return command("E0") && ok;
+    }
+
+    bool command(const char *cmd, uint32_t arg)
+    {
+        char text[24];
+        snprintf(text, sizeof(text), "%s%lu", cmd, (unsigned long)arg);
+        return command(text);
+    }
+
+    bool command(const char *cmd)
+    {
+        drain();
+        iPort.stream->print("AT");
+        iPort.stream->print(cmd);
+        iPort.stream->print("\r\n");
+        return waitFinal(kCommandTimeoutMs) == 1;
+    }
+
+    // Collects the reply in iReply until OK (1) or ERROR (2); 0 on timeout
+    int waitFinal(uint32_t timeout_ms)
+    {
+        size_t len = 0;
+        iReply[0] = '\0';
+        for (uint32_t start = millis(); millis() - start < timeout_ms;)
+        {
+            int c = iPort.stream->read();
+            if (c < 0)
+            {
+                delay(1);
+                continue;
+            }
+            if (len + 1 < sizeof(iReply))
+            {
+                iReply[len++] = (char)c;
+                iReply[len] = '\0';
+            }
+            if (c != '\n')
+            {
+                continue;
+            }
+            if (len >= 4 && strcmp(iReply + len - 4, "OK\r\n") == 0)
+            {
+                return 1;
+            }
+            if (len >= 7 && strcmp(iReply + len - 7, "ERROR\r\n") == 0)
+            {
+                return 2;
+            }
+        }
+        return 0;
+    }
+
+    OtaLinkPort iPort;
+    OtaLinkStats iStats;
+    uint32_t iStartMs;
+    char iReply[160];
+};
+
+#if defined(ARDUINO_ARCH_ESP32)
+// The rate stored by the last negotiation, or `fallback` if there is none.
+// Open the modem UART at this rate.
+uint32_t ota_link_saved_baud(uint32_t fallback);
+
+// Verifies the stored rate, or negotiates a new one up to `max_baud` and
+// stores it. `rts_pin`/`cts_pin` are the ESP32 pins wired to the modem's
+// RTS/CTS (-1: not wired, no flow control). Call with the modem on and
+// before TinyGSM talks to it. Returns the rate in use, 0 if the modem did
+// not answer.
+uint32_t ota_link_begin(HardwareSerial &serial, int8_t rts_pin, int8_t cts_pin,
+                        uint32_t max_baud, OtaLinkStats *stats);
+
+// Moves the link set up by ota_link_begin() one rate lower, not below
+// `min_baud`, and stores that rate. For a link that overflowed or garbled
+// input; call while TinyGSM is not using the modem. Returns the rate in
+// use, 0 if the modem did not answer.
+uint32_t ota_link_step_down(uint32_t min_baud, OtaLinkStats *stats);
+
+// One line: rate, flow control, how it was reached.
+void ota_link_print_stats(const OtaLinkStats &stats, Print &out);
+#endif
+
+#endif
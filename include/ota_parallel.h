@@ -0,0 +1,55 @@
+#ifndef OTA_PARALLEL_H
+#define OTA_PARALLEL_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+#include "ota_digest.h"
+#include "ota_pipeline.h"
+
+// Segmented OTA download over several modem sockets at once. The image is
+// split into sector-aligned segments that are handed out to the sockets as
+// a work queue; each socket fetches its segment with a Range request on a
+// keep-alive connection. Because every segment starts on a flash sector,
+// segments are written straight to their final offset in the inactive OTA
+// partition, so they can complete in any order.
+
+#ifndef OTA_PARALLEL_MAX_SOCKETS
+#define OTA_PARALLEL_MAX_SOCKETS 4
+#endif
+
+#ifndef OTA_PARALLEL_SEGMENT_SIZE
+#define OTA_PARALLEL_SEGMENT_SIZE (64 * 1024) // must be a multiple of the 4 KB flash sector
+#endif
+
+struct OtaSocketStats
+{
+    size_t bytes;
+    uint16_t segments;
+    uint32_t active_ms; // first request to last byte
+};
+
+struct OtaParallelStats
+{
+    OtaSocketStats socket[OTA_PARALLEL_MAX_SOCKETS];
+    uint8_t sockets;
+    size_t bytes;
+    uint32_t elapsed_ms;
+    OtaFlowStats flow; // time with every socket empty
+};
+
+// Downloads `path` from host:port through `count` (up to
+// OTA_PARALLEL_MAX_SOCKETS) clients, each bound to its own modem connection.
+// With a `manifest` (may be null) whose segment size matches
+// OTA_PARALLEL_SEGMENT_SIZE, every segment is CRC-checked as it completes
+// and the download stops at the first bad one; its SHA-256 is checked over
+// the written partition before activation. Returns true once the image is
+// complete and selected for the next boot.
+bool ota_parallel_download(Client *const *clients, uint8_t count,
+                           const char *host, uint16_t port, const char *path,
+                           const OtaManifest *manifest,
+                           const OtaPipelineConfig &config, OtaParallelStats *stats);
+
+void ota_parallel_print_stats(const OtaParallelStats &stats, Print &out);
+
+#endif
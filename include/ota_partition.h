@@ -0,0 +1,46 @@
+#ifndef OTA_PARTITION_H
+#define OTA_PARTITION_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+// Writes an app image straight into an OTA partition, one flash sector at a
+// time. Unlike the Update class it can start at any sector-aligned offset
+// and never erases sectors it has not reached yet, which is what lets an
+// interrupted download continue where it stopped.
+class OtaPartitionWriter
+{
+public:
+    static const size_t kSectorSize = 4096;
+
+    // `offset` must be a multiple of kSectorSize; everything below it is
+    // assumed to be already written.
+    bool begin(const esp_partition_t *partition, size_t offset, uint32_t crc = 0);
+    bool write(const uint8_t *data, size_t len);
+    // Writes out a partially filled last sector.
+    bool flush();
+
+    // Bytes committed to flash (sector aligned until flush()).
+    size_t offset() const { return iOffset; }
+    // CRC32 of everything committed to flash.
+    uint32_t crc() const { return iCrc; }
+    const esp_partition_t *partition() const { return iPartition; }
+
+    // Marks the written image as the next boot partition. The bootloader
+    // image checks run here, so a bad image is rejected.
+    bool activate();
+
+    // CRC32 of `len` bytes already in `partition`, starting at `from`.
+    static bool crcOf(const esp_partition_t *partition, size_t len, uint32_t *crc, size_t from = 0);
+
+protected:
+    bool writeSector(size_t len);
+
+    const esp_partition_t *iPartition = nullptr;
+    size_t iOffset = 0;
+    uint32_t iCrc = 0;
+    size_t iFill = 0;
+    uint8_t iSector[kSectorSize];
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef OTA_PIPELINE_H
+#define OTA_PIPELINE_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+#include "ota_flow.h"
+#include "ota_sink.h"
+
+// Pipelined OTA download: a reader task pulls the HTTP body from the modem
+// into a small pool of buffers while a writer task on the other core drains
+// them into flash, so network reads keep going during erase/write cycles.
+
+#ifndef OTA_PIPELINE_BUFFER_COUNT
+#define OTA_PIPELINE_BUFFER_COUNT 4
+#endif
+
+#ifndef OTA_PIPELINE_BUFFER_SIZE
+#define OTA_PIPELINE_BUFFER_SIZE 4096
+#endif
+
+#ifndef OTA_PIPELINE_READER_CORE
+#define OTA_PIPELINE_READER_CORE 1
+#endif
+
+#ifndef OTA_PIPELINE_WRITER_CORE
+#define OTA_PIPELINE_WRITER_CORE 0
+#endif
+
+enum OtaPipelineError
+{
+    OTA_PIPELINE_OK = 0,
+    OTA_PIPELINE_NO_RESOURCES,  // queue or task creation failed
+    OTA_PIPELINE_NETWORK_TIMEOUT,
+    OTA_PIPELINE_DISCONNECTED,
+    OTA_PIPELINE_WRITE_FAILED,
+    OTA_PIPELINE_ABORTED        // ota_pipeline_abort() was called
+};
+
+struct OtaPipelineConfig
+{
+    uint32_t network_timeout_ms; // give up after this long without any data
+    uint32_t idle_delay_ms;      // longest wait between polls while the socket stays empty
+};
+
+struct OtaStageStats
+{
+    size_t bytes;
+    uint32_t busy_ms; // time spent moving data (reading the socket / writing flash)
+    uint32_t wait_ms; // time blocked on the other stage (back-pressure / starvation)
+};
+
+struct OtaPipelineStats
+{
+    OtaStageStats reader;
+    OtaStageStats writer;
+    OtaFlowStats flow;  // reader time spent waiting on the modem
+    uint32_t elapsed_ms;
+    OtaPipelineError error;
+};
+
+// Streams `length` bytes of `source` (already positioned at the body) into
+// `sink`. Blocks the caller until both stages have finished or one of them
+// aborted. Returns true only if every byte was written.
+bool ota_pipeline_run(Client &source, size_t length, const OtaSink &sink,
+                      const OtaPipelineConfig &config, OtaPipelineStats *stats);
+
+// Requests a clean stop of a running pipeline from any task.
+void ota_pipeline_abort();
+
+void ota_pipeline_print_stats(const OtaPipelineStats &stats, Print &out);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef OTA_RESUME_H
+#define OTA_RESUME_H
+
+#include <Arduino.h>
+#include <ArduinoHttpClient.h>
+
+#include "ota_digest.h"
+#include "ota_pipeline.h"
+
+// Resumable OTA download. Progress (validator, image size, committed offset
+// and a running CRC32 of the committed bytes) is checkpointed in NVS every
+// few flash sectors. A later attempt - in the same boot or after a reset -
+// re-checks the committed bytes against the CRC, asks the server for the
+// rest with "Range: bytes=N-" / "If-Range", and keeps writing into the same
+// inactive OTA partition after a 206 Partial Content reply.
+
+#ifndef OTA_RESUME_CHECKPOINT_SECTORS
+#define OTA_RESUME_CHECKPOINT_SECTORS 4
+#endif
+
+struct OtaResumeState
+{
+    char validator[64]; // ETag, or Last-Modified when the server sends no ETag
+    char partition[17]; // label of the partition being written
+    uint32_t total_size;
+    uint32_t offset;    // bytes committed to flash, sector aligned
+    uint32_t crc;       // CRC32 of those bytes
+};
+
+bool ota_resume_load(OtaResumeState &state);
+void ota_resume_save(const OtaResumeState &state);
+void ota_resume_clear();
+
+// One download attempt using `http` (not yet connected). Returns true once
+// the whole image is written and selected as the boot partition. On a
+// network failure the checkpoint is kept so the next call resumes.
+//
+// With a `manifest` (may be null) for the same image, each segment is
+// CRC-checked as soon as its last byte is written. A bad segment ends the
+// attempt and rolls the checkpoint back to that segment's start, so only
+// it is fetched again. The whole-image SHA-256 is checked before
+// activation.
+bool ota_resumable_download(HttpClient &http, const char *path,
+                            const OtaManifest *manifest,
+                            const OtaPipelineConfig &config);
+
+#endif
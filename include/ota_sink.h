@@ -0,0 +1,26 @@
+#ifndef OTA_SINK_H
+#define OTA_SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Consumer of firmware bytes in download order. Every OTA transport pushes
+// its payload through one of these, so extra stages (hashing, decompression,
+// ...) can be chained in front of the flash write without the transport
+// knowing about them. Returning false aborts the update.
+struct OtaSink
+{
+    bool (*write)(void *ctx, const uint8_t *data, size_t len);
+    void *ctx;
+};
+
+inline bool ota_sink_write(const OtaSink &sink, const uint8_t *data, size_t len)
+{
+    return sink.write(sink.ctx, data, len);
+}
+
+// Sink that writes straight into the Arduino Update class. Update.begin()
+// must already have been called.
+OtaSink ota_update_sink();
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef OTA_UART_H
+#define OTA_UART_H
+
+#include <Arduino.h>
+
+// Event-driven waits on the modem UART. TinyGSM's wait loops poll
+// stream.available() and yield in between, which keeps a core busy for as
+// long as a reply takes. ota_uart_attach() hooks HardwareSerial's own
+// receive and error callbacks, which its UART event task calls when the
+// line goes idle for OTA_UART_RX_TIMEOUT symbols (the end of an AT line,
+// the "> " prompt, a burst of socket payload) or OTA_UART_RX_FIFO_FULL
+// bytes are waiting. A task in ota_uart_wait() sleeps on its task
+// notification until one of them fires or its timeout passes.
+//
+// The driver stays HardwareSerial's, so updateBaudRate(), setPins() and
+// end()/begin() keep working; this needs the callbacks of arduino-esp32
+// 2.0.9 or later, and ota_uart_attach() fails on older cores.
+//
+// main.cpp routes TINY_GSM_WAIT_RX here, and OtaFlowControl's idle waits
+// use it once attached. One task waits at a time: the one driving TinyGSM.
+
+#ifndef OTA_UART_RX_TIMEOUT
+#define OTA_UART_RX_TIMEOUT 2 // symbols of silence that end a burst
+#endif
+
+#ifndef OTA_UART_RX_FIFO_FULL
+#define OTA_UART_RX_FIFO_FULL 64 // bytes in the FIFO that wake the waiter
+#endif
+
+struct OtaUartStats
+{
+    uint32_t bursts;      // receive callbacks: the line went idle or the FIFO filled
+    uint32_t overflows;   // FIFO overruns; input was dropped
+    uint32_t buffer_full; // ring buffer full; the FIFO waited, nothing lost
+    uint32_t errors;      // framing, parity and break errors
+    uint32_t waits;
+    uint32_t wakeups;     // waits ended by the callbacks rather than the timeout
+};
+
+// Hooks the receive callbacks of `serial` after begin(). Use it instead of
+// ota_flow_attach(): both take HardwareSerial's one onReceive() slot.
+bool ota_uart_attach(HardwareSerial &serial);
+bool ota_uart_attached();
+
+// Blocks the calling task until the callbacks report modem traffic or
+// `timeout_ms` passes; true if there is something to read. Returns at once
+// if bytes are already waiting. Before ota_uart_attach() it only yields.
+bool ota_uart_wait(uint32_t timeout_ms);
+
+const OtaUartStats &ota_uart_stats();
+// One line: events by kind and how waits ended.
+void ota_uart_print_stats(Print &out);
+
+#endif
@@ -0,0 +1,330 @@
+/**
+ * @file       TinyGsmAtQueue.h
+ * @license    LGPL-3.0
+ * @date       Oct 2026
+ */
+
+#ifndef SRC_TINYGSMATQUEUE_H_
+#define SRC_TINYGSMATQUEUE_H_
+
+#include "TinyGsmCommon.h"
+#include "TinyGsmResponse.h"
+
+// Longest command line the queue sends, "AT" and the concatenated
+// commands included
+#ifndef TINY_GSM_AT_QUEUE_LINE
+#define TINY_GSM_AT_QUEUE_LINE 128
+#endif
+
+// Room for a command's information lines; what does not fit is cut off
+#ifndef TINY_GSM_AT_RESPONSE
+#define TINY_GSM_AT_RESPONSE 96
+#endif
+
+enum TinyGsmAtStatus {
+  AT_CMD_IDLE    = 0,  // never submitted
+  AT_CMD_QUEUED  = 1,
+  AT_CMD_SENT    = 2,
+  AT_CMD_OK      = 3,
+  AT_CMD_ERROR   = 4,
+  AT_CMD_TIMEOUT = 5,
+};
+
+class TinyGsmAtCommand;
+
+// Called once the command has its final status
+typedef void (*TinyGsmAtCallback)(void* ctx, TinyGsmAtCommand& command);
+
+/**
+ * One AT command for TinyGsmAtQueue, and the future its result arrives in.
+ *
+ * `text` is the command without "AT" ("+CSQ", "+QIACT=1"); it and `prefix`
+ * must outlive the command. `prefix` names the information lines that
+ * answer it ("+CSQ:"); a command without one takes every line that is not
+ * a URC. A `query` only reads modem state, so the queue may send it on one
+ * command line with the queries queued after it (V.250 concatenation,
+ * "AT+CSQ;+CEREG?"), which costs one modem round trip for all of them.
+ * Queries need a prefix to tell their lines apart.
+ *
+ * The object belongs to the caller and must stay alive until done().
+ */
+class TinyGsmAtCommand {
+  template <class, uint8_t>
+  friend class TinyGsmAtQueue;
+
+ public:
+  explicit TinyGsmAtCommand(const char* text, const char* prefix = nullptr,
+                            uint32_t timeout_ms = 1000L, bool query = false)
+      : text(text),
+        prefix(prefix),
+        timeout_ms(timeout_ms),
+        query(query && prefix),
+        state(AT_CMD_IDLE),
+        solo(false),
+        len(0),
+        callback(nullptr),
+        ctx(nullptr) {
+    buf[0] = '\0';
+  }
+
+  TinyGsmAtStatus status() const {
+    return state;
+  }
+  bool done() const {
+    return state >= AT_CMD_OK;
+  }
+  bool ok() const {
+    return state == AT_CMD_OK;
+  }
+  // The information lines, '\n' between them; after an error, the final
+  // result line ("+CME ERROR: 30") is last
+  const char* response() const {
+    return buf;
+  }
+
+  const char* const text;
+  const char* const prefix;
+  const uint32_t    timeout_ms;
+  const bool        query;
+
+ private:
+  void append(const char* line, size_t n) {
+    if (len && len < TINY_GSM_AT_RESPONSE - 1) buf[len++] = '\n';
+    if (n > TINY_GSM_AT_RESPONSE - 1 - len) n = TINY_GSM_AT_RESPONSE - 1 - len;
+    memcpy(buf + len, line, n);
+    len += n;
+    buf[len] = '\0';
+  }
+
+  TinyGsmAtStatus   state;
+  bool              solo;  // send on its own line (after a failed batch)
+  size_t            len;
+  char              buf[TINY_GSM_AT_RESPONSE];
+  TinyGsmAtCallback callback;
+  void*             ctx;
+};
+
+/**
+ * Asynchronous AT command engine on top of a TinyGSM modem.
+ *
+ * submit() queues a command and returns at once; poll(), called from the
+ * application's loop, reads what the modem has sent without waiting,
+ * completes commands on their final result code or timeout and sends the
+ * next ones. A +QIACT that takes the network 150 s therefore only costs
+ * the loop its polls. Queries queued back to back go out on one command
+ * line (see TinyGsmAtCommand), up to TINY_GSM_AT_QUEUE_LINE characters; if
+ * such a line fails, the queries after the failing one are sent again on
+ * their own.
+ *
+ * Unsolicited lines go to the modem's handleURCs() one whole line at a
+ * time, as the EC200U's URC table expects (see TinyGsmURC.h).
+ *
+ * The queue and the modem's own blocking calls must not read the modem at
+ * the same time: call those only while idle(). Commands that switch the
+ * line to data ("> " prompts, CONNECT) stay with the blocking calls.
+ */
+template <class Modem, uint8_t N = 8>
+class TinyGsmAtQueue {
+ public:
+  explicit TinyGsmAtQueue(Modem& modem, bool batch = true)
+      : modem(modem),
+        batch(batch),
+        head(0),
+        count(0),
+        inflight(0),
+        sentAt(0),
+        timeout(0),
+        lines(0),
+        completed(0) {}
+
+  /**
+   * Queues `command`; `callback` (optional) is called with it once it is
+   * done. False if the queue is full or the command is already queued.
+   */
+  bool submit(TinyGsmAtCommand& command, TinyGsmAtCallback callback = nullptr,
+              void* ctx = nullptr) {
+    if (count >= N || command.state == AT_CMD_QUEUED ||
+        command.state == AT_CMD_SENT) {
+      return false;
+    }
+    command.state    = AT_CMD_QUEUED;
+    command.solo     = false;
+    command.len      = 0;
+    command.buf[0]   = '\0';
+    command.callback = callback;
+    command.ctx      = ctx;
+    ring[(head + count++) % N] = &command;
+    return true;
+  }
+
+  // Handles what the modem sent and sends what is due; never waits
+  void poll() {
+    while (modem.stream.available() > 0) {
+      int a = modem.stream.read();
+      if (a <= 0) continue;
+      line += static_cast<char>(a);
+      if (a == '\n') {
+        takeLine();
+        line.clear();
+      }
+    }
+    if (inflight && millis() - sentAt >= timeout) {
+      DBG("### AT queue timeout:", ring[head]->text);
+      complete(inflight, AT_CMD_TIMEOUT);
+    }
+    if (!inflight && count) send();
+  }
+
+  /**
+   * Polls until `command` is done, sleeping on TINY_GSM_WAIT_RX between
+   * polls; for callers with nothing else to do.
+   */
+  TinyGsmAtStatus wait(TinyGsmAtCommand& command) {
+    for (;;) {
+      poll();
+      if (command.done() || command.state == AT_CMD_IDLE) {
+        return command.state;
+      }
+      if (modem.stream.available() <= 0) {
+        TINY_GSM_WAIT_RX(TinyGsmTimeLeft(sentAt, timeout));
+      }
+    }
+  }
+
+  // Nothing queued or waiting for the modem
+  bool idle() const {
+    return count == 0;
+  }
+
+  // Command lines sent and commands completed so far
+  uint32_t linesSent() const {
+    return lines;
+  }
+  uint32_t commandsDone() const {
+    return completed;
+  }
+
+ private:
+  TinyGsmAtCommand* at(uint8_t i) const {
+    return ring[(head + i) % N];
+  }
+
+  // The head command, and the queries behind it that fit on its line
+  void send() {
+    char   out[TINY_GSM_AT_QUEUE_LINE];
+    size_t n = 0;
+    out[n++] = 'A';
+    out[n++] = 'T';
+    timeout  = 0;
+    while (inflight < count) {
+      TinyGsmAtCommand* c = at(inflight);
+      size_t            t = strlen(c->text);
+      if (inflight) {
+        // Only queries go on a shared line, and only where they fit
+        if (!batch || !c->query || c->solo || !at(0)->query || at(0)->solo ||
+            n + 1 + t + 1 > sizeof(out)) {
+          break;
+        }
+        out[n++] = ';';
+      } else if (n + t + 1 > sizeof(out)) {
+        t = sizeof(out) - n - 1;
+      }
+      memcpy(out + n, c->text, t);
+      n += t;
+      c->state = AT_CMD_SENT;
+      if (c->timeout_ms > timeout) timeout = c->timeout_ms;
+      inflight++;
+    }
+    out[n++] = '\r';
+    modem.stream.write(reinterpret_cast<const uint8_t*>(out), n);
+    modem.stream.flush();
+    sentAt = millis();
+    lines++;
+  }
+
+  static bool startsWith(const char* s, size_t n, const char* prefix) {
+    size_t p = strlen(prefix);
+    return p <= n && memcmp(s, prefix, p) == 0;
+  }
+
+  void takeLine() {
+    const char* s = line.c_str();
+    size_t      n = line.length();
+    while (n && (s[n - 1] == '\n' || s[n - 1] == '\r')) n--;
+    if (!n) return;
+
+    if (inflight) {
+      if (n == 2 && memcmp(s, "OK", 2) == 0) {
+        complete(inflight, AT_CMD_OK);
+        return;
+      }
+      if ((n == 5 && memcmp(s, "ERROR", 5) == 0) ||
+          startsWith(s, n, "+CME ERROR:") || startsWith(s, n, "+CMS ERROR:")) {
+        failed(s, n);
+        return;
+      }
+      for (uint8_t i = 0; i < inflight; i++) {
+        TinyGsmAtCommand* c = at(i);
+        if (c->prefix && startsWith(s, n, c->prefix)) {
+          c->append(s, n);
+          return;
+        }
+      }
+    }
+    if (modem.handleURCs(line)) return;
+    // A command without a prefix is alone on its line
+    if (inflight && !at(0)->prefix) {
+      at(0)->append(s, n);
+      return;
+    }
+    DBG("### AT queue unhandled:", line);
+  }
+
+  // An error ends a concatenated line at the command that failed: those
+  // before it answered, those after it never ran
+  void failed(const char* s, size_t n) {
+    uint8_t answered = 0;
+    while (answered + 1 < inflight && at(answered)->len) answered++;
+    uint8_t retry = inflight - answered - 1;
+    complete(answered, AT_CMD_OK);
+    TinyGsmAtCommand* c = at(0);
+    c->append(s, n);
+    complete(1, AT_CMD_ERROR);
+    for (uint8_t i = 0; i < retry; i++) {
+      at(i)->state = AT_CMD_QUEUED;
+      at(i)->solo  = true;
+    }
+    inflight = 0;
+  }
+
+  // Takes the first `n` commands off the queue with `status`, then runs
+  // their callbacks, which may submit more
+  void complete(uint8_t n, TinyGsmAtStatus status) {
+    TinyGsmAtCommand* done[N];
+    for (uint8_t i = 0; i < n; i++) {
+      done[i]        = ring[head];
+      done[i]->state = status;
+      head           = (head + 1) % N;
+      count--;
+      inflight--;
+      completed++;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+      if (done[i]->callback) done[i]->callback(done[i]->ctx, *done[i]);
+    }
+  }
+
+  Modem&            modem;
+  const bool        batch;
+  TinyGsmAtCommand* ring[N];
+  uint8_t           head;
+  uint8_t           count;
+  uint8_t           inflight;
+  uint32_t          sentAt;
+  uint32_t          timeout;
+  uint32_t          lines;
+  uint32_t          completed;
+  TinyGsmResponseBuffer<TINY_GSM_AT_QUEUE_LINE> line;
+};
+
+#endif  // SRC_TINYGSMATQUEUE_H_
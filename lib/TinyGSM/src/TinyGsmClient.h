@@ -91,6 +91,7 @@ typedef TinyGsmBG96::GsmClientSecureBG96 TinyGsmClientSecure;
 typedef TinyGsmEC200U                        TinyGsm;
 typedef TinyGsmEC200U::GsmClientEC200U       TinyGsmClient;
 typedef TinyGsmEC200U::GsmClientSecureEC200U TinyGsmClientSecure;
+typedef TinyGsmEC200U::GsmClientTransparentEC200U TinyGsmClientTransparent;
 
 #elif defined(TINY_GSM_MODEM_A6) || defined(TINY_GSM_MODEM_A7)
 #include "TinyGsmClientA6.h"
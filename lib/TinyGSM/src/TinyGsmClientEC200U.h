@@ -13,7 +13,28 @@
 // #define TINY_GSM_DEBUG Serial
 
 #define TINY_GSM_MUX_COUNT 12
+
+// Define TINY_GSM_EC200U_DIRECT_PUSH to open TCP/SSL sockets in direct push
+// access mode (1): the modem sends what arrives unsolicited as
+// +QIURC: "recv",<id>,<len><CR><LF><data>, and the URC handler moves <data>
+// straight into the socket's FIFO. Without it sockets use buffer access
+// mode (0): a "recv" URC only announces data that +QIRD then fetches.
+// A push is up to 1500 bytes and must fit the FIFO whole; pushes that come
+// in while a command waits for its answer are taken too, and what finds no
+// room is dropped, so keep the FIFO drained while the socket receives.
+#if defined(TINY_GSM_EC200U_DIRECT_PUSH)
+#define TINY_GSM_NO_MODEM_BUFFER
+#else
 #define TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
+#define TINY_GSM_MODEM_HAS_DIRECT_READ
+#endif
+// Replies nobody asked to see go into a fixed buffer, not a heap String.
+// URCs are dispatched by whole line, so it keeps lines of up to 62
+// characters intact.
+#define TINY_GSM_MODEM_HAS_RESPONSE_BUFFER
+#ifndef TINY_GSM_RESPONSE_BUFFER
+#define TINY_GSM_RESPONSE_BUFFER 128
+#endif
 #ifdef AT_NL
 #undef AT_NL
 #endif
@@ -42,6 +63,11 @@
 #include "TinyGsmNTP.tpp"
 #include "TinyGsmBattery.tpp"
 #include "TinyGsmTemperature.tpp"
+#include "TinyGsmURC.h"
+
+#if defined(TINY_GSM_EC200U_DIRECT_PUSH) && TINY_GSM_RX_BUFFER < 1500
+#error "TINY_GSM_EC200U_DIRECT_PUSH needs TINY_GSM_RX_BUFFER of 1500 or more"
+#endif
 
 enum EC200URegStatus {
   REG_NO_RESULT    = -1,
@@ -53,6 +79,8 @@ enum EC200URegStatus {
   REG_UNKNOWN      = 4,
 };
 
+class TinyGsmEC200UHttpFile;
+
 class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
                     public TinyGsmGPRS<TinyGsmEC200U>,
                     public TinyGsmTCP<TinyGsmEC200U, TINY_GSM_MUX_COUNT>,
@@ -75,6 +103,7 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
   friend class TinyGsmNTP<TinyGsmEC200U>;
   friend class TinyGsmBattery<TinyGsmEC200U>;
   friend class TinyGsmTemperature<TinyGsmEC200U>;
+  friend class TinyGsmEC200UHttpFile;
 
   /*
    * Inner Client
@@ -84,13 +113,21 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
     friend class TinyGsmEC200U;
 
    public:
-    GsmClientEC200U() {}
+    GsmClientEC200U() : ssl_sock(false) {
+      this->at = nullptr;
+    }
 
     explicit GsmClientEC200U(TinyGsmEC200U& modem, uint8_t mux = 0) {
       ssl_sock = false;
       init(&modem, mux);
     }
 
+    // URCs reach the socket through the modem's sockets[], so a client
+    // going out of scope must not stay there
+    ~GsmClientEC200U() {
+      if (at && at->sockets[mux] == this) { at->sockets[mux] = nullptr; }
+    }
+
     bool init(TinyGsmEC200U* modem, uint8_t mux = 0) {
       this->at       = modem;
       sock_available = 0;
@@ -167,12 +204,231 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
     }
   };
 
+  /*
+   * Inner Transparent Client
+   */
+ public:
+  // A TCP socket opened in transparent access mode (2). After CONNECT the
+  // UART carries the socket's bytes both ways with no +QISEND/+QIRD
+  // framing, so the modem takes no AT commands and serves no other socket
+  // until stop() returns it to command mode: by pulsing DTR when a DTR pin
+  // is given (the modem is set to AT&D1), otherwise with "+++" between two
+  // guard times. When the peer closes, the modem leaves data mode by itself
+  // with "\r\nNO CARRIER\r\n"; that is held back from the data and ends the
+  // connection. A byte run that only looks like the start of it is released
+  // once no more data has followed for kCarrierHoldMs.
+  class GsmClientTransparentEC200U : public GsmClientEC200U {
+   public:
+    static const uint32_t kEscapeGuardMs  = 1000;
+    static const uint32_t kDtrPulseMs     = 100;
+    static const uint32_t kCarrierHoldMs  = 50;
+    static const uint8_t  kNoCarrierLen   = 14;
+
+    GsmClientTransparentEC200U()
+        : dtr_pin(-1), data_mode(false), carrier_match(0), last_data(0) {}
+
+    explicit GsmClientTransparentEC200U(TinyGsmEC200U& modem, uint8_t mux = 0,
+                                        int8_t dtrPin = -1)
+        : GsmClientEC200U(modem, mux),
+          dtr_pin(dtrPin),
+          data_mode(false),
+          carrier_match(0),
+          last_data(0) {}
+
+    int connect(const char* host, uint16_t port, int timeout_s) override {
+      stop();
+      TINY_GSM_YIELD();
+      rx.clear();
+      carrier_match = 0;
+      if (dtr_pin >= 0) {
+        pinMode(dtr_pin, OUTPUT);
+        digitalWrite(dtr_pin, LOW);
+        at->sendAT(GF("&D1"));  // DTR ON->OFF: back to command mode
+        at->waitResponse();
+      }
+      data_mode = at->modemConnectTransparent(host, port, mux, timeout_s);
+      sock_connected = data_mode;
+      last_data      = millis();
+      return sock_connected;
+    }
+    TINY_GSM_CLIENT_CONNECT_OVERRIDES
+
+    void stop(uint32_t maxWaitMs) override {
+      uint32_t startMillis = millis();
+      if (data_mode) { exitDataMode(); }
+      rx.clear();
+      at->sendAT(GF("+QICLOSE="), mux);
+      sock_connected = false;
+      at->waitResponse((maxWaitMs - (millis() - startMillis)));
+    }
+    void stop() override {
+      stop(15000L);
+    }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+      TINY_GSM_YIELD();
+      if (!data_mode) return 0;
+      return at->stream.write(buf, size);
+    }
+    size_t write(uint8_t c) override {
+      return write(&c, 1);
+    }
+
+    int available() override {
+      TINY_GSM_YIELD();
+      pullData();
+      return rx.size();
+    }
+
+    int read(uint8_t* buf, size_t size) override {
+      TINY_GSM_YIELD();
+      pullData();
+      return rx.get(buf, TinyGsmMin(size, rx.size()));
+    }
+    int read() override {
+      uint8_t c;
+      if (read(&c, 1) == 1) { return c; }
+      return -1;
+    }
+
+    size_t readSpan(const uint8_t** data) {
+      TINY_GSM_YIELD();
+      pullData();
+      TinyGsmFifoSpan<uint8_t> span = rx.readSpan();
+      *data                         = span.first;
+      return span.firstSize;
+    }
+
+    int peek() override {
+      pullData();
+      return rx.size() ? (uint8_t)rx.peek() : -1;
+    }
+
+    void flush() override {
+      at->stream.flush();
+    }
+
+    uint8_t connected() override {
+      if (available()) { return true; }
+      return data_mode;
+    }
+
+    // Returns to command mode with the socket still open; anything the
+    // modem sends before its OK is dropped
+    bool exitDataMode() {
+      if (!data_mode) return true;
+      if (dtr_pin >= 0) {
+        digitalWrite(dtr_pin, HIGH);
+        delay(kDtrPulseMs);
+        digitalWrite(dtr_pin, LOW);
+      } else {
+        delay(kEscapeGuardMs);
+        at->stream.write(reinterpret_cast<const uint8_t*>("+++"), 3);
+        at->stream.flush();
+      }
+      data_mode = false;
+      return at->waitResponse(kEscapeGuardMs + 2000L) == 1;
+    }
+
+   protected:
+    // Moves what the UART holds into the FIFO, keeping room to release a
+    // held-back partial "NO CARRIER"
+    void pullData() {
+      if (!data_mode) return;
+      Stream& stream = at->stream;
+      uint8_t chunk[128];
+      int     avail;
+      while ((avail = stream.available()) > 0 &&
+             rx.free() > static_cast<int>(kNoCarrierLen)) {
+        size_t n = TinyGsmMin((size_t)avail, sizeof(chunk));
+        n = TinyGsmMin(n, (size_t)(rx.free() - kNoCarrierLen));
+        n = stream.readBytes(chunk, n);
+        last_data = millis();
+        scanData(chunk, n);
+        if (!data_mode) return;
+      }
+      if (carrier_match && millis() - last_data > kCarrierHoldMs) {
+        rx.put(reinterpret_cast<const uint8_t*>(noCarrier()), carrier_match);
+        carrier_match = 0;
+      }
+    }
+
+    // Copies data runs into the FIFO while matching "\r\nNO CARRIER\r\n"
+    // across calls; carrier_match bytes of it are held back
+    void scanData(const uint8_t* p, size_t n) {
+      const char* nc    = noCarrier();
+      size_t      start = 0;  // first byte of the pending data run
+      for (size_t i = 0; i < n; i++) {
+        uint8_t c = p[i];
+        if (carrier_match == 0) {
+          if (c != '\r') continue;
+          rx.put(p + start, i - start);
+        }
+        for (;;) {
+          if (c == (uint8_t)nc[carrier_match]) {
+            carrier_match++;
+            start = i + 1;
+            break;
+          }
+          if (carrier_match == 0) {
+            start = i;
+            break;
+          }
+          // Not it after all; the held "\r" at the end may start it again
+          uint8_t keep = carrier_match == kNoCarrierLen - 1 ? 1 : 0;
+          rx.put(reinterpret_cast<const uint8_t*>(nc), carrier_match - keep);
+          carrier_match = keep;
+        }
+        if (carrier_match == kNoCarrierLen) {
+          // The modem is in command mode again; the rest is not data
+          carrier_match  = 0;
+          data_mode      = false;
+          sock_connected = false;
+          return;
+        }
+      }
+      if (n > start) rx.put(p + start, n - start);
+    }
+
+    static const char* noCarrier() {
+      return "\r\nNO CARRIER\r\n";
+    }
+
+    int8_t   dtr_pin;
+    bool     data_mode;
+    uint8_t  carrier_match;
+    uint32_t last_data;
+  };
+
   /*
    * Constructor
    */
  public:
   explicit TinyGsmEC200U(Stream& stream) : stream(stream) {
     memset(sockets, 0, sizeof(sockets));
+    // Ahead of anything the application adds, so socket state is current
+    // by the time its handlers run
+    urcs.add("+QIURC:", handleSocketURC, this);
+    urcs.add("+QSSLURC:", handleSocketURC, this);
+    urcs.add("RDY", handleModemReady, this);
+  }
+
+  /*
+   * URC handlers
+   */
+ public:
+  /**
+   * @brief Calls `handler` for each unsolicited line that starts with
+   * `prefix` ("+CEREG:", "+CMTI:", "RDY", ...), with the fields after it
+   * (see TinyGsmURC.h). URCs are read whenever TinyGSM reads the modem,
+   * from waitResponse() or maintain(). The modem's own handlers for
+   * "+QIURC:"/"+QSSLURC:" socket data and close come first; the others,
+   * "pdpdeact" included, reach the application's too. False if all
+   * TINY_GSM_URC_HANDLERS slots are taken.
+   */
+  bool onURC(const char* prefix, TinyGsmUrcHandler handler,
+             void* ctx = nullptr) {
+    return urcs.add(prefix, handler, ctx);
   }
 
   /*
@@ -674,7 +930,7 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
       // <remote_port>,<local_port>,<access_mode>(0-2; 0=buffer)
       // may need previous AT+QSSLCFG
       sendAT(GF("+QSSLOPEN=1,1,"), mux, GF(",\""), host, GF("\","), port,
-             GF(",0"));
+             ',', kAccessMode);
       waitResponse();
 
       if (waitResponse(timeout_ms, GF(AT_NL "+QSSLOPEN:")) != 1) {
@@ -692,7 +948,7 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
       // "TCP/UDP/TCP LISTENER/UDPSERVICE", "<IP_address>/<domain_name>",
       // <remote_port>,<local_port>,<access_mode>(0-2; 0=buffer)
       sendAT(GF("+QIOPEN=1,"), mux, GF(",\""), GF("TCP"), GF("\",\""), host,
-             GF("\","), port, GF(",0,0"));
+             GF("\","), port, GF(",0,"), kAccessMode);
       waitResponse();
 
       if (waitResponse(timeout_ms, GF(AT_NL "+QIOPEN:")) != 1) { return false; }
@@ -703,6 +959,21 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
     return (0 == streamGetIntBefore('\n'));
   }
 
+  // Opens a socket in transparent access mode; on success the modem
+  // answers CONNECT and the UART switches to data mode
+  bool modemConnectTransparent(const char* host, uint16_t port, uint8_t mux,
+                               int timeout_s = 75) {
+    uint32_t timeout_ms = ((uint32_t)timeout_s) * 1000;
+    sendAT(GF("+QIOPEN=1,"), mux, GF(",\"TCP\",\""), host, GF("\","), port,
+           GF(",0,2"));
+    if (waitResponse(timeout_ms, GF(AT_NL "CONNECT"), GFP(GSM_ERROR),
+                     GF(AT_NL "+QIOPEN:")) != 1) {
+      return false;
+    }
+    // The line ending is the last thing before the socket's data
+    return streamSkipUntil('\n');
+  }
+
   int16_t modemSend(const void* buff, size_t len, uint8_t mux) {
     bool ssl = sockets[mux]->ssl_sock;
     if (ssl) {
@@ -713,12 +984,18 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
     if (waitResponse(GF(">")) != 1) { return 0; }
     stream.write(reinterpret_cast<const uint8_t*>(buff), len);
     stream.flush();
-    if (waitResponse(GF(AT_NL "SEND OK")) != 1) { return 0; }
+    // "SEND FAIL": the socket's send buffer is full
+    if (waitResponse(GF(AT_NL "SEND OK"), GF(AT_NL "SEND FAIL"),
+                     GFP(GSM_ERROR)) != 1) {
+      return 0;
+    }
     // TODO(?): Wait for ACK? (AT+QISEND=id,0 or AT+QSSLSEND=id,0)
     return len;
   }
 
-  size_t modemRead(size_t size, uint8_t mux) {
+  // Asks for up to size bytes and returns the announced payload length,
+  // which follows on the stream, or 0
+  int16_t modemReadRequest(size_t size, uint8_t mux) {
     if (!sockets[mux]) return 0;
     bool ssl = sockets[mux]->ssl_sock;
     if (ssl) {
@@ -731,13 +1008,33 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
       sendAT(GF("+QIRD="), mux, ',', (uint16_t)size);
       if (waitResponse(GF("+QIRD:")) != 1) { return 0; }
     }
-    int16_t len = streamGetIntBefore('\n');
+    return streamGetIntBefore('\n');
+  }
 
-    for (int i = 0; i < len; i++) { moveCharFromStreamToFifo(mux); }
+  size_t modemRead(size_t size, uint8_t mux) {
+    int16_t len = modemReadRequest(size, mux);
+    if (!sockets[mux]) return 0;
+
+    if (len > 0) { moveBytesFromStreamToFifo(mux, len); }
     waitResponse();
     // DBG("### READ:", len, "from", mux);
     sockets[mux]->sock_available = modemGetAvailable(mux);
-    return len;
+    return len > 0 ? len : 0;
+  }
+
+  // As modemRead(), but the payload lands in buf instead of the FIFO; the
+  // request is sized to the caller's buffer, so nothing is left over
+  size_t modemReadDirect(uint8_t* buf, size_t size, uint8_t mux) {
+    int16_t len = modemReadRequest(size, mux);
+    if (!sockets[mux]) return 0;
+
+    size_t moved = 0;
+    if (len > 0) {
+      moved = moveBytesFromStream(buf, len, sockets[mux]->_timeout);
+    }
+    waitResponse();
+    sockets[mux]->sock_available = modemGetAvailable(mux);
+    return moved;
   }
 
   size_t modemGetAvailable(uint8_t mux) {
@@ -763,11 +1060,18 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
         waitResponse();
       }
     }
+#if !defined(TINY_GSM_URC_NOTIFY)
     if (!result) { sockets[mux]->sock_connected = modemGetConnected(mux); }
+#endif
     return result;
   }
 
   bool modemGetConnected(uint8_t mux) {
+#if defined(TINY_GSM_EC200U_DIRECT_PUSH)
+    // The "closed" URC keeps sock_connected current, and a state query
+    // could have pushes queued in front of its answer
+    return sockets[mux] && sockets[mux]->sock_connected;
+#endif
     bool ssl = sockets[mux]->ssl_sock;
     if (ssl) {
       sendAT(GF("+QSSLSTATE=1,"), mux);
@@ -810,38 +1114,116 @@ class TinyGsmEC200U : public TinyGsmModem<TinyGsmEC200U>,
    * Utilities
    */
  public:
-  bool handleURCs(String& data) {
-    if (data.endsWith(GF(AT_NL "+QIURC:"))) {
-      streamSkipUntil('\"');
-      String urc = stream.readStringUntil('\"');
-      streamSkipUntil(',');
-      if (urc == "recv") {
-        int8_t mux = streamGetIntBefore('\n');
-        DBG("### URC RECV:", mux);
-        if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-          sockets[mux]->got_data = true;
-        }
-      } else if (urc == "closed") {
-        int8_t mux = streamGetIntBefore('\n');
-        DBG("### URC CLOSE:", mux);
-        if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
-          sockets[mux]->sock_connected = false;
-        }
-      } else {
-        streamSkipUntil('\n');
+  // URCs are whole lines, looked up in `urcs` once their line end is in
+  bool urcCanEndWith(char c) {
+    return c == '\n';
+  }
+
+  // `data` is a String or the modem's TinyGsmResponseBuffer
+  template <typename Response>
+  bool handleURCs(Response& data) {
+    const char* text = data.c_str();
+    size_t      end  = data.length();
+    if (end && text[end - 1] == '\n') end--;
+    if (end && text[end - 1] == '\r') end--;
+    size_t start = end;
+    while (start > 0 && text[start - 1] != '\n') start--;
+    if (!urcs.dispatch(text + start, end - start)) return false;
+    data = "";
+    return true;
+  }
+
+  static bool handleSocketURC(void* ctx, TinyGsmUrcFields& fields) {
+    return static_cast<TinyGsmEC200U*>(ctx)->socketURC(fields);
+  }
+
+  // "recv" and "closed" are socket business only; "pdpdeact" closes every
+  // socket but is news to the application too
+  bool socketURC(TinyGsmUrcFields& fields) {
+    const char* urc = fields.next();
+    if (!urc) return false;
+    if (strcmp(urc, "recv") == 0) {
+      int8_t mux = fields.nextInt();
+#if defined(TINY_GSM_EC200U_DIRECT_PUSH)
+      int16_t len = fields.nextInt();
+      DBG("### URC RECV:", mux, len);
+      modemPushToFifo(mux, len);
+#else
+      DBG("### URC RECV:", mux);
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->got_data = true;
+      }
+#endif
+      return true;
+    }
+    if (strcmp(urc, "closed") == 0) {
+      int8_t mux = fields.nextInt();
+      DBG("### URC CLOSE:", mux);
+      if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+        sockets[mux]->sock_connected = false;
       }
-      data = "";
       return true;
     }
+    if (strcmp(urc, "pdpdeact") == 0) {
+      DBG("### URC PDP DEACT");
+      closeAllSockets();
+    }
     return false;
   }
 
+  // The modem restarted: nothing it had open is open any more
+  static bool handleModemReady(void* ctx, TinyGsmUrcFields&) {
+    static_cast<TinyGsmEC200U*>(ctx)->closeAllSockets();
+    return false;
+  }
+
+  void closeAllSockets() {
+    for (int mux = 0; mux < TINY_GSM_MUX_COUNT; mux++) {
+      if (sockets[mux]) { sockets[mux]->sock_connected = false; }
+    }
+  }
+
+#if defined(TINY_GSM_EC200U_DIRECT_PUSH)
+  // Moves a pushed payload into the socket's FIFO. What does not fit, or
+  // belongs to no socket, is read off the stream and dropped.
+  void modemPushToFifo(int8_t mux, int16_t len) {
+    if (len <= 0) return;
+    size_t moved = 0;
+    if (mux >= 0 && mux < TINY_GSM_MUX_COUNT && sockets[mux]) {
+      if (len > sockets[mux]->rx.free()) {
+        DBG("### Buffer overflow: ", len, "->", sockets[mux]->rx.free());
+      }
+      moved = moveBytesFromStreamToFifo(mux, len);
+      push_received = true;
+    }
+    uint8_t dump[32];
+    while (moved < (size_t)len) {
+      size_t n = stream.readBytes(dump, TinyGsmMin(sizeof(dump), len - moved));
+      if (!n) break;
+      moved += n;
+    }
+  }
+
+  bool urcDeliveredData() {
+    bool pushed   = push_received;
+    push_received = false;
+    return pushed;
+  }
+#endif
+
  public:
   Stream& stream;
 
  protected:
   GsmClientEC200U* sockets[TINY_GSM_MUX_COUNT];
   String         certificates[TINY_GSM_MUX_COUNT];
+  TinyGsmUrcTable<TINY_GSM_URC_HANDLERS> urcs;
+#if defined(TINY_GSM_EC200U_DIRECT_PUSH)
+  static const uint8_t kAccessMode = 1;  // direct push
+  bool                 push_received = false;
+#else
+  static const uint8_t kAccessMode = 0;  // buffer
+#endif
 };
 
 #endif  // SRC_TINYGSMCLIENTEC200U_H_
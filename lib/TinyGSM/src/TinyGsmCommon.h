@@ -37,6 +37,14 @@
   { delay(TINY_GSM_YIELD_MS); }
 #endif
 
+// Called while waiting for the modem with nothing to read: returns once the
+// stream may have data again, or after at most `ms`. The default yields, so
+// the wait loops poll stream.available(); a platform with UART receive
+// events can define it to block on them instead.
+#ifndef TINY_GSM_WAIT_RX
+#define TINY_GSM_WAIT_RX(ms) TINY_GSM_YIELD()
+#endif
+
 #define TINY_GSM_ATTR_NOT_AVAILABLE \
   __attribute__((error("Not available on this modem type")))
 #define TINY_GSM_ATTR_NOT_IMPLEMENTED __attribute__((error("Not implemented")))
@@ -110,6 +118,12 @@ const T& TinyGsmMax(const T& a, const T& b) {
   return (b < a) ? a : b;
 }
 
+// What is left of a timeout_ms period that began at startMillis
+inline uint32_t TinyGsmTimeLeft(uint32_t startMillis, uint32_t timeout_ms) {
+  uint32_t elapsed = millis() - startMillis;
+  return elapsed < timeout_ms ? timeout_ms - elapsed : 0;
+}
+
 /*
  * Automatically find baud rate
  */
@@ -0,0 +1,314 @@
+/**
+ * @file       TinyGsmEC200UHttpFile.h
+ * @license    LGPL-3.0
+ * @date       Oct 2026
+ */
+
+#ifndef SRC_TINYGSMEC200UHTTPFILE_H_
+#define SRC_TINYGSMEC200UHTTPFILE_H_
+
+#include "TinyGsmClientEC200U.h"
+
+// Largest single AT+QFREAD. Reads are also capped by the size the caller
+// asks for, so this only matters for callers with big buffers.
+#if !defined(TINY_GSM_EC200U_QFREAD_MAX)
+#define TINY_GSM_EC200U_QFREAD_MAX 16384
+#endif
+
+// Time allowed on top of the payload's wire time for one AT+QFREAD to
+// arrive (file system latency, UART gaps)
+#if !defined(TINY_GSM_EC200U_QFREAD_SLACK)
+#define TINY_GSM_EC200U_QFREAD_SLACK 2000
+#endif
+
+/**
+ * Bulk download through the EC200U's own HTTP client.
+ *
+ * download() has the modem fetch a URL into a file on its UFS file system
+ * (AT+QHTTPURL / AT+QHTTPGET / AT+QHTTPREADFILE), so the transfer runs at
+ * the radio's rate with no AT framing or socket polling on the UART. The
+ * file is then read back as a Client: every read() is one AT+QFREAD of up
+ * to the requested size, with the payload copied straight from the serial
+ * port into the caller's buffer.
+ *
+ * Only the read side of Client is meaningful; connect() and write() fail.
+ * The object must not be used while a TinyGsmClient socket is reading on
+ * the same modem from another task.
+ */
+class TinyGsmEC200UHttpFile : public Client {
+ public:
+  explicit TinyGsmEC200UHttpFile(TinyGsmEC200U& modem,
+                                 const char*    filename = "UFS:ota.bin")
+      : at(&modem),
+        filename(filename),
+        baud(115200),
+        handle(-1),
+        fileSize(0),
+        position(0),
+        failed(false),
+        httpStatus(0),
+        contentLength(-1) {}
+
+  ~TinyGsmEC200UHttpFile() {
+    close();
+  }
+
+  /*
+   * HTTP download into the file system
+   */
+
+  /**
+   * Downloads `url` into the file (replacing it). Returns the HTTP status
+   * code, or a negative value if the modem could not complete the
+   * transfer: -1 bad URL, -2 request failed, -3 not enough UFS space,
+   * -4 file write failed.
+   */
+  int download(const char* url, uint32_t timeout_s = 300) {
+    close();
+    httpStatus    = 0;
+    contentLength = -1;
+    fileSize      = 0;
+
+    at->sendAT(GF("+QHTTPCFG=\"contextid\",1"));
+    if (at->waitResponse() != 1) { return -2; }
+    at->sendAT(GF("+QHTTPCFG=\"responseheader\",0"));
+    if (at->waitResponse() != 1) { return -2; }
+    if (strncmp(url, "https", 5) == 0) {
+      at->sendAT(GF("+QHTTPCFG=\"sslctxid\",1"));
+      if (at->waitResponse() != 1) { return -2; }
+    }
+
+    // AT+QHTTPURL=<URL_length>,<timeout>, then the URL after CONNECT
+    at->sendAT(GF("+QHTTPURL="), (uint16_t)strlen(url), GF(",80"));
+    if (at->waitResponse(10000L, GF("CONNECT")) != 1) { return -1; }
+    at->stream.print(url);
+    if (at->waitResponse(80000L) != 1) { return -1; }
+
+    // +QHTTPGET: <err>,<httprspcode>[,<content_length>] once the headers
+    // are in; the body stays in the modem until it is read out
+    at->sendAT(GF("+QHTTPGET="), timeout_s);
+    if (at->waitResponse() != 1) { return -2; }
+    if (at->waitResponse(timeout_s * 1000L, GF("+QHTTPGET:")) != 1) {
+      return -2;
+    }
+    String line = at->stream.readStringUntil('\n');
+    int    err  = line.toInt();
+    int    comma = line.indexOf(',');
+    if (err != 0 || comma < 0) {
+      DBG("### QHTTPGET error:", err);
+      return -2;
+    }
+    httpStatus   = line.substring(comma + 1).toInt();
+    int lenComma = line.indexOf(',', comma + 1);
+    if (lenComma > 0) { contentLength = line.substring(lenComma + 1).toInt(); }
+    if (httpStatus != 200) { return httpStatus; }
+
+    if (contentLength > 0 && (int32_t)freeSpace() < contentLength) {
+      DBG("### Not enough UFS space for", contentLength);
+      return -3;
+    }
+
+    remove();
+    // AT+QHTTPREADFILE=<filename>,<wait_time>, then +QHTTPREADFILE: <err>
+    at->sendAT(GF("+QHTTPREADFILE=\""), filename, GF("\","), timeout_s);
+    if (at->waitResponse() != 1) { return -4; }
+    if (at->waitResponse(timeout_s * 1000L, GF("+QHTTPREADFILE:")) != 1) {
+      return -4;
+    }
+    err = at->stream.readStringUntil('\n').toInt();
+    if (err != 0) {
+      DBG("### QHTTPREADFILE error:", err);
+      return -4;
+    }
+
+    fileSize = getFileSize();
+    if (contentLength >= 0 && fileSize != (uint32_t)contentLength) {
+      DBG("### File size", fileSize, "!= Content-Length", contentLength);
+      return -4;
+    }
+    return httpStatus;
+  }
+
+  // The UART rate, which sizes the deadline of each AT+QFREAD. Call it
+  // again after the modem has been switched to a faster rate.
+  void setBaud(uint32_t rate) {
+    baud = rate ? rate : 115200;
+  }
+
+  int     status() const { return httpStatus; }
+  int32_t httpContentLength() const { return contentLength; }
+
+  /*
+   * File access
+   */
+
+  // Free bytes on UFS
+  uint32_t freeSpace() {
+    at->sendAT(GF("+QFLDS=\"UFS\""));
+    if (at->waitResponse(GF("+QFLDS:")) != 1) { return 0; }
+    uint32_t free = at->stream.readStringUntil(',').toInt();
+    at->streamSkipUntil('\n');
+    at->waitResponse();
+    return free;
+  }
+
+  // Size of the file, 0 if it does not exist
+  uint32_t getFileSize() {
+    at->sendAT(GF("+QFLST=\""), filename, GF("\""));
+    if (waitFileResponse(1000L, GF("+QFLST:")) != 1) { return 0; }
+    at->streamSkipUntil(',');
+    uint32_t size = at->stream.readStringUntil('\n').toInt();
+    at->waitResponse();
+    return size;
+  }
+
+  bool open() {
+    close();
+    fileSize = getFileSize();
+    // Mode 2: read only
+    at->sendAT(GF("+QFOPEN=\""), filename, GF("\",2"));
+    if (waitFileResponse(1000L, GF("+QFOPEN:")) != 1) { return false; }
+    handle = at->stream.readStringUntil('\n').toInt();
+    position = 0;
+    failed   = false;
+    return at->waitResponse() == 1;
+  }
+
+  bool seek(uint32_t offset) {
+    if (handle < 0 || offset > fileSize) { return false; }
+    at->sendAT(GF("+QFSEEK="), handle, ',', offset, GF(",0"));
+    if (at->waitResponse() != 1) { return false; }
+    position = offset;
+    return true;
+  }
+
+  void close() {
+    if (handle < 0) { return; }
+    at->sendAT(GF("+QFCLOSE="), handle);
+    at->waitResponse();
+    handle = -1;
+  }
+
+  bool remove() {
+    close();
+    at->sendAT(GF("+QFDEL=\""), filename, GF("\""));
+    return waitFileResponse(1000L, GFP(GSM_OK)) == 1;
+  }
+
+  uint32_t size() const { return fileSize; }
+  uint32_t tell() const { return position; }
+
+  /*
+   * Client (read side)
+   */
+
+  int available() override {
+    return handle < 0 || failed ? 0 : fileSize - position;
+  }
+
+  // One AT+QFREAD: "CONNECT <n>\r\n" <n bytes> "\r\nOK". After an error
+  // the stream position is unknown, so the file is done with: available()
+  // drops to 0 and connected() to false, and a caller stops at once
+  // instead of waiting out its network timeout.
+  int read(uint8_t* buf, size_t size) override {
+    if (handle < 0 || failed || position >= fileSize || size == 0) {
+      return 0;
+    }
+    uint32_t want = size;
+    if (want > fileSize - position) { want = fileSize - position; }
+    if (want > TINY_GSM_EC200U_QFREAD_MAX) { want = TINY_GSM_EC200U_QFREAD_MAX; }
+
+    at->sendAT(GF("+QFREAD="), handle, ',', want);
+    if (waitFileResponse(5000L, GF("CONNECT ")) != 1) { return fail(); }
+    int len = at->stream.readStringUntil('\n').toInt();
+    if (len < 0 || (uint32_t)len > want) { return fail(); }
+    // Twice the wire time at 10 bits per byte, plus the slack
+    uint32_t timeout = TINY_GSM_EC200U_QFREAD_SLACK +
+        (uint32_t)(2ULL * len * 10000 / baud);
+    size_t got = at->moveBytesFromStream(buf, len, timeout);
+    if (got != (size_t)len) {
+      DBG("### QFREAD short:", got, "of", len);
+      // Let the rest of the payload and its "\r\nOK" go by, so the next
+      // command does not parse file data as responses
+      uint8_t dump[64];
+      size_t  left = len - got;
+      while (left > 0) {
+        size_t n = at->moveBytesFromStream(
+            dump, TinyGsmMin(left, sizeof(dump)), timeout);
+        if (n == 0) { break; }
+        left -= n;
+      }
+      at->waitResponse(timeout);
+      return fail();
+    }
+    at->waitResponse();
+    position += len;
+    return len;
+  }
+
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+
+  int peek() override {
+    return -1;
+  }
+
+  // The download is complete before reading starts, so "connected" means
+  // there is still file left to read
+  uint8_t connected() override {
+    return handle >= 0 && !failed && position < fileSize;
+  }
+
+  operator bool() override {
+    return handle >= 0;
+  }
+
+  void stop() override {
+    close();
+  }
+
+  void flush() override {}
+
+  int connect(IPAddress, uint16_t) override {
+    return 0;
+  }
+  int connect(const char*, uint16_t) override {
+    return 0;
+  }
+  size_t write(uint8_t) override {
+    return 0;
+  }
+  size_t write(const uint8_t*, size_t) override {
+    return 0;
+  }
+
+ protected:
+  // File commands fail with "+CME ERROR: <n>" whatever AT+CMEE says, which
+  // waitResponse() alone only matches in debug builds. Returns 1 for `r1`,
+  // 2 for ERROR, 3 for a +CME ERROR (its code skipped), 0 on timeout.
+  int8_t waitFileResponse(uint32_t timeout_ms, GsmConstStr r1) {
+    int8_t res = at->waitResponse(timeout_ms, r1, GFP(GSM_ERROR),
+                                  GF("+CME ERROR:"));
+    if (res == 3) { at->streamSkipUntil('\n'); }
+    return res;
+  }
+
+  int fail() {
+    failed = true;
+    return -1;
+  }
+
+  TinyGsmEC200U* at;
+  const char*    filename;
+  uint32_t       baud;
+  int32_t        handle;
+  uint32_t       fileSize;
+  uint32_t       position;
+  bool           failed;
+  int            httpStatus;
+  int32_t        contentLength;
+};
+
+#endif  // SRC_TINYGSMEC200UHTTPFILE_H_
@@ -1,6 +1,55 @@
 #ifndef TinyGsmFifo_h
 #define TinyGsmFifo_h
 
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(__AVR__)
+#include <atomic>
+#endif
+
+/**
+ * @brief Index arithmetic for a ring of N slots. Both FIFOs only ever advance
+ * an index by at most N, so a conditional subtract replaces the division;
+ * power-of-two sizes reduce to a mask.
+ */
+template <unsigned N, bool Pow2 = ((N & (N - 1)) == 0)>
+struct TinyGsmFifoIndex {
+  static inline int inc(int i, int n) {
+    i += n;
+    return i >= static_cast<int>(N) ? i - static_cast<int>(N) : i;
+  }
+};
+
+template <unsigned N>
+struct TinyGsmFifoIndex<N, true> {
+  static inline int inc(int i, int n) {
+    return (i + n) & static_cast<int>(N - 1);
+  }
+};
+
+/**
+ * @brief Contiguous regions of a FIFO handed out by writeSpan()/readSpan().
+ * When the free space or the data wraps around the end of the buffer, the
+ * rest continues in the second region at the start of the buffer.
+ */
+template <class T>
+struct TinyGsmFifoSpan {
+  T*  first;       /// First region
+  int firstSize;   /// Items in the first region
+  T*  second;      /// Region after the wrap, or empty
+  int secondSize;  /// Items in the second region
+
+  int size() const {
+    return firstSize + secondSize;
+  }
+};
+
+/**
+ * @brief Ring buffer for one context. See TinyGsmSpscFifo for a version that
+ * may be filled and drained from two threads/contexts at once.
+ */
 template <class T, unsigned N>
 class TinyGsmFifo {
  public:
@@ -87,7 +136,7 @@ class TinyGsmFifo {
       int m = N - w;
       // check wrap
       if (f > m) f = m;
-      memcpy(&_b[w], p, f);
+      memcpy(&_b[w], p, f * sizeof(T));
       _w = _inc(w, f);
       c -= f;
       p += f;
@@ -95,6 +144,25 @@ class TinyGsmFifo {
     return n - c;
   }
 
+  /**
+   * @brief The free space, to be filled in place (e.g. by Stream::readBytes)
+   * and then published with commitWrite().
+   *
+   * @return *TinyGsmFifoSpan<T>* Up to two regions of free positions
+   */
+  TinyGsmFifoSpan<T> writeSpan(void) {
+    return _span(_w, free());
+  }
+
+  /**
+   * @brief Add the first n items of the last writeSpan() to the buffer.
+   *
+   * @param n Number of items written, at most writeSpan().size()
+   */
+  void commitWrite(int n) {
+    _w = _inc(_w, n);
+  }
+
   // reading thread/context API
   // --------------------------------------------------------
 
@@ -134,7 +202,7 @@ class TinyGsmFifo {
       int m = N - r;
       // check wrap
       if (f > m) f = m;
-      memcpy(p, &_b[r], f);
+      memcpy(p, &_b[r], f * sizeof(T));
       _r = _inc(r, f);
       c -= f;
       p += f;
@@ -142,6 +210,25 @@ class TinyGsmFifo {
     return n - c;
   }
 
+  /**
+   * @brief The buffered items in place, to be consumed without copying them
+   * out and then released with commitRead().
+   *
+   * @return *TinyGsmFifoSpan<T>* Up to two regions of buffered items
+   */
+  TinyGsmFifoSpan<T> readSpan(void) {
+    return _span(_r, size());
+  }
+
+  /**
+   * @brief Remove the first n items of the last readSpan() from the buffer.
+   *
+   * @param n Number of items consumed, at most readSpan().size()
+   */
+  void commitRead(int n) {
+    _r = _inc(_r, n);
+  }
+
   uint8_t peek() {
     return _b[_r];
   }
@@ -156,7 +243,16 @@ class TinyGsmFifo {
    * @return *int*
    */
   int _inc(int i, int n = 1) {
-    return (i + n) % N;
+    return TinyGsmFifoIndex<N>::inc(i, n);
+  }
+
+  TinyGsmFifoSpan<T> _span(int i, int n) {
+    TinyGsmFifoSpan<T> s;
+    s.first      = &_b[i];
+    s.firstSize  = n < static_cast<int>(N) - i ? n : N - i;
+    s.second     = _b;
+    s.secondSize = n - s.firstSize;
+    return s;
   }
 
   T   _b[N];  /// The buffer, containing 'N' items of type 'T'
@@ -164,4 +260,155 @@ class TinyGsmFifo {
   int _r;     /// The read position in the buffer
 };
 
+#if !defined(__AVR__)
+/**
+ * @brief Single-producer/single-consumer ring buffer with the same API as
+ * TinyGsmFifo. One thread/context (e.g. a UART reader task or ISR) may call
+ * the writing API while another calls the reading API, without locks: each
+ * side owns one index and publishes it with release ordering, and the other
+ * side reads it with acquire ordering, so the items are visible before the
+ * index that covers them. clear() is only safe while neither side is active.
+ *
+ * Not available on AVR, which has no <atomic>.
+ */
+template <class T, unsigned N>
+class TinyGsmSpscFifo {
+ public:
+  TinyGsmSpscFifo() {
+    clear();
+  }
+
+  void clear() {
+    _r.store(0, std::memory_order_relaxed);
+    _w.store(0, std::memory_order_release);
+  }
+
+  // writing thread/context API
+  //-------------------------------------------------------------
+
+  bool writeable(void) {
+    return free() > 0;
+  }
+
+  int free(void) {
+    int s = _r.load(std::memory_order_acquire) -
+        _w.load(std::memory_order_relaxed);
+    if (s <= 0) s += N;
+    return s - 1;
+  }
+
+  bool put(const T& c) {
+    int w = _w.load(std::memory_order_relaxed);
+    int i = _inc(w);
+    if (i == _r.load(std::memory_order_acquire)) return false;
+    _b[w] = c;
+    _w.store(i, std::memory_order_release);
+    return true;
+  }
+
+  int put(const T* p, int n, bool t = false) {
+    int c = n;
+    while (c) {
+      int f;
+      while ((f = free()) == 0) {
+        if (!t) return n - c;
+      }
+      if (c < f) f = c;
+      int w = _w.load(std::memory_order_relaxed);
+      int m = N - w;
+      if (f > m) f = m;
+      memcpy(&_b[w], p, f * sizeof(T));
+      _w.store(_inc(w, f), std::memory_order_release);
+      c -= f;
+      p += f;
+    }
+    return n - c;
+  }
+
+  TinyGsmFifoSpan<T> writeSpan(void) {
+    return _span(_w.load(std::memory_order_relaxed), free());
+  }
+
+  void commitWrite(int n) {
+    _w.store(_inc(_w.load(std::memory_order_relaxed), n),
+             std::memory_order_release);
+  }
+
+  // reading thread/context API
+  // --------------------------------------------------------
+
+  bool readable(void) {
+    return _r.load(std::memory_order_relaxed) !=
+        _w.load(std::memory_order_acquire);
+  }
+
+  size_t size(void) {
+    int s = _w.load(std::memory_order_acquire) -
+        _r.load(std::memory_order_relaxed);
+    if (s < 0) s += N;
+    return s;
+  }
+
+  bool get(T* p) {
+    int r = _r.load(std::memory_order_relaxed);
+    if (r == _w.load(std::memory_order_acquire)) return false;
+    *p = _b[r];
+    _r.store(_inc(r), std::memory_order_release);
+    return true;
+  }
+
+  int get(T* p, int n, bool t = false) {
+    int c = n;
+    while (c) {
+      int f;
+      for (;;) {
+        f = size();
+        if (f) break;
+        if (!t) return n - c;
+      }
+      if (c < f) f = c;
+      int r = _r.load(std::memory_order_relaxed);
+      int m = N - r;
+      if (f > m) f = m;
+      memcpy(p, &_b[r], f * sizeof(T));
+      _r.store(_inc(r, f), std::memory_order_release);
+      c -= f;
+      p += f;
+    }
+    return n - c;
+  }
+
+  TinyGsmFifoSpan<T> readSpan(void) {
+    return _span(_r.load(std::memory_order_relaxed), size());
+  }
+
+  void commitRead(int n) {
+    _r.store(_inc(_r.load(std::memory_order_relaxed), n),
+             std::memory_order_release);
+  }
+
+  uint8_t peek() {
+    return _b[_r.load(std::memory_order_relaxed)];
+  }
+
+ private:
+  int _inc(int i, int n = 1) {
+    return TinyGsmFifoIndex<N>::inc(i, n);
+  }
+
+  TinyGsmFifoSpan<T> _span(int i, int n) {
+    TinyGsmFifoSpan<T> s;
+    s.first      = &_b[i];
+    s.firstSize  = n < static_cast<int>(N) - i ? n : N - i;
+    s.second     = _b;
+    s.secondSize = n - s.firstSize;
+    return s;
+  }
+
+  T                _b[N];  /// The buffer, containing 'N' items of type 'T'
+  std::atomic<int> _w;     /// The write position, owned by the producer
+  std::atomic<int> _r;     /// The read position, owned by the consumer
+};
+#endif
+
 #endif
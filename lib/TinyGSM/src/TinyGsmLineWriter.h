@@ -0,0 +1,77 @@
+#ifndef TinyGsmLineWriter_h
+#define TinyGsmLineWriter_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "TinyGsmCommon.h"
+
+// Stack space sendAT() formats a command line in; longer lines go out in
+// pieces of this size
+#ifndef TINY_GSM_AT_BUFFER
+#if defined(__AVR__)
+#define TINY_GSM_AT_BUFFER 64
+#else
+#define TINY_GSM_AT_BUFFER 128
+#endif
+#endif
+
+/**
+ * @brief Collects a command line in an N-byte buffer and hands it to the
+ * stream in one write().
+ *
+ * It is a Print, so each argument formats through the same print()
+ * overload stream.print() would pick and comes out byte for byte the same;
+ * only the UART driver sees one call instead of one per argument (and per
+ * digit group, for numbers). A line longer than N is written as soon as
+ * the buffer fills, in N-byte pieces.
+ */
+template <size_t N>
+class TinyGsmLineWriter : public Print {
+ public:
+  explicit TinyGsmLineWriter(Stream& stream) : out(stream), len(0) {}
+
+  size_t write(uint8_t c) override {
+    if (len == N) send();
+    buf[len++] = c;
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t size) override {
+    size_t left = size;
+    while (left) {
+      if (len == N) send();
+      size_t n = TinyGsmMin(left, N - len);
+      memcpy(buf + len, data, n);
+      len += n;
+      data += n;
+      left -= n;
+    }
+    return size;
+  }
+  using Print::write;
+
+  // Formats the arguments in order, as stream.print() on each would
+  template <typename T>
+  void add(T last) {
+    print(last);
+  }
+  template <typename T, typename... Args>
+  void add(T head, Args... tail) {
+    print(head);
+    add(tail...);
+  }
+
+  // Writes what has been collected
+  void send() {
+    if (len) out.write(buf, len);
+    len = 0;
+  }
+
+ private:
+  Stream& out;
+  uint8_t buf[N];
+  size_t  len;
+};
+
+#endif
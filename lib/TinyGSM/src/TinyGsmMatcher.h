@@ -0,0 +1,121 @@
+#ifndef TinyGsmMatcher_h
+#define TinyGsmMatcher_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "TinyGsmCommon.h"
+
+#ifndef TINY_GSM_MATCH_MAX
+#define TINY_GSM_MATCH_MAX 32
+#endif
+
+/**
+ * @brief Reads character i of a response string, from flash on AVR.
+ */
+inline char TinyGsmPatternChar(GsmConstStr s, size_t i) {
+#if defined(__AVR__) && !defined(__AVR_ATmega4809__)
+  return pgm_read_byte(reinterpret_cast<const char*>(s) + i);
+#else
+  return s[i];
+#endif
+}
+
+/**
+ * @brief Tells, one received byte at a time, whether the input now ends
+ * with one of up to N response strings.
+ *
+ * Each string gets a KMP automaton: its state is how much of the string the
+ * input currently ends with, and on a mismatch the failure table falls back
+ * to the longest shorter prefix that still fits, so a byte costs a step or
+ * two per string however long the response grows. Nothing of the input is
+ * kept. The tables are built in add() from the strings waitResponse() was
+ * given, which are runtime arguments (flash on AVR), at a cost linear in
+ * their length.
+ *
+ * Strings longer than TINY_GSM_MATCH_MAX are matched on their last
+ * TINY_GSM_MATCH_MAX characters.
+ */
+template <uint8_t N>
+class TinyGsmMatcher {
+ public:
+  TinyGsmMatcher() : count(0) {}
+
+  /**
+   * @brief Adds the string for the next slot (1-based, in the order added).
+   * A null string takes its slot but never matches.
+   */
+  void add(GsmConstStr s) {
+    if (count >= N) return;
+    Pattern& p = patterns[count++];
+    p.text  = s;
+    p.len   = 0;
+    p.state = 0;
+    if (!s) return;
+    size_t len = 0;
+    while (TinyGsmPatternChar(s, len)) len++;
+    if (len > TINY_GSM_MATCH_MAX) {
+      p.text = reinterpret_cast<GsmConstStr>(
+          reinterpret_cast<const char*>(s) + len - TINY_GSM_MATCH_MAX);
+      len = TINY_GSM_MATCH_MAX;
+    }
+    p.len = static_cast<uint8_t>(len);
+    if (!len) return;
+    // fail[i]: length of the longest proper prefix of text[0..i] that is
+    // also its suffix
+    p.fail[0] = 0;
+    uint8_t k = 0;
+    for (uint8_t i = 1; i < p.len; i++) {
+      char c = TinyGsmPatternChar(p.text, i);
+      while (k > 0 && TinyGsmPatternChar(p.text, k) != c) k = p.fail[k - 1];
+      if (TinyGsmPatternChar(p.text, k) == c) k++;
+      p.fail[i] = k;
+    }
+  }
+
+  /**
+   * @brief Advances every string by one input byte. Returns the lowest slot
+   * whose string the input now ends with, or 0.
+   */
+  uint8_t feed(char c) {
+    uint8_t found = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      Pattern& p = patterns[i];
+      if (!p.text) continue;
+      if (!p.len) {
+        if (!found) found = i + 1;  // "" ends every input
+        continue;
+      }
+      uint8_t s = p.state;
+      while (s > 0 && TinyGsmPatternChar(p.text, s) != c) s = p.fail[s - 1];
+      if (TinyGsmPatternChar(p.text, s) == c) s++;
+      if (s == p.len) {
+        if (!found) found = i + 1;
+        s = p.fail[s - 1];
+      }
+      p.state = s;
+    }
+    return found;
+  }
+
+  /**
+   * @brief Forgets the input seen so far, as after the response buffer has
+   * been cleared.
+   */
+  void reset() {
+    for (uint8_t i = 0; i < count; i++) patterns[i].state = 0;
+  }
+
+ private:
+  struct Pattern {
+    GsmConstStr text;
+    uint8_t     len;
+    uint8_t     state;
+    uint8_t     fail[TINY_GSM_MATCH_MAX];
+  };
+
+  Pattern patterns[N];
+  uint8_t count;
+};
+
+#endif
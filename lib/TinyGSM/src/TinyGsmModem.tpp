@@ -10,6 +10,9 @@
 #define SRC_TINYGSMMODEM_H_
 
 #include "TinyGsmCommon.h"
+#include "TinyGsmLineWriter.h"
+#include "TinyGsmMatcher.h"
+#include "TinyGsmResponse.h"
 
 #ifndef AT_NL
 #define AT_NL "\r\n"
@@ -84,12 +87,18 @@ class TinyGsmModem {
   /**
    * @brief Recursive variadic template to send AT commands
    *
+   * The line is formatted on the stack and written to the stream in one
+   * call (see TinyGsmLineWriter.h), then flushed, so the caller's reply
+   * timeout starts once the command has left the UART.
+   *
    * @tparam Args
    * @param cmd The commands to send
    */
   template <typename... Args>
   inline void sendAT(Args... cmd) {
-    thisModem().streamWrite("AT", cmd..., AT_NL);
+    TinyGsmLineWriter<TINY_GSM_AT_BUFFER> line(thisModem().stream);
+    line.add("AT", cmd..., AT_NL);
+    line.send();
     thisModem().stream.flush();
     TINY_GSM_YIELD(); /* DBG("### AT:", cmd...); */
   }
@@ -172,8 +181,16 @@ class TinyGsmModem {
                       GsmConstStr r2 = GFP(GSM_ERROR), GsmConstStr r3 = nullptr,
                       GsmConstStr r4 = nullptr, GsmConstStr r5 = nullptr,
                       GsmConstStr r6 = nullptr, GsmConstStr r7 = nullptr) {
+#if defined TINY_GSM_MODEM_HAS_RESPONSE_BUFFER
+    // Nobody reads this reply: collect it in the modem's own buffer instead
+    // of a String on the heap
+    response_buf.clear();
+    return thisModem().waitResponseImpl(timeout_ms, response_buf, r1, r2, r3,
+                                        r4, r5, r6, r7);
+#else
     String data;
     return waitResponse(timeout_ms, data, r1, r2, r3, r4, r5, r6, r7);
+#endif
   }
 
   /**
@@ -457,7 +474,7 @@ class TinyGsmModem {
     uint32_t startMillis   = millis();
     while (millis() - startMillis < timeout_ms &&
            (numCharsReady = thisModem().stream.available()) < numChars) {
-      TINY_GSM_YIELD();
+      TINY_GSM_WAIT_RX(TinyGsmTimeLeft(startMillis, timeout_ms));
     }
 
     if (numCharsReady >= numChars) {
@@ -523,7 +540,7 @@ class TinyGsmModem {
     while (millis() - startMillis < timeout_ms) {
       while (millis() - startMillis < timeout_ms &&
              !thisModem().stream.available()) {
-        TINY_GSM_YIELD();
+        TINY_GSM_WAIT_RX(TinyGsmTimeLeft(startMillis, timeout_ms));
       }
       if (thisModem().stream.read() == c) { return true; }
     }
@@ -587,8 +604,21 @@ class TinyGsmModem {
     return false;
   }
 
+  // Modems that carry socket data inside URCs return true (and reset) once
+  // a URC has put data into a socket's FIFO
+  bool urcDeliveredData() {
+    return false;
+  }
+
+  // Whether a URC the modem handles can end its trigger string with c;
+  // handleURCs() only looks at the response after such a byte
+  bool urcCanEndWith(char) {
+    return true;
+  }
+
   // TODO(vshymanskyy): Optimize this!
-  int8_t waitResponseImpl(uint32_t timeout_ms, String& data,
+  template <typename Response>
+  int8_t waitResponseImpl(uint32_t timeout_ms, Response& data,
                           GsmConstStr r1 = GFP(GSM_OK),
                           GsmConstStr r2 = GFP(GSM_ERROR),
                           GsmConstStr r3 = nullptr, GsmConstStr r4 = nullptr,
@@ -601,41 +631,41 @@ class TinyGsmModem {
         GF("> r3 <"), r3 ? r3 : GF("NULL"), GF("> r4 <"), r4 ? r4 : GF("NULL"),
         GF("> r5 <"), r5 ? r5 : GF("NULL"), GF("> r6 <"), r6 ? r6 : GF("NULL"),
         GF("> r7 <"), r7 ? r7 : GF("NULL"), '>');
+#endif
+#if defined TINY_GSM_DEBUG
+    TinyGsmMatcher<9> matcher;
+#else
+    TinyGsmMatcher<7> matcher;
+#endif
+    matcher.add(r1);
+    matcher.add(r2);
+    matcher.add(r3);
+    matcher.add(r4);
+    matcher.add(r5);
+    matcher.add(r6);
+    matcher.add(r7);
+#if defined TINY_GSM_DEBUG
+    matcher.add(GFP(GSM_VERBOSE));
+    matcher.add(GFP(GSM_VERBOSE_2));
 #endif
     uint8_t  index       = 0;
     uint32_t startMillis = millis();
     do {
-      TINY_GSM_YIELD();
+      if (thisModem().stream.available() <= 0) {
+        TINY_GSM_WAIT_RX(TinyGsmTimeLeft(startMillis, timeout_ms));
+      }
       while (thisModem().stream.available() > 0) {
         TINY_GSM_YIELD();
         int8_t a = thisModem().stream.read();
         if (a <= 0) continue;  // Skip 0x00 bytes, just in case
         data += static_cast<char>(a);
-        if (r1 && data.endsWith(r1)) {
-          index = 1;
-          goto finish;
-        } else if (r2 && data.endsWith(r2)) {
-          index = 2;
-          goto finish;
-        } else if (r3 && data.endsWith(r3)) {
-          index = 3;
-          goto finish;
-        } else if (r4 && data.endsWith(r4)) {
-          index = 4;
-          goto finish;
-        } else if (r5 && data.endsWith(r5)) {
-          index = 5;
-          goto finish;
-        } else if (r6 && data.endsWith(r6)) {
-          index = 6;
-          goto finish;
-        } else if (r7 && data.endsWith(r7)) {
-          index = 7;
+        uint8_t hit = matcher.feed(static_cast<char>(a));
+        if (hit >= 1 && hit <= 7) {
+          index = hit;
           goto finish;
         }
 #if defined TINY_GSM_DEBUG
-        else if (data.endsWith(GFP(GSM_VERBOSE)) ||
-                 data.endsWith(GFP(GSM_VERBOSE_2))) {
+        else if (hit) {  // GSM_VERBOSE or GSM_VERBOSE_2
           // check how long the new line is
           // should be either 1 ('\r' or '\n') or 2 ("\r\n"))
           int len_atnl = strnlen(AT_NL, 3);
@@ -650,8 +680,13 @@ class TinyGsmModem {
           goto finish;
         }
 #endif
-        else if (thisModem().handleURCs(data)) {
+        else if (thisModem().urcCanEndWith(static_cast<char>(a)) &&
+                 thisModem().handleURCs(data)) {
           data = "";
+          matcher.reset();
+          // Only listening for URCs: hand socket data one carried to the
+          // client before reading on
+          if (!r1 && !r2 && thisModem().urcDeliveredData()) { goto finish; }
         }
       }
     } while (millis() - startMillis < timeout_ms);
@@ -798,6 +833,17 @@ class TinyGsmModem {
     if (thisModem().waitResponse() != 1) { return ""; }
     return res;
   }
+
+#if defined TINY_GSM_MODEM_HAS_RESPONSE_BUFFER
+ public:
+  // Reply characters the response buffer had no room for, since start-up
+  uint32_t responseBytesDropped() const {
+    return response_buf.droppedBytes();
+  }
+
+ protected:
+  TinyGsmResponseBuffer<TINY_GSM_RESPONSE_BUFFER> response_buf;
+#endif
 };
 
 #endif  // SRC_TINYGSMMODEM_H_
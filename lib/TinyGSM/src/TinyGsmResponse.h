@@ -0,0 +1,118 @@
+#ifndef TinyGsmResponse_h
+#define TinyGsmResponse_h
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "TinyGsmMatcher.h"
+
+#ifndef TINY_GSM_RESPONSE_BUFFER
+#define TINY_GSM_RESPONSE_BUFFER 64
+#endif
+
+/**
+ * @brief Fixed-capacity stand-in for the String waitResponseImpl() collects
+ * a reply in, for the waitResponse() overloads whose caller never sees it.
+ *
+ * Only the end of a reply matters there: URC handlers look at how it ends,
+ * and a debug build prints what was left unhandled. When the buffer is full
+ * the older half is dropped and counted, so it always holds at least the
+ * last N/2 characters. It provides the part of String's interface that
+ * waitResponseImpl() and the modems' handleURCs() use.
+ */
+template <size_t N>
+class TinyGsmResponseBuffer : public Printable {
+ public:
+  TinyGsmResponseBuffer() : len(0), dropped(0) {
+    buf[0] = '\0';
+  }
+
+  void reserve(unsigned int) {}
+
+  TinyGsmResponseBuffer& operator+=(char c) {
+    if (len == N) {
+      memmove(buf, buf + N / 2, N - N / 2);
+      len = N - N / 2;
+      dropped += N / 2;
+    }
+    buf[len++] = c;
+    buf[len]   = '\0';
+    return *this;
+  }
+  TinyGsmResponseBuffer& operator+=(const String& s) {
+    for (unsigned int i = 0; i < s.length(); i++) *this += s[i];
+    return *this;
+  }
+  TinyGsmResponseBuffer& operator=(const char* s) {
+    clear();
+    while (s && *s) *this += *s++;
+    return *this;
+  }
+
+  void clear() {
+    len    = 0;
+    buf[0] = '\0';
+  }
+
+  bool endsWith(GsmConstStr s) const {
+    size_t n = 0;
+    while (TinyGsmPatternChar(s, n)) n++;
+    if (n > len) return false;
+    for (size_t i = 0; i < n; i++) {
+      if (buf[len - n + i] != TinyGsmPatternChar(s, i)) return false;
+    }
+    return true;
+  }
+
+  // Leading and trailing whitespace, as String::trim()
+  void trim() {
+    size_t begin = 0;
+    while (begin < len && isspace(static_cast<unsigned char>(buf[begin])))
+      begin++;
+    while (len > begin && isspace(static_cast<unsigned char>(buf[len - 1])))
+      len--;
+    len -= begin;
+    memmove(buf, buf + begin, len);
+    buf[len] = '\0';
+  }
+
+  // Replaces each `from` character with `to`, as far as there is room
+  void replace(const char* from, const char* to) {
+    if (!from || strlen(from) != 1 || !to) return;
+    char   copy[N + 1];
+    size_t n = len;
+    memcpy(copy, buf, n);
+    clear();
+    for (size_t i = 0; i < n; i++) {
+      if (copy[i] != *from) {
+        *this += copy[i];
+        continue;
+      }
+      for (const char* t = to; *t && len < N; t++) *this += *t;
+    }
+  }
+
+  unsigned int length() const {
+    return len;
+  }
+  const char* c_str() const {
+    return buf;
+  }
+  // Characters dropped from the front of full buffers, ever
+  uint32_t droppedBytes() const {
+    return dropped;
+  }
+
+  size_t printTo(Print& p) const override {
+    return p.write(reinterpret_cast<const uint8_t*>(buf), len);
+  }
+
+ private:
+  char     buf[N + 1];
+  size_t   len;
+  uint32_t dropped;
+};
+
+#endif
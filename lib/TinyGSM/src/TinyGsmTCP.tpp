@@ -19,6 +19,38 @@
 #define TINY_GSM_RX_BUFFER 64
 #endif
 
+// Modems with a direct read (TINY_GSM_MODEM_HAS_DIRECT_READ) deliver reads
+// of at least this many bytes straight into the caller's buffer when the
+// FIFO is empty
+#if !defined(TINY_GSM_DIRECT_READ_MIN)
+#define TINY_GSM_DIRECT_READ_MIN 64
+#endif
+
+// Define TINY_GSM_TX_BUFFER (bytes) to gather small client writes and send
+// them with one modemSend() instead of one per write() call
+#if !defined(TINY_GSM_TX_BUFFER)
+#define TINY_GSM_TX_BUFFER 0
+#endif
+
+// Define TINY_GSM_URC_NOTIFY to let buffer-read modems trust their "data
+// arrived" and "closed" URCs instead of asking every 500 ms whether data
+// came in unannounced. An idle socket is still checked every
+// TINY_GSM_URC_CHECK_MAX ms; a check that finds data no URC announced
+// counts as a lost URC and drops the interval to TINY_GSM_URC_CHECK_MIN,
+// from where it doubles back with every check that finds nothing.
+#if !defined(TINY_GSM_URC_CHECK_MIN)
+#define TINY_GSM_URC_CHECK_MIN 500
+#endif
+#if !defined(TINY_GSM_URC_CHECK_MAX)
+#define TINY_GSM_URC_CHECK_MAX 10000
+#endif
+
+// Define TINY_GSM_RX_FIFO_SPSC when the socket FIFOs are filled from a
+// different task than the one reading the client (see TinyGsmSpscFifo)
+#if defined(TINY_GSM_RX_FIFO_SPSC) && defined(__AVR__)
+#error "TINY_GSM_RX_FIFO_SPSC needs <atomic>, which AVR does not have"
+#endif
+
 // Because of the ordering of resolution of overrides in templates, these need
 // to be written out every time.  This macro is to shorten that.
 #define TINY_GSM_CLIENT_CONNECT_OVERRIDES                             \
@@ -75,7 +107,11 @@ class TinyGsmTCP {
   class GsmClient : public Client {
     // Make all classes created from the modem template friends
     friend class TinyGsmTCP<modemType, muxCount>;
+#if defined(TINY_GSM_RX_FIFO_SPSC)
+    typedef TinyGsmSpscFifo<uint8_t, TINY_GSM_RX_BUFFER> RxFifo;
+#else
     typedef TinyGsmFifo<uint8_t, TINY_GSM_RX_BUFFER> RxFifo;
+#endif
 
    public:
     // bool init(modemType* modem, uint8_t);
@@ -112,6 +148,81 @@ class TinyGsmTCP {
     //   stop(15000L);
     // }
 
+#if TINY_GSM_TX_BUFFER > 0
+    // Gathers writes in the send buffer, which goes out as one modemSend()
+    // when it fills, on flush(), before the next read and before stop().
+    // A write at least as large as the buffer is sent directly once
+    // anything gathered before it has gone.
+    size_t write(const uint8_t* buf, size_t size) override {
+      TINY_GSM_YIELD();
+      if (tx_failed) return 0;
+      tx_writes++;
+      size_t done = 0;
+      while (done < size) {
+        if (tx_len == 0 && size - done >= TINY_GSM_TX_BUFFER) {
+          return done + sendNow(buf + done, size - done);
+        }
+        size_t n = TinyGsmMin(size - done,
+                              (size_t)(TINY_GSM_TX_BUFFER - tx_len));
+        memcpy(tx_buf + tx_len, buf + done, n);
+        tx_len += n;
+        done += n;
+        if (tx_len == TINY_GSM_TX_BUFFER) {
+          size_t earlier = tx_len - n;  // gathered by previous calls
+          size_t sent    = sendTx();
+          if (sent < TINY_GSM_TX_BUFFER) {
+            // Only what reached the modem counts as written
+            return done - n + (sent > earlier ? sent - earlier : 0);
+          }
+        }
+      }
+      return done;
+    }
+
+    // Sends whatever the buffer has gathered; false if the modem has
+    // refused any of it since the socket was opened
+    bool flushTx() {
+      sendTx();
+      return !tx_failed;
+    }
+
+    // Empties the buffer into one modemSend(); returns the bytes it took
+    size_t sendTx() {
+      if (!tx_len) return 0;
+      size_t sent = sendNow(tx_buf, tx_len);
+      tx_len      = 0;
+      return sent;
+    }
+
+    // One modemSend(); returns the bytes it took. Bytes the modem did not
+    // take cannot be sent again in order, so the peer never gets the whole
+    // request: the socket then counts as closed until stop(), and
+    // connected(), available() and read() say so at once rather than after
+    // the caller's network timeout.
+    size_t sendNow(const uint8_t* buf, size_t len) {
+      at->maintain();
+      tx_sends++;
+      int16_t sent = at->modemSend(buf, len, mux);
+      size_t  took = sent > 0 ? sent : 0;
+      if (took < len) {
+        DBG("### SEND short:", took, "of", len, "on", mux);
+        tx_failed      = true;
+        sock_connected = false;
+      }
+      return took;
+    }
+
+    // write() calls made, modemSend() calls they took, and the difference
+    uint32_t txWrites() const {
+      return tx_writes;
+    }
+    uint32_t txSends() const {
+      return tx_sends;
+    }
+    uint32_t txSendsSaved() const {
+      return tx_writes > tx_sends ? tx_writes - tx_sends : 0;
+    }
+#else
     // Writes data out on the client using the modem send functionality
     size_t write(const uint8_t* buf, size_t size) override {
       TINY_GSM_YIELD();
@@ -119,6 +230,11 @@ class TinyGsmTCP {
       return at->modemSend(buf, size, mux);
     }
 
+    bool flushTx() {
+      return true;
+    }
+#endif
+
     size_t write(uint8_t c) override {
       return write(&c, 1);
     }
@@ -130,6 +246,7 @@ class TinyGsmTCP {
 
     int available() override {
       TINY_GSM_YIELD();
+      if (!flushTx()) return 0;
 #if defined TINY_GSM_NO_MODEM_BUFFER
       // Returns the number of characters available in the TinyGSM fifo
       if (!rx.size() && sock_connected) { at->maintain(); }
@@ -146,12 +263,7 @@ class TinyGsmTCP {
       // fifo and the modem chips internal fifo, doing an extra check-in
       // with the modem to see if anything has arrived without a UURC.
       if (!rx.size()) {
-        if (millis() - prev_check > 500) {
-          // setting got_data to true will tell maintain to run
-          // modemGetAvailable(mux)
-          got_data   = true;
-          prev_check = millis();
-        }
+        scheduleCheck();
         at->maintain();
       }
       return static_cast<uint16_t>(rx.size()) + sock_available;
@@ -163,6 +275,7 @@ class TinyGsmTCP {
 
     int read(uint8_t* buf, size_t size) override {
       TINY_GSM_YIELD();
+      if (!flushTx()) return -1;
       size_t cnt = 0;
 
 #if defined TINY_GSM_NO_MODEM_BUFFER
@@ -192,9 +305,20 @@ class TinyGsmTCP {
           buf += chunk;
           cnt += chunk;
           continue;
-        } /* TODO: Read directly into user buffer? */
+        }
         at->maintain();
         if (sock_available > 0) {
+#if defined TINY_GSM_MODEM_HAS_DIRECT_READ
+          // The FIFO is empty: a large enough request skips it
+          if (size - cnt >= TINY_GSM_DIRECT_READ_MIN) {
+            size_t n = at->modemReadDirect(
+                buf, TinyGsmMin(size - cnt, (size_t)sock_available), mux);
+            if (n == 0) break;
+            buf += n;
+            cnt += n;
+            continue;
+          }
+#endif
           int n = at->modemRead(TinyGsmMin((uint16_t)rx.free(), sock_available),
                                 mux);
           if (n == 0) break;
@@ -217,16 +341,20 @@ class TinyGsmTCP {
           cnt += chunk;
           continue;
         }
-        // Workaround: Some modules "forget" to notify about data arrival
-        if (millis() - prev_check > 500) {
-          // setting got_data to true will tell maintain to run
-          // modemGetAvailable()
-          got_data   = true;
-          prev_check = millis();
-        }
-        // TODO(vshymanskyy): Read directly into user buffer?
+        scheduleCheck();
         at->maintain();
         if (sock_available > 0) {
+#if defined TINY_GSM_MODEM_HAS_DIRECT_READ
+          // The FIFO is empty: a large enough request skips it
+          if (size - cnt >= TINY_GSM_DIRECT_READ_MIN) {
+            size_t n = at->modemReadDirect(
+                buf, TinyGsmMin(size - cnt, (size_t)sock_available), mux);
+            if (n == 0) break;
+            buf += n;
+            cnt += n;
+            continue;
+          }
+#endif
           int n = at->modemRead(TinyGsmMin((uint16_t)rx.free(), sock_available),
                                 mux);
           if (n == 0) break;
@@ -247,15 +375,52 @@ class TinyGsmTCP {
       return -1;
     }
 
+    /*
+     * Zero-copy reads: readSpan() points data at the next contiguous run of
+     * received bytes inside the RX FIFO, pulling from the modem first if the
+     * FIFO is empty, and returns its length (0 if nothing has arrived).
+     * The bytes stay valid until commitRead() releases the first n of them.
+     * Don't call read() in between.
+     */
+    size_t readSpan(const uint8_t** data) {
+      TINY_GSM_YIELD();
+      if (!flushTx()) {
+        *data = nullptr;
+        return 0;
+      }
+#if defined TINY_GSM_NO_MODEM_BUFFER
+      if (!rx.size() && sock_connected) { at->maintain(); }
+#else
+      if (!rx.size()) {
+#if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
+        scheduleCheck();
+#endif
+        at->maintain();
+        if (!rx.size() && sock_available > 0) {
+          at->modemRead(TinyGsmMin((uint16_t)rx.free(), sock_available), mux);
+        }
+      }
+#endif
+      TinyGsmFifoSpan<uint8_t> span = rx.readSpan();
+      *data                         = span.first;
+      return span.firstSize;
+    }
+
+    void commitRead(size_t n) {
+      rx.commitRead(n);
+    }
+
     int peek() override {
       return (uint8_t)rx.peek();
     }
 
     void flush() override {
+      flushTx();
       at->stream.flush();
     }
 
     uint8_t connected() override {
+      if (!flushTx()) { return false; }
       if (available()) { return true; }
 #if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
       // If the modem is one where we can read and check the size of the buffer,
@@ -284,7 +449,52 @@ class TinyGsmTCP {
 
     String remoteIP() TINY_GSM_ATTR_NOT_IMPLEMENTED;
 
+#if defined TINY_GSM_URC_NOTIFY
+    // Checks for unannounced data made, and how many found some
+    uint32_t urcChecks() const {
+      return urc_checks;
+    }
+    uint32_t urcMisses() const {
+      return urc_misses;
+    }
+#endif
+
    protected:
+#if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
+    // Has maintain() ask the modem for data that may have arrived without
+    // a URC once the check interval has passed
+    void scheduleCheck() {
+#if defined TINY_GSM_URC_NOTIFY
+      if (millis() - prev_check > check_interval) {
+        check_due  = true;
+        prev_check = millis();
+      }
+#else
+      // Workaround: Some modules "forget" to notify about data arrival
+      if (millis() - prev_check > 500) {
+        // setting got_data to true will tell maintain to run
+        // modemGetAvailable(mux)
+        got_data   = true;
+        prev_check = millis();
+      }
+#endif
+    }
+#endif
+
+#if defined TINY_GSM_URC_NOTIFY
+    // Adapts the check interval to what a check found
+    void checkDone(bool found) {
+      urc_checks++;
+      if (found) {
+        urc_misses++;
+        check_interval = TINY_GSM_URC_CHECK_MIN;
+      } else {
+        check_interval = TinyGsmMin((uint32_t)(check_interval * 2),
+                                    (uint32_t)TINY_GSM_URC_CHECK_MAX);
+      }
+    }
+#endif
+
     // Read and dump anything remaining in the modem's internal buffer.
     // Using this in the client stop() function.
     // The socket will appear open in response to connected() even after it
@@ -292,6 +502,14 @@ class TinyGsmTCP {
     // Doing it this way allows the external mcu to find and get all of the
     // data that it wants from the socket even if it was closed externally.
     inline void dumpModemBuffer(uint32_t maxWaitMs) {
+      // Gathered writes still go out before the socket closes
+      if (sock_connected) {
+        flushTx();
+      }
+#if TINY_GSM_TX_BUFFER > 0
+      tx_len    = 0;
+      tx_failed = false;
+#endif
 #if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE || \
     defined TINY_GSM_BUFFER_READ_NO_CHECK
       TINY_GSM_YIELD();
@@ -304,6 +522,7 @@ class TinyGsmTCP {
       at->streamClear();
 
 #elif defined TINY_GSM_NO_MODEM_BUFFER
+      (void)maxWaitMs;  // nothing is left in the modem to wait for
       rx.clear();
       at->streamClear();
 
@@ -319,6 +538,19 @@ class TinyGsmTCP {
     bool       sock_connected;
     bool       got_data;
     RxFifo     rx;
+#if defined TINY_GSM_URC_NOTIFY
+    bool     check_due      = false;
+    uint32_t check_interval = TINY_GSM_URC_CHECK_MAX;
+    uint32_t urc_checks     = 0;
+    uint32_t urc_misses     = 0;
+#endif
+#if TINY_GSM_TX_BUFFER > 0
+    uint8_t  tx_buf[TINY_GSM_TX_BUFFER];
+    uint16_t tx_len    = 0;
+    bool     tx_failed = false;
+    uint32_t tx_writes = 0;
+    uint32_t tx_sends  = 0;
+#endif
   };
 
   /* =========================================== */
@@ -332,7 +564,29 @@ class TinyGsmTCP {
    */
  protected:
   void maintainImpl() {
-#if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
+#if defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE && defined TINY_GSM_URC_NOTIFY
+    // Take in the URCs first, so that a check finding data can tell
+    // whether a URC announced it
+    while (thisModem().stream.available()) {
+      thisModem().waitResponse(15, nullptr, nullptr);
+    }
+    for (int mux = 0; mux < muxCount; mux++) {
+      GsmClient* sock = thisModem().sockets[mux];
+      if (!sock || !(sock->got_data || sock->check_due)) continue;
+      bool unannounced     = !sock->got_data;
+      sock->got_data       = false;
+      sock->check_due      = false;
+      sock->sock_available = thisModem().modemGetAvailable(mux);
+      if (unannounced) {
+        sock->checkDone(sock->sock_available > 0);
+        // A lost "closed" URC would leave the socket open forever
+        if (!sock->sock_available && sock->sock_connected) {
+          sock->sock_connected = thisModem().modemGetConnected(mux);
+        }
+      }
+    }
+
+#elif defined TINY_GSM_BUFFER_READ_AND_CHECK_SIZE
     // Keep listening for modem URC's and proactively iterate through
     // sockets asking if any data is avaiable
     for (int mux = 0; mux < muxCount; mux++) {
@@ -366,11 +620,65 @@ class TinyGsmTCP {
     uint32_t startMillis = millis();
     while (!thisModem().stream.available() &&
            (millis() - startMillis < thisModem().sockets[mux]->_timeout)) {
-      TINY_GSM_YIELD();
+      TINY_GSM_WAIT_RX(
+          TinyGsmTimeLeft(startMillis, thisModem().sockets[mux]->_timeout));
     }
     char c = thisModem().stream.read();
     thisModem().sockets[mux]->rx.put(c);
   }
+
+  // Moves a payload of known length from the stream into the mux FIFO in
+  // blocks: readBytes() lands each one directly in the FIFO's free space,
+  // and the whole payload shares a single time-out period. Bytes that do not
+  // fit in the FIFO are dropped, as moveCharFromStreamToFifo() does, to keep
+  // the stream in step. Returns the number of bytes taken from the stream.
+  size_t moveBytesFromStreamToFifo(uint8_t mux, size_t len) {
+    if (!thisModem().sockets[mux]) return 0;
+    Stream&  stream      = thisModem().stream;
+    auto&    rx          = thisModem().sockets[mux]->rx;
+    uint32_t timeout     = thisModem().sockets[mux]->_timeout;
+    uint32_t startMillis = millis();
+    size_t   moved       = 0;
+    while (moved < len) {
+      int avail = stream.available();
+      if (avail <= 0) {
+        if (millis() - startMillis >= timeout) break;
+        TINY_GSM_WAIT_RX(TinyGsmTimeLeft(startMillis, timeout));
+        continue;
+      }
+      size_t chunk = TinyGsmMin(len - moved, (size_t)avail);
+      TinyGsmFifoSpan<uint8_t> span = rx.writeSpan();
+      if (span.firstSize > 0) {
+        chunk = TinyGsmMin(chunk, (size_t)span.firstSize);
+        chunk = stream.readBytes(span.first, chunk);
+        rx.commitWrite(chunk);
+      } else {
+        stream.read();
+        chunk = 1;
+      }
+      moved += chunk;
+    }
+    return moved;
+  }
+
+  // Moves a payload of known length from the stream straight into buf, with
+  // one time-out period for all of it. Returns the number of bytes moved.
+  size_t moveBytesFromStream(uint8_t* buf, size_t len, uint32_t timeout) {
+    Stream&  stream      = thisModem().stream;
+    uint32_t startMillis = millis();
+    size_t   moved       = 0;
+    while (moved < len) {
+      int avail = stream.available();
+      if (avail <= 0) {
+        if (millis() - startMillis >= timeout) break;
+        TINY_GSM_WAIT_RX(TinyGsmTimeLeft(startMillis, timeout));
+        continue;
+      }
+      moved += stream.readBytes(buf + moved,
+                                TinyGsmMin(len - moved, (size_t)avail));
+    }
+    return moved;
+  }
 };
 
 #endif  // SRC_TINYGSMTCP_H_
@@ -0,0 +1,154 @@
+#ifndef TinyGsmURC_h
+#define TinyGsmURC_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef TINY_GSM_URC_HANDLERS
+#define TINY_GSM_URC_HANDLERS 12
+#endif
+
+// Longest URC line a handler gets to see; the rest is cut off
+#ifndef TINY_GSM_URC_LINE
+#define TINY_GSM_URC_LINE 96
+#endif
+
+/**
+ * @brief The fields of one URC line after its prefix, split in place.
+ *
+ * Fields are comma-separated; a field in double quotes loses the quotes and
+ * may contain commas. Each call to next() terminates the field it returns,
+ * so the pointers stay valid until the handler returns.
+ */
+class TinyGsmUrcFields {
+ public:
+  explicit TinyGsmUrcFields(char* text) : pos(text) {
+    while (*pos == ' ') pos++;
+  }
+
+  // The next field, or nullptr past the last one
+  const char* next() {
+    if (!pos) return nullptr;
+    char* field = pos;
+    char* end;
+    if (*field == '"') {
+      field++;
+      end = strchr(field, '"');
+      if (end) {
+        *end++ = '\0';
+        end    = strchr(end, ',');
+      }
+    } else {
+      end = strchr(field, ',');
+    }
+    if (end) {
+      *end = '\0';
+      pos  = end + 1;
+      while (*pos == ' ') pos++;
+    } else {
+      pos = nullptr;
+    }
+    return field;
+  }
+
+  // The next field as a number; `fallback` if it is missing or empty
+  int32_t nextInt(int32_t fallback = -1) {
+    const char* field = next();
+    if (!field || !*field) return fallback;
+    return strtol(field, nullptr, 0);
+  }
+
+  // The unsplit rest of the line
+  const char* rest() const {
+    return pos ? pos : "";
+  }
+
+ private:
+  char* pos;
+};
+
+/**
+ * @brief Called with the fields of a URC line that starts with the prefix
+ * it was registered for. Returns true if it took care of the line; false
+ * passes it on to the next handler for a matching prefix.
+ */
+typedef bool (*TinyGsmUrcHandler)(void* ctx, TinyGsmUrcFields& fields);
+
+/**
+ * @brief URC prefixes and their handlers, up to N of them.
+ *
+ * A line is looked up by its first character after an optional '+', so it
+ * is compared only against the few prefixes that share that character, and
+ * lines no handler wants cost one table read. Handlers for the same prefix
+ * run in the order they were added, each on a fresh copy of the line.
+ */
+template <uint8_t N>
+class TinyGsmUrcTable {
+ public:
+  TinyGsmUrcTable() : count(0) {
+    memset(heads, kEnd, sizeof(heads));
+  }
+
+  /**
+   * @brief Adds a handler for lines starting with `prefix`, which must
+   * outlive the table ("+CEREG:", "RDY", ...). False if the table is full.
+   */
+  bool add(const char* prefix, TinyGsmUrcHandler handler, void* ctx) {
+    if (count >= N || !prefix || !*prefix || !handler) return false;
+    Entry& e  = entries[count];
+    e.prefix  = prefix;
+    e.len     = static_cast<uint8_t>(strlen(prefix));
+    e.handler = handler;
+    e.ctx     = ctx;
+    e.next    = kEnd;
+    // Append, so the chain keeps the order handlers were added in
+    uint8_t* link = &heads[bucket(prefix)];
+    while (*link != kEnd) link = &entries[*link].next;
+    *link = count++;
+    return true;
+  }
+
+  /**
+   * @brief Runs the handlers for the line of `len` characters at `line`
+   * (without its line end). True if one of them took it.
+   */
+  bool dispatch(const char* line, size_t len) {
+    if (!len) return false;
+    if (len >= TINY_GSM_URC_LINE) len = TINY_GSM_URC_LINE - 1;
+    for (uint8_t i = heads[bucket(line)]; i != kEnd; i = entries[i].next) {
+      const Entry& e = entries[i];
+      if (e.len > len || memcmp(line, e.prefix, e.len) != 0) continue;
+      char copy[TINY_GSM_URC_LINE];
+      memcpy(copy, line + e.len, len - e.len);
+      copy[len - e.len] = '\0';
+      TinyGsmUrcFields fields(copy);
+      if (e.handler(e.ctx, fields)) return true;
+    }
+    return false;
+  }
+
+ private:
+  static const uint8_t kEnd     = 0xFF;
+  static const uint8_t kBuckets = 32;
+
+  static uint8_t bucket(const char* s) {
+    char c = (s[0] == '+' && s[1]) ? s[1] : s[0];
+    return static_cast<uint8_t>(c) & (kBuckets - 1);
+  }
+
+  struct Entry {
+    const char*       prefix;
+    TinyGsmUrcHandler handler;
+    void*             ctx;
+    uint8_t           len;
+    uint8_t           next;
+  };
+
+  Entry   entries[N];
+  uint8_t heads[kBuckets];
+  uint8_t count;
+};
+
+#endif
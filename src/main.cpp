@@ -2,17 +2,104 @@
 #define SerialMon Serial
 #define SerialAT Serial1
 
+// Have the modem push received socket data inside +QIURC URCs (direct push
+// access mode) instead of announcing it for +QIRD to fetch; see
+// TinyGsmClientEC200U.h.
+// #define TINY_GSM_EC200U_DIRECT_PUSH
+
 #if !defined(TINY_GSM_RX_BUFFER)
+#if defined(TINY_GSM_EC200U_DIRECT_PUSH)
+#define TINY_GSM_RX_BUFFER 2048 // Room for a whole push (up to 1500 bytes)
+#else
 #define TINY_GSM_RX_BUFFER 1024
 #endif
+#endif
+// Gather the HTTP request's many small prints into one +QISEND
+#if !defined(TINY_GSM_TX_BUFFER)
+#define TINY_GSM_TX_BUFFER 512
+#endif
+// Trust the modem's data and close URCs instead of asking every 500 ms
+// whether data arrived unannounced; a lost URC brings the checks back
+// (see TinyGsmTCP.tpp)
+#define TINY_GSM_URC_NOTIFY
+
+// Let TinyGSM's waits for the modem sleep until the UART's receive
+// callbacks report traffic instead of spinning on available() (see ota_uart.h)
+#define OTA_UART_EVENTS
+#if defined(OTA_UART_EVENTS)
+#include "ota_uart.h"
+#define TINY_GSM_WAIT_RX(ms) ota_uart_wait(ms)
+#endif
 #define BOARD_PWRKEY_PIN 7
 #define BOARD_RESET_PIN 6
 #define GSM_RX 18
 #define GSM_TX 17
 
-#define GSM_BAUD 115200
+#define GSM_BAUD 115200 // modem's factory rate, used until a faster one is stored
+// ESP32 pins wired to the modem's RTS and CTS lines; -1 if not connected
+// (the link then runs without hardware flow control)
+#define GSM_RTS -1
+#define GSM_CTS -1
 #define GSM_PIN "" // Sim Unlock Pin
 
+// Download modes: define at most one of OTA_PIPELINED, OTA_RESUMABLE,
+// OTA_PARALLEL_SOCKETS, OTA_DECOMPRESS, OTA_MODEM_FILE and
+// OTA_TRANSPORT_BENCHMARK. With none, ota_task() reads the image and
+// writes flash in turn in a single loop.
+
+// Overlap modem reads with flash writes on the two cores (see ota_pipeline.h).
+// OTA_DECOMPRESS runs the same pipeline and takes raw images too.
+// #define OTA_PIPELINED
+
+// Checkpoint download progress in NVS and continue an interrupted download
+// with an HTTP Range request instead of starting over (see ota_resume.h).
+// #define OTA_RESUMABLE
+
+// Fetch the image as byte ranges over this many modem sockets at once
+// (see ota_parallel.h).
+// #define OTA_PARALLEL_SOCKETS 3
+
+// Try a binary patch against the running firmware first (made with
+// tools/ota_tool, see ota_delta.h); falls back to the full image if the
+// server has none or it was made for another build.
+// #define OTA_DELTA
+
+// Accept compressed images (OTAZ prefix from tools/ota_tool, or served with
+// Content-Encoding deflate/gzip) and inflate them on the writer core, see
+// ota_decompress.h. Raw images still work.
+#define OTA_DECOMPRESS
+
+// Let the EC200U fetch the image with its own HTTP client into its flash
+// (UFS), then read it back in large AT+QFREAD blocks instead of +QIRD
+// socket reads (see TinyGsmEC200UHttpFile.h).
+// #define OTA_MODEM_FILE
+
+// Move the modem UART from GSM_BAUD up to the fastest rate (at most
+// OTA_LINK_MAX_BAUD with RTS/CTS, OTA_LINK_NO_FLOW_MAX_BAUD without) that
+// passes a loopback test, keep it for the next boot, and go a rate lower
+// after a download that lost UART input (see ota_link.h). Comment out to
+// stay at GSM_BAUD.
+#define OTA_LINK
+
+// Download the image over a transparent-mode socket (access mode 2): the
+// body arrives as raw bytes on the UART instead of +QIRD frames. The modem
+// takes no AT commands until the download has ended.
+// #define OTA_TRANSPARENT
+
+// Download the image over the socket path (buffer and transparent mode)
+// and the modem file path into a null sink and print the timings of each.
+// Nothing is flashed.
+// #define OTA_TRANSPORT_BENCHMARK
+
+#if defined(OTA_PIPELINED) + defined(OTA_RESUMABLE) + defined(OTA_PARALLEL_SOCKETS) + \
+        defined(OTA_DECOMPRESS) + defined(OTA_MODEM_FILE) + defined(OTA_TRANSPORT_BENCHMARK) > 1
+#error "Define at most one download mode (see above); ota_task() would run only the first"
+#endif
+#if !defined(OTA_RESUMABLE) && !defined(OTA_PARALLEL_SOCKETS) && !defined(OTA_DECOMPRESS) && \
+    !defined(OTA_MODEM_FILE) && !defined(OTA_TRANSPORT_BENCHMARK)
+#define OTA_RAW_IMAGE
+#endif
+
 // Your GPRS credentials, if any
 const char apn[] = "airteliot.com";
 // const char apn[] = "airtelgprs.com";
@@ -23,23 +110,163 @@ const char pass[] = "";
 const char *server_url = "protocol.electrocus.com"; // Extract host from URL
 const int server_port = 7000;
 const char *firmware_path = "/firmware.bin"; // Extract file path
+const char *delta_path = "/firmware.patch";  // OTA_DELTA: patch from the running build
+const char *manifest_path = "/firmware.manifest"; // Optional digests (ota_tool manifest), nullptr to skip
 
 // const char *server_url = "www.abcd.com"; // Extract host from URL  http://www.abcd.com/xyz/filename.bin
 // const int server_port = 80;
 // const char *firmware_path = "/xyz/filename.bin"; // Extract file path
 
 #include <TinyGsmClient.h>
+#include <TinyGsmAtQueue.h>
+#include <TinyGsmEC200UHttpFile.h>
 #include <ArduinoHttpClient.h>  // External library 
 #include <Update.h>
 
+#include "ota_pipeline.h"
+#include "ota_decompress.h"
+#include "ota_flow.h"
+#include "ota_delta.h"
+#include "ota_http.h"
+#include "ota_link.h"
+#include "ota_parallel.h"
+#include "ota_resume.h"
+
 
 // #include <HTTPClient.h>  // Normal http client that is provided by esp32 builtin libraries
 // HTTPClient http;
 
 TinyGsm modem(SerialAT);
+// Commands loop() runs without blocking (see TinyGsmAtQueue.h)
+TinyGsmAtQueue<TinyGsm> modem_queue(modem);
+
+// The socket the image itself is downloaded over
+#if defined(OTA_TRANSPARENT)
+typedef TinyGsmClientTransparent OtaClient;
+#else
+typedef TinyGsmClient OtaClient;
+#endif
+
+#if defined(OTA_PARALLEL_SOCKETS)
+// Global so the modem never keeps pointers to destroyed sockets
+TinyGsmClient ota_clients[OTA_PARALLEL_SOCKETS];
+#endif
 
 const int kNetworkTimeout = 30 * 1000; // Number of milliseconds to wait without receiving any data before we give up
-const int kNetworkDelay = 1000;        // Number of milliseconds to wait if no data is available before trying again
+const int kNetworkDelay = 1000;        // Longest wait between polls while no data arrives (waits start short and back off)
+const int kSerialRxBufferSize = 4096;  // Holds a whole +QIRD payload while flash writes stall the CPU
+const int kOtaAttempts = 5;            // Resumable mode: download attempts before giving up until next boot
+const int kOtaRetryDelay = 10 * 1000;  // Resumable mode: pause between attempts
+
+// What the modem reported unsolicited (see TinyGsmEC200U::onURC). Kept
+// current by whatever reads the modem next, waitResponse() or maintain().
+struct ModemEvents
+{
+    int reg_status = -1;   // <stat> of the last +CEREG
+    bool pdp_lost = false; // +QIURC: "pdpdeact", until handled
+    int sms_index = -1;    // storage index of the last SMS received
+};
+ModemEvents modem_events;
+
+bool on_registration(void *, TinyGsmUrcFields &fields)
+{
+    modem_events.reg_status = fields.nextInt();
+    Serial.printf("Network registration: %d\n", modem_events.reg_status);
+    return true;
+}
+
+// Other +QIURC types are the modem's own business
+bool on_pdp_deact(void *, TinyGsmUrcFields &fields)
+{
+    const char *urc = fields.next();
+    if (!urc || strcmp(urc, "pdpdeact") != 0)
+    {
+        return false;
+    }
+    modem_events.pdp_lost = true;
+    Serial.println("PDP context deactivated by the network");
+    return true;
+}
+
+bool on_sms(void *, TinyGsmUrcFields &fields)
+{
+    fields.next(); // storage
+    modem_events.sms_index = fields.nextInt();
+    Serial.printf("SMS received, index %d\n", modem_events.sms_index);
+    return true;
+}
+
+bool on_modem_ready(void *, TinyGsmUrcFields &)
+{
+    Serial.println("Modem (re)started");
+    return true;
+}
+
+bool on_indication(void *, TinyGsmUrcFields &fields)
+{
+    Serial.printf("Modem indication: %s\n", fields.rest());
+    return true;
+}
+
+// Link status queries loop() runs every kStatusInterval, all on one
+// command line
+const uint32_t kStatusInterval = 30 * 1000;
+TinyGsmAtCommand status_csq("+CSQ", "+CSQ:", 300, true);
+TinyGsmAtCommand status_cereg("+CEREG?", "+CEREG:", 300, true);
+TinyGsmAtCommand status_cell("+QENG=\"servingcell\"", "+QENG:", 300, true);
+// Brings the PDP context back after the network dropped it; up to 150 s
+TinyGsmAtCommand pdp_activate("+QIACT=1", nullptr, 150 * 1000L);
+
+void on_status(void *, TinyGsmAtCommand &command)
+{
+    Serial.printf("%s: %s\n", command.text, command.ok() ? command.response() : "failed");
+}
+
+void on_pdp_activate(void *, TinyGsmAtCommand &command)
+{
+    Serial.println(command.ok() ? "GPRS reconnected" : "GPRS reconnect failed");
+}
+
+void modem_events_register()
+{
+    modem.onURC("+CEREG:", on_registration);
+    modem.onURC("+QIURC:", on_pdp_deact);
+    modem.onURC("+CMTI:", on_sms);
+    modem.onURC("RDY", on_modem_ready);
+    modem.onURC("APP RDY", on_modem_ready);
+    modem.onURC("+QIND:", on_indication);
+}
+
+// Runs while the modem still has the AT defaults, before TinyGSM talks
+// to it at the new rate. False if the modem did not answer.
+bool link_up()
+{
+#if defined(OTA_LINK)
+    OtaLinkStats stats;
+    uint32_t baud = ota_link_begin(SerialAT, GSM_RTS, GSM_CTS, OTA_LINK_MAX_BAUD, &stats);
+    ota_link_print_stats(stats, SerialMon);
+    return baud != 0;
+#else
+    return true;
+#endif
+}
+
+#if defined(OTA_LINK) && defined(OTA_UART_EVENTS)
+// A download that failed while the UART dropped or garbled input ran the
+// link faster than this board keeps up with: move it one rate lower, for
+// the next attempt and the next boot
+void link_check(const OtaUartStats &before)
+{
+    const OtaUartStats &now = ota_uart_stats();
+    if (now.overflows == before.overflows && now.errors == before.errors)
+    {
+        return;
+    }
+    OtaLinkStats stats;
+    ota_link_step_down(GSM_BAUD, &stats);
+    ota_link_print_stats(stats, SerialMon);
+}
+#endif
 
 bool powerOn()
 {
@@ -56,44 +283,335 @@ bool powerOn()
     return true;
 }
 
-void ota_task()
+void ota_reboot()
 {
-    if (!modem.isGprsConnected())
+    Serial.println("OTA update completed successfully! Rebooting...");
+    modem.gprsDisconnect();
+
+    delay(1500);
+    ESP.restart();
+}
+
+// Per-segment CRCs and the image SHA-256 published next to the firmware
+// (see ota_digest.h). Without one only the X-Firmware-SHA256 header, if
+// any, is checked.
+bool ota_fetch_manifest(OtaManifest &manifest)
+{
+    if (!manifest_path)
     {
-        Serial.println("Failed to connect to GPRS!");
+        return false;
+    }
+    TinyGsmClient client(modem);
+    HttpClient http(client, server_url, server_port);
+    bool ok = ota_http_get_manifest(http, manifest_path, manifest);
+    http.stop();
+    Serial.println(ok ? "Using OTA manifest" : "No OTA manifest");
+    return ok;
+}
+
+// The SHA-256 a download must have: the X-Firmware-SHA256 header describes
+// exactly this response, so it wins over the manifest. nullptr if neither
+// has one.
+const uint8_t *ota_expected_sha256(const OtaHttpResponse &response, const OtaManifest *manifest,
+                                   uint8_t header_sha256[kOtaSha256Size])
+{
+    if (response.sha256.length() && ota_parse_sha256(response.sha256.c_str(), header_sha256))
+    {
+        return header_sha256;
+    }
+    if (manifest && manifest->has_sha256)
+    {
+        return manifest->sha256;
+    }
+    return nullptr;
+}
+
+#if defined(OTA_RESUMABLE)
+void ota_resumable_task()
+{
+    OtaPipelineConfig config = {kNetworkTimeout, kNetworkDelay};
+    static OtaManifest manifest;
+    bool have_manifest = false;
+
+    for (int attempt = 1; attempt <= kOtaAttempts; attempt++)
+    {
+        if (!modem.isGprsConnected() && !modem.gprsConnect(apn, user, pass))
+        {
+            Serial.println("Failed to connect to GPRS!");
+        }
+        else
+        {
+            if (!have_manifest)
+            {
+                have_manifest = ota_fetch_manifest(manifest);
+            }
+            TinyGsmClient client(modem);
+            HttpClient http(client, server_url, server_port);
+            if (ota_resumable_download(http, firmware_path, have_manifest ? &manifest : nullptr, config))
+            {
+                ota_reboot();
+            }
+        }
+
+        Serial.print("OTA attempt ");
+        Serial.print(attempt);
+        Serial.println(" failed");
+        delay(kOtaRetryDelay);
+    }
+}
+#endif
+
+#if defined(OTA_PARALLEL_SOCKETS)
+void ota_parallel_task()
+{
+    // Before the sockets are bound: the manifest request borrows socket 0
+    static OtaManifest manifest;
+    bool have_manifest = ota_fetch_manifest(manifest);
+
+    Client *clients[OTA_PARALLEL_SOCKETS];
+    for (uint8_t i = 0; i < OTA_PARALLEL_SOCKETS; i++)
+    {
+        ota_clients[i].init(&modem, i);
+        clients[i] = &ota_clients[i];
+    }
+
+    OtaPipelineConfig config = {kNetworkTimeout, kNetworkDelay};
+    OtaParallelStats stats;
+    bool ok = ota_parallel_download(clients, OTA_PARALLEL_SOCKETS, server_url, server_port,
+                                    firmware_path, have_manifest ? &manifest : nullptr,
+                                    config, &stats);
+    ota_parallel_print_stats(stats, Serial);
+    if (ok)
+    {
+        ota_reboot();
+    }
+}
+#endif
+
+#if defined(OTA_DECOMPRESS)
+void ota_decompress_task()
+{
+    static OtaManifest manifest;
+    bool have_manifest = ota_fetch_manifest(manifest);
+
+    OtaClient client(modem);
+    HttpClient http(client, server_url, server_port);
+
+    Serial.println("Sending GET request...");
+    OtaHttpResponse response;
+    if (!ota_http_get(http, firmware_path, nullptr, nullptr, response, "gzip, deflate"))
+    {
+        http.stop();
         return;
     }
-    Serial.println("Connected to GPRS!");
+    if (response.status != 200 || response.content_length <= 0)
+    {
+        Serial.print("HTTP GET failed! Error code = ");
+        Serial.println(response.status);
+        http.stop();
+        return;
+    }
+
+    uint8_t header_sha256[kOtaSha256Size];
+    const uint8_t *expected_sha256 =
+        ota_expected_sha256(response, have_manifest ? &manifest : nullptr, header_sha256);
+
+    OtaPipelineConfig config = {kNetworkTimeout, kNetworkDelay};
+    OtaPipelineStats stats;
+    bool ok = ota_image_download(http, response.content_length, response.content_encoding.c_str(),
+                                 expected_sha256, config, &stats);
+    ota_pipeline_print_stats(stats, Serial);
+#if defined(OTA_UART_EVENTS)
+    ota_uart_print_stats(Serial);
+#endif
+    http.stop();
+    if (ok)
+    {
+        ota_reboot();
+    }
+}
+#endif
+
+// Full URL of the firmware for the modem's own HTTP client
+void ota_firmware_url(char *url, size_t size)
+{
+    snprintf(url, size, "http://%s:%d%s", server_url, server_port, firmware_path);
+}
+
+#if defined(OTA_MODEM_FILE)
+void ota_modem_file_task()
+{
+    static OtaManifest manifest;
+    bool have_manifest = ota_fetch_manifest(manifest);
+
+    char url[160];
+    ota_firmware_url(url, sizeof(url));
+    TinyGsmEC200UHttpFile file(modem);
+    file.setBaud(SerialAT.baudRate());
+
+    Serial.println("Modem downloading firmware to UFS...");
+    uint32_t start = millis();
+    int status = file.download(url);
+    if (status != 200 || !file.open())
+    {
+        Serial.print("Modem HTTP download failed! Code = ");
+        Serial.println(status);
+        file.remove();
+        return;
+    }
+    Serial.printf("Modem fetched %u bytes in %u ms\n", file.size(), millis() - start);
+
+    OtaPipelineConfig config = {kNetworkTimeout, kNetworkDelay};
+    OtaPipelineStats stats;
+    bool ok = ota_image_download(file, file.size(), nullptr,
+                                 have_manifest && manifest.has_sha256 ? manifest.sha256 : nullptr,
+                                 config, &stats);
+    ota_pipeline_print_stats(stats, Serial);
+    file.remove();
+    if (ok)
+    {
+        ota_reboot();
+    }
+}
+#endif
+
+#if defined(OTA_TRANSPORT_BENCHMARK)
+bool ota_discard(void *, const uint8_t *, size_t)
+{
+    return true;
+}
 
+void ota_print_benchmark(const char *name, size_t bytes, uint32_t fetch_ms, uint32_t transfer_ms)
+{
+    uint32_t total_ms = fetch_ms + transfer_ms;
+    Serial.printf("%-12s %8u bytes %8u ms %8u B/s (fetch %u ms, UART %u ms)\n", name, bytes, total_ms,
+                  total_ms ? (uint32_t)((uint64_t)bytes * 1000 / total_ms) : 0, fetch_ms, transfer_ms);
+}
+
+void ota_benchmark_socket(const char *name, Client &client, const OtaSink &sink, const OtaPipelineConfig &config,
+                          OtaPipelineStats &stats)
+{
+    HttpClient http(client, server_url, server_port);
+    OtaHttpResponse response;
+    uint32_t start = millis();
+    if (ota_http_get(http, firmware_path, nullptr, nullptr, response) && response.status == 200 &&
+        response.content_length > 0)
+    {
+        uint32_t fetch_ms = millis() - start;
+        ota_pipeline_run(http, response.content_length, sink, config, &stats);
+        ota_print_benchmark(name, stats.writer.bytes, fetch_ms, stats.elapsed_ms);
+    }
+    http.stop();
+}
+
+void ota_transport_benchmark()
+{
+    OtaPipelineConfig config = {kNetworkTimeout, kNetworkDelay};
+    OtaSink null_sink = {ota_discard, nullptr};
+    OtaPipelineStats stats;
+
+    // Socket path: HTTP over a TinyGsmClient, data in +QIRD frames
+    {
+        TinyGsmClient client(modem);
+        ota_benchmark_socket("socket", client, null_sink, config, stats);
+    }
+
+    // The same over a transparent-mode socket, data raw on the UART
+    {
+        TinyGsmClientTransparent client(modem);
+        ota_benchmark_socket("transparent", client, null_sink, config, stats);
+    }
+
+    // Modem file path: LTE into UFS, then AT+QFREAD blocks
+    {
+        char url[160];
+        ota_firmware_url(url, sizeof(url));
+        TinyGsmEC200UHttpFile file(modem);
+        file.setBaud(SerialAT.baudRate());
+        uint32_t start = millis();
+        if (file.download(url) == 200 && file.open())
+        {
+            uint32_t fetch_ms = millis() - start;
+            ota_pipeline_run(file, file.size(), null_sink, config, &stats);
+            ota_print_benchmark("modem file", stats.writer.bytes, fetch_ms, stats.elapsed_ms);
+        }
+        file.remove();
+    }
+}
+#endif
+
+#if defined(OTA_DELTA)
+bool ota_delta_task()
+{
     TinyGsmClient client(modem);
     HttpClient http(client, server_url, server_port);
 
+    Serial.println("Requesting delta patch...");
+    OtaHttpResponse response;
+    bool ok = false;
+    if (!ota_http_get(http, delta_path, nullptr, nullptr, response))
+    {
+        Serial.println("Connection Failed");
+    }
+    else if (response.status != 200 || response.content_length <= 0)
+    {
+        Serial.print("No delta patch available, code = ");
+        Serial.println(response.status);
+    }
+    else
+    {
+        OtaPipelineConfig config = {kNetworkTimeout, kNetworkDelay};
+        ok = ota_delta_download(http, response.content_length, config);
+    }
+    http.stop();
+    return ok;
+}
+#endif
+
+#if defined(OTA_RAW_IMAGE)
+// The image as it is on the server, through the pipeline (OTA_PIPELINED)
+// or the single loop, checked against the X-Firmware-SHA256 header or the
+// manifest before it is committed
+void ota_raw_task()
+{
+    static OtaManifest manifest;
+    bool have_manifest = ota_fetch_manifest(manifest);
+
+    OtaClient client(modem);
+    HttpClient http(client, server_url, server_port);
+
     Serial.println("Sending GET request...");
-    if (http.get(firmware_path) != 0)
+    OtaHttpResponse response;
+    if (!ota_http_get(http, firmware_path, nullptr, nullptr, response))
     {
         Serial.println("Connection Failed");
         http.stop();
         return;
     }
 
-    int httpCode = http.responseStatusCode();
-    if (httpCode != 200)
+    if (response.status != 200)
     {
         Serial.print("HTTP GET failed! Error code = ");
-        Serial.println(httpCode);
+        Serial.println(response.status);
         http.stop();
         return;
     }
 
-    // Read firmware size from Content-Length
-    size_t firmware_size = http.contentLength();
-
-    if (firmware_size <= 0)
+    if (response.content_length <= 0)
     {
         Serial.println("Invalid firmware size!");
         http.stop();
         return;
     }
+    size_t firmware_size = response.content_length;
+
+    uint8_t header_sha256[kOtaSha256Size];
+    const uint8_t *expected_sha256 =
+        ota_expected_sha256(response, have_manifest ? &manifest : nullptr, header_sha256);
+    if (!expected_sha256)
+    {
+        Serial.println("No firmware SHA-256 published; checking the size only");
+    }
 
     Serial.print("Firmware size: ");
     Serial.print(firmware_size / 1024);
@@ -108,25 +626,46 @@ void ota_task()
         return;
     }
 
-    uint8_t buffer[512]; // GSM is slow, so 512 bytes is better
+#if defined(OTA_PIPELINED)
+    OtaPipelineConfig config = {kNetworkTimeout, kNetworkDelay};
+    OtaPipelineStats stats;
+    static OtaDigestSink digest;
+    digest.begin(ota_update_sink());
+    ota_pipeline_run(http, firmware_size, digest.sink(), config, &stats);
+    ota_pipeline_print_stats(stats, Serial);
+    size_t totalBytes = stats.writer.bytes;
+    uint8_t sha256[kOtaSha256Size];
+    digest.finish(sha256);
+#else
+    // One full +QIRD: with the socket FIFO empty, GsmClient reads straight
+    // into this buffer in a single modem round trip
+    uint8_t buffer[1500];
     size_t totalBytes = 0;
     int progress = 0;
+    OtaSha256 digest;
+    digest.begin();
 
     unsigned long lastDataMillis = millis();
+    OtaFlowControl flow;
+    flow.begin(kNetworkDelay);
 
     while ((http.connected() || http.available()) && totalBytes < firmware_size)
     {
-        int len = 0;
+        size_t len = 0;
 
-        // Read available data into buffer
-        while (http.available() && len < sizeof(buffer))
+        // Read as much as the socket has buffered in one call
+        int avail = http.available();
+        if (avail > 0)
         {
-            buffer[len++] = http.read();
-            lastDataMillis = millis();
+            int n = http.read(buffer, min(min((size_t)avail, sizeof(buffer)), firmware_size - totalBytes));
+            len = n > 0 ? n : 0;
         }
 
         if (len > 0)
         {
+            lastDataMillis = millis();
+            flow.data();
+
             size_t written = Update.write(buffer, len);
             if (written != len)
             {
@@ -136,6 +675,7 @@ void ota_task()
                 return;
             }
 
+            digest.update(buffer, written);
             totalBytes += written;
 
             // Progress indicator every 5%
@@ -159,11 +699,16 @@ void ota_task()
         }
 
         // Avoid busy-wait loops when data is slow
-        if (!http.available())
+        if (len == 0)
         {
-            delay(kNetworkDelay);
+            flow.idle();
         }
     }
+    flow.end();
+    ota_flow_print_stats(flow.stats(), Serial);
+    uint8_t sha256[kOtaSha256Size];
+    digest.finish(sha256);
+#endif
 
     // Check if download was completed
     if (totalBytes != firmware_size)
@@ -174,6 +719,14 @@ void ota_task()
         return;
     }
 
+    // A corrupted or substituted image must never be committed
+    if (expected_sha256 && !ota_digest_check(sha256, expected_sha256))
+    {
+        Update.abort();
+        http.stop();
+        return;
+    }
+
     // Finalize OTA update
     if (!Update.end() || !Update.isFinished())
     {
@@ -183,18 +736,57 @@ void ota_task()
         return;
     }
 
-    Serial.println("OTA update completed successfully! Rebooting...");
     http.stop();
-    modem.gprsDisconnect();
+    ota_reboot();
+}
+#endif
 
-    delay(1500);
-    ESP.restart();
+void ota_task()
+{
+    if (!modem.isGprsConnected())
+    {
+        Serial.println("Failed to connect to GPRS!");
+        return;
+    }
+    Serial.println("Connected to GPRS!");
+
+#if defined(OTA_DELTA)
+    if (ota_delta_task())
+    {
+        ota_reboot();
+    }
+    Serial.println("Falling back to full image");
+#endif
+
+#if defined(OTA_TRANSPORT_BENCHMARK)
+    ota_transport_benchmark();
+#elif defined(OTA_RESUMABLE)
+    ota_resumable_task();
+#elif defined(OTA_PARALLEL_SOCKETS)
+    ota_parallel_task();
+#elif defined(OTA_MODEM_FILE)
+    ota_modem_file_task();
+#elif defined(OTA_DECOMPRESS)
+    ota_decompress_task();
+#else
+    ota_raw_task();
+#endif
 }
 
 void setup()
 {
     SerialMon.begin(115200);
+    SerialAT.setRxBufferSize(kSerialRxBufferSize);
+#if defined(OTA_LINK)
+    SerialAT.begin(ota_link_saved_baud(GSM_BAUD), SERIAL_8N1, GSM_RX, GSM_TX);
+#else
     SerialAT.begin(GSM_BAUD, SERIAL_8N1, GSM_RX, GSM_TX);
+#endif
+#if defined(OTA_UART_EVENTS)
+    ota_uart_attach(SerialAT);
+#else
+    ota_flow_attach(SerialAT);
+#endif
     pinMode(BOARD_RESET_PIN, OUTPUT);
     pinMode(BOARD_PWRKEY_PIN, OUTPUT);
 
@@ -203,12 +795,21 @@ void setup()
     digitalWrite(BOARD_PWRKEY_PIN, LOW);
 
     SerialMon.println("Initializing modem...");
+    modem_events_register();
+    // A modem that is still off is found again after powerOn()
+    bool linked = link_up();
     if (!modem.restart())
     {
         if (!powerOn())
             return;
+        if (!linked)
+            link_up();
     }
 
+    // Registration changes as +CEREG URCs
+    modem.sendAT(GF("+CEREG=1"));
+    modem.waitResponse();
+
     // Unlock your SIM card with a PIN if needed
     if (GSM_PIN && modem.getSimStatus() != 3)
         modem.simUnlock(GSM_PIN);
@@ -236,9 +837,30 @@ void setup()
 
     Serial.println("OTA 8");
     delay(5000);
+#if defined(OTA_LINK) && defined(OTA_UART_EVENTS)
+    OtaUartStats before = ota_uart_stats();
     ota_task();
+    link_check(before);
+#else
+    ota_task();
+#endif
 }
 
 void loop()
 {
+    // Reads pending URCs into modem_events and completes queued commands
+    modem_queue.poll();
+    if (modem_events.pdp_lost && modem_queue.submit(pdp_activate, on_pdp_activate))
+    {
+        modem_events.pdp_lost = false;
+    }
+    static uint32_t last_status = 0;
+    if (millis() - last_status >= kStatusInterval)
+    {
+        last_status = millis();
+        modem_queue.submit(status_csq, on_status);
+        modem_queue.submit(status_cereg, on_status);
+        modem_queue.submit(status_cell, on_status);
+    }
+    delay(10);
 }
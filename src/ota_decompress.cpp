@@ -0,0 +1,335 @@
+#include "ota_decompress.h"
+
+#include <Update.h>
+
+#include "ota_digest.h"
+#if CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/rom/miniz.h>
+#else
+#include <esp32/rom/miniz.h>
+#endif
+
+namespace
+{
+// Skips a gzip member header (RFC 1952) one byte at a time
+class GzipHeader
+{
+public:
+    enum Result
+    {
+        kMore,
+        kDone,
+        kBad
+    };
+
+    void begin()
+    {
+        iState = kFixed;
+        iCount = 0;
+    }
+
+    Result feed(uint8_t b)
+    {
+        switch (iState)
+        {
+        case kFixed:
+            if ((iCount == 0 && b != 0x1f) || (iCount == 1 && b != 0x8b) || (iCount == 2 && b != 8))
+                return kBad;
+            if (iCount == 3)
+                iFlags = b;
+            if (++iCount == 10)
+                return next(kExtraLength);
+            return kMore;
+        case kExtraLength:
+            iExtra = iCount++ ? iExtra | (b << 8) : b;
+            return iCount == 2 ? next(kExtra) : kMore;
+        case kExtra:
+            return --iExtra ? kMore : next(kName);
+        case kName:
+            return b ? kMore : next(kComment);
+        case kComment:
+            return b ? kMore : next(kHeaderCrc);
+        case kHeaderCrc:
+            return ++iCount == 2 ? kDone : kMore;
+        }
+        return kBad;
+    }
+
+private:
+    enum State
+    {
+        kFixed,
+        kExtraLength,
+        kExtra,
+        kName,
+        kComment,
+        kHeaderCrc
+    };
+
+    // Moves on to `state`, skipping the optional fields that are absent
+    Result next(State state)
+    {
+        static const uint8_t kFlagFor[] = {0, 0x04, 0x04, 0x08, 0x10, 0x02};
+        iState = state;
+        iCount = 0;
+        while (!(iFlags & kFlagFor[iState]) || (iState == kExtra && iExtra == 0))
+        {
+            if (iState == kHeaderCrc)
+                return kDone;
+            iState = (State)(iState + 1);
+        }
+        return kMore;
+    }
+
+    State iState;
+    uint8_t iFlags;
+    uint8_t iCount;
+    uint16_t iExtra;
+};
+
+struct Decompressor
+{
+    OtaCompressedHeader header;
+    OtaSink out;
+    uint32_t produced;
+    bool in_gzip_header;
+    bool done; // end of the compressed stream seen
+    GzipHeader gzip;
+    tinfl_decompressor inflator;
+    uint32_t inflate_flags;
+    size_t dict_pos;
+    OtaHeatshrinkDecoder heatshrink;
+};
+
+Decompressor s_decompressor;
+uint8_t s_dict[TINFL_LZ_DICT_SIZE];
+OtaDigestSink s_digest;
+
+bool write_raw(Decompressor &d, const uint8_t *data, size_t len)
+{
+    d.produced += len;
+    return ota_sink_write(d.out, data, len);
+}
+
+// Inflates into the circular dictionary and passes each newly written
+// stretch of it downstream
+bool write_inflate(Decompressor &d, const uint8_t *data, size_t len)
+{
+    while (d.in_gzip_header && len > 0)
+    {
+        GzipHeader::Result result = d.gzip.feed(*data++);
+        len--;
+        if (result == GzipHeader::kBad)
+        {
+            Serial.println("Bad gzip header!");
+            return false;
+        }
+        d.in_gzip_header = result == GzipHeader::kMore;
+    }
+
+    while (!d.done)
+    {
+        size_t in = len;
+        size_t out = TINFL_LZ_DICT_SIZE - d.dict_pos;
+        tinfl_status status = tinfl_decompress(&d.inflator, data, &in, s_dict, s_dict + d.dict_pos,
+                                               &out, d.inflate_flags | TINFL_FLAG_HAS_MORE_INPUT);
+        data += in;
+        len -= in;
+        if (out > 0)
+        {
+            if (!ota_sink_write(d.out, s_dict + d.dict_pos, out))
+            {
+                return false;
+            }
+            d.produced += out;
+            d.dict_pos = (d.dict_pos + out) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+
+        if (status == TINFL_STATUS_DONE)
+        {
+            d.done = true; // a gzip trailer may follow; it is ignored
+        }
+        else if (status < 0)
+        {
+            Serial.print("Inflate error ");
+            Serial.println(status);
+            return false;
+        }
+        else if (status == TINFL_STATUS_NEEDS_MORE_INPUT)
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+bool write_compressed(void *ctx, const uint8_t *data, size_t len)
+{
+    Decompressor &d = *static_cast<Decompressor *>(ctx);
+    switch (d.header.format)
+    {
+    case OTA_COMPRESSION_HEATSHRINK:
+        return d.heatshrink.feed(data, len);
+    case OTA_COMPRESSION_DEFLATE:
+    case OTA_COMPRESSION_GZIP:
+        return write_inflate(d, data, len);
+    default:
+        return write_raw(d, data, len);
+    }
+}
+
+const char *format_name(uint8_t format)
+{
+    switch (format)
+    {
+    case OTA_COMPRESSION_DEFLATE:
+        return "deflate";
+    case OTA_COMPRESSION_HEATSHRINK:
+        return "heatshrink";
+    case OTA_COMPRESSION_GZIP:
+        return "gzip";
+    default:
+        return "raw";
+    }
+}
+} // namespace
+
+bool ota_decompress_begin(const OtaCompressedHeader &header, const OtaSink &out)
+{
+    Decompressor &d = s_decompressor;
+    d.header = header;
+    d.out = out;
+    d.produced = 0;
+    d.done = false;
+    d.in_gzip_header = header.format == OTA_COMPRESSION_GZIP;
+    d.gzip.begin();
+    d.dict_pos = 0;
+    d.inflate_flags = header.format == OTA_COMPRESSION_DEFLATE ? TINFL_FLAG_PARSE_ZLIB_HEADER : 0;
+    tinfl_init(&d.inflator);
+
+    if (header.format == OTA_COMPRESSION_HEATSHRINK &&
+        !d.heatshrink.begin(header.window_bits, header.lookahead_bits, out))
+    {
+        Serial.println("Unsupported heatshrink parameters!");
+        return false;
+    }
+    return true;
+}
+
+OtaSink ota_decompress_sink()
+{
+    OtaSink sink = {write_compressed, &s_decompressor};
+    return sink;
+}
+
+bool ota_decompress_end()
+{
+    Decompressor &d = s_decompressor;
+    bool ok = true;
+    switch (d.header.format)
+    {
+    case OTA_COMPRESSION_HEATSHRINK:
+        ok = d.heatshrink.finish();
+        d.produced = d.heatshrink.produced();
+        break;
+    case OTA_COMPRESSION_DEFLATE:
+    case OTA_COMPRESSION_GZIP:
+        ok = d.done;
+        break;
+    default:
+        break;
+    }
+    return ok && (d.header.size == 0 || d.produced == d.header.size);
+}
+
+uint32_t ota_decompress_produced()
+{
+    return s_decompressor.produced;
+}
+
+bool ota_image_download(Client &source, size_t length, const char *content_encoding,
+                        const uint8_t *expected_sha256,
+                        const OtaPipelineConfig &config, OtaPipelineStats *stats)
+{
+    if (stats)
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+
+    // Sniff the first bytes for an OTAZ prefix; if there is none they are
+    // part of the stream and go through the decoder like the rest
+    uint8_t prefix[kOtaCompressedHeaderSize];
+    size_t sniffed = min(length, sizeof(prefix));
+    source.setTimeout(config.network_timeout_ms);
+    if (source.readBytes(prefix, sniffed) != sniffed)
+    {
+        Serial.println("Network timeout during OTA update.");
+        return false;
+    }
+
+    OtaCompressedHeader header = {OTA_COMPRESSION_NONE, 0, 0, (uint32_t)length};
+    size_t skip = 0;
+    if (sniffed == sizeof(prefix) && ota_parse_compressed_header(prefix, header))
+    {
+        skip = sizeof(prefix);
+    }
+    else if ((content_encoding && strcasecmp(content_encoding, "gzip") == 0) ||
+             (sniffed >= 2 && prefix[0] == 0x1f && prefix[1] == 0x8b))
+    {
+        header.format = OTA_COMPRESSION_GZIP;
+        header.size = 0;
+    }
+    else if (content_encoding && strcasecmp(content_encoding, "deflate") == 0)
+    {
+        header.format = OTA_COMPRESSION_DEFLATE;
+        header.size = 0;
+    }
+
+    Serial.print("Firmware: ");
+    Serial.print(length / 1024);
+    Serial.print(" KB ");
+    Serial.print(format_name(header.format));
+    if (header.size)
+    {
+        Serial.print(" -> ");
+        Serial.print(header.size / 1024);
+        Serial.print(" KB");
+    }
+    Serial.println();
+
+    if (!Update.begin(header.size ? header.size : UPDATE_SIZE_UNKNOWN))
+    {
+        Serial.println("Not enough space for OTA!");
+        return false;
+    }
+
+    s_digest.begin(ota_update_sink());
+    OtaSink sink = ota_decompress_sink();
+    bool ok = ota_decompress_begin(header, s_digest.sink()) &&
+              ota_sink_write(sink, prefix + skip, sniffed - skip) &&
+              ota_pipeline_run(source, length - sniffed, sink, config, stats) &&
+              ota_decompress_end();
+    if (!ok)
+    {
+        Serial.println("Incomplete firmware received!");
+        Update.abort();
+        return false;
+    }
+
+    uint8_t digest[kOtaSha256Size];
+    s_digest.finish(digest);
+    if (expected_sha256 && !ota_digest_check(digest, expected_sha256))
+    {
+        Update.abort();
+        return false;
+    }
+
+    // With the size unknown up front, Update.end(true) takes what was written
+    if (!Update.end(header.size == 0) || !Update.isFinished())
+    {
+        Serial.println("OTA update failed!");
+        Update.printError(Serial);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+#include "ota_delta.h"
+
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <esp_rom_crc.h>
+
+#include "ota_partition.h"
+
+namespace
+{
+struct DeltaSession
+{
+    OtaDeltaDecoder decoder;
+    const esp_partition_t *running;
+    uint32_t crc; // CRC32 of the image produced so far
+};
+
+// Static: the decoder carries its old/new buffers
+DeltaSession s_delta;
+
+bool read_running(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+    const esp_partition_t *running = static_cast<const esp_partition_t *>(ctx);
+    return esp_partition_read(running, offset, buf, len) == ESP_OK;
+}
+
+// Decoder output: rebuilt image bytes
+bool write_image(void *ctx, const uint8_t *data, size_t len)
+{
+    DeltaSession &s = *static_cast<DeltaSession *>(ctx);
+    s.crc = esp_rom_crc32_le(s.crc, data, len);
+    return Update.write(const_cast<uint8_t *>(data), len) == len;
+}
+
+// Pipeline output: patch bytes
+bool feed_patch(void *ctx, const uint8_t *data, size_t len)
+{
+    DeltaSession &s = *static_cast<DeltaSession *>(ctx);
+    OtaDeltaDecoder::Result result = s.decoder.feed(data, len);
+    if (result == OtaDeltaDecoder::kMoreData || result == OtaDeltaDecoder::kComplete)
+    {
+        return true;
+    }
+    Serial.print("Delta patch error ");
+    Serial.println(result);
+    return false;
+}
+} // namespace
+
+bool ota_delta_download(Client &source, size_t patch_size, const OtaPipelineConfig &config)
+{
+    DeltaSession &s = s_delta;
+
+    uint8_t raw[kOtaDeltaHeaderSize];
+    OtaDeltaHeader header;
+    source.setTimeout(config.network_timeout_ms);
+    if (patch_size < kOtaDeltaHeaderSize ||
+        source.readBytes(raw, sizeof(raw)) != sizeof(raw) ||
+        !OtaDeltaDecoder::parseHeader(raw, header))
+    {
+        Serial.println("Invalid delta patch!");
+        return false;
+    }
+
+    // The patch only applies to the exact image it was made against
+    s.running = esp_ota_get_running_partition();
+    uint32_t crc = 0;
+    if (!s.running || header.old_size > s.running->size ||
+        !OtaPartitionWriter::crcOf(s.running, header.old_size, &crc) || crc != header.old_crc)
+    {
+        Serial.println("Delta patch was made for a different firmware");
+        return false;
+    }
+
+    Serial.print("Delta patch: ");
+    Serial.print(patch_size / 1024);
+    Serial.print(" KB -> firmware ");
+    Serial.print(header.new_size / 1024);
+    Serial.println(" KB");
+
+    if (!Update.begin(header.new_size))
+    {
+        Serial.println("Not enough space for OTA!");
+        return false;
+    }
+
+    s.crc = 0;
+    OtaSink image = {write_image, &s};
+    s.decoder.begin(header, read_running, (void *)s.running, image);
+
+    OtaSink patch = {feed_patch, &s};
+    OtaPipelineStats stats;
+    bool ok = ota_pipeline_run(source, patch_size - kOtaDeltaHeaderSize, patch, config, &stats);
+    ota_pipeline_print_stats(stats, Serial);
+
+    if (!ok || s.decoder.produced() != header.new_size || s.crc != header.new_crc)
+    {
+        Serial.println("Delta update failed!");
+        Update.abort();
+        return false;
+    }
+    if (!Update.end() || !Update.isFinished())
+    {
+        Serial.println("OTA update failed!");
+        Update.printError(Serial);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#include "ota_digest.h"
+
+#include <Arduino.h>
+
+namespace
+{
+void print_hex(const uint8_t *digest)
+{
+    for (size_t i = 0; i < kOtaSha256Size; i++)
+    {
+        Serial.printf("%02x", digest[i]);
+    }
+    Serial.println();
+}
+} // namespace
+
+bool ota_digest_partition(const esp_partition_t *partition, size_t len,
+                          uint8_t digest[kOtaSha256Size])
+{
+    static uint8_t buffer[1024];
+    OtaSha256 sha;
+    sha.begin();
+    for (size_t pos = 0; pos < len; pos += sizeof(buffer))
+    {
+        size_t chunk = min(sizeof(buffer), len - pos);
+        if (esp_partition_read(partition, pos, buffer, chunk) != ESP_OK)
+        {
+            return false;
+        }
+        sha.update(buffer, chunk);
+    }
+    sha.finish(digest);
+    return true;
+}
+
+bool ota_digest_check(const uint8_t *actual, const uint8_t *expected)
+{
+    if (memcmp(actual, expected, kOtaSha256Size) == 0)
+    {
+        return true;
+    }
+    Serial.println("Firmware SHA-256 mismatch!");
+    Serial.print("  expected ");
+    print_hex(expected);
+    Serial.print("  received ");
+    print_hex(actual);
+    return false;
+}
@@ -0,0 +1,96 @@
+#include "ota_flow.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "ota_uart.h"
+
+namespace
+{
+HardwareSerial *s_serial = nullptr;
+SemaphoreHandle_t s_rx_event = NULL;
+
+// Runs in the UART driver's event task
+void on_receive()
+{
+    xSemaphoreGive(s_rx_event);
+}
+
+uint32_t percent(uint32_t part, uint32_t whole)
+{
+    return whole ? (uint32_t)(((uint64_t)part * 100) / whole) : 0;
+}
+} // namespace
+
+void ota_flow_attach(HardwareSerial &serial)
+{
+    if (!s_rx_event)
+    {
+        s_rx_event = xSemaphoreCreateBinary();
+    }
+    s_serial = &serial;
+    serial.onReceive(on_receive);
+}
+
+void OtaFlowControl::begin(uint32_t maxWaitMs)
+{
+    iMaxWaitMs = max(maxWaitMs, (uint32_t)OTA_FLOW_MIN_WAIT_MS);
+    iWaitMs = OTA_FLOW_MIN_WAIT_MS;
+    iStartMs = millis();
+    memset(&iStats, 0, sizeof(iStats));
+}
+
+void OtaFlowControl::idle()
+{
+    uint32_t start = millis();
+    bool woken = false;
+
+    if (ota_uart_attached())
+    {
+        woken = ota_uart_wait(iWaitMs);
+    }
+    else if (s_rx_event)
+    {
+        // Bytes already waiting belong to the caller's next poll, not to a nap
+        if (s_serial->available() > 0)
+        {
+            return;
+        }
+        // Drop a stale event left by the reply to the last poll, then look
+        // again so nothing that arrived in between is slept through
+        xSemaphoreTake(s_rx_event, 0);
+        if (s_serial->available() > 0)
+        {
+            return;
+        }
+        woken = xSemaphoreTake(s_rx_event, pdMS_TO_TICKS(iWaitMs)) == pdTRUE;
+    }
+    else
+    {
+        delay(iWaitMs);
+    }
+
+    iStats.idle_ms += millis() - start;
+    iStats.waits++;
+    if (woken)
+    {
+        iStats.wakeups++;
+    }
+    else
+    {
+        iWaitMs = min(iWaitMs * 2, iMaxWaitMs);
+    }
+}
+
+void OtaFlowControl::end()
+{
+    iStats.elapsed_ms = millis() - iStartMs;
+}
+
+void ota_flow_print_stats(const OtaFlowStats &stats, Print &out)
+{
+    uint32_t busy_ms = stats.elapsed_ms > stats.idle_ms ? stats.elapsed_ms - stats.idle_ms : 0;
+    out.printf("  flow: busy %u ms (%u%%), idle %u ms (%u%%), %u waits, %u woken by modem data\n",
+               busy_ms, percent(busy_ms, stats.elapsed_ms), stats.idle_ms,
+               percent(stats.idle_ms, stats.elapsed_ms), stats.waits, stats.wakeups);
+}
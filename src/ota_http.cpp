@@ -0,0 +1,94 @@
+#include "ota_http.h"
+
+bool ota_http_get(HttpClient &http, const char *path, const char *range,
+                  const char *if_range, OtaHttpResponse &response,
+                  const char *accept_encoding)
+{
+    response.status = 0;
+    response.content_length = HttpClient::kNoContentLengthHeader;
+    response.etag = "";
+    response.last_modified = "";
+    response.content_range = "";
+    response.content_encoding = "";
+    response.sha256 = "";
+
+    http.beginRequest();
+    if (http.get(path) != 0)
+    {
+        Serial.println("Connection Failed");
+        return false;
+    }
+    if (range)
+    {
+        http.sendHeader("Range", range);
+    }
+    if (if_range && if_range[0])
+    {
+        // Server answers 200 with the full new file if it changed
+        http.sendHeader("If-Range", if_range);
+    }
+    if (accept_encoding)
+    {
+        http.sendHeader("Accept-Encoding", accept_encoding);
+    }
+    http.endRequest();
+
+    response.status = http.responseStatusCode();
+    if (response.status < 0)
+    {
+        return false;
+    }
+    while (http.headerAvailable())
+    {
+        String name = http.readHeaderName();
+        if (name.equalsIgnoreCase("ETag"))
+            response.etag = http.readHeaderValue();
+        else if (name.equalsIgnoreCase("Last-Modified"))
+            response.last_modified = http.readHeaderValue();
+        else if (name.equalsIgnoreCase("Content-Range"))
+            response.content_range = http.readHeaderValue();
+        else if (name.equalsIgnoreCase("Content-Encoding"))
+            response.content_encoding = http.readHeaderValue();
+        else if (name.equalsIgnoreCase("X-Firmware-SHA256"))
+            response.sha256 = http.readHeaderValue();
+    }
+    response.content_length = http.contentLength();
+    return true;
+}
+
+bool ota_http_get_manifest(HttpClient &http, const char *path, OtaManifest &manifest)
+{
+    memset(&manifest, 0, sizeof(manifest));
+    OtaHttpResponse response;
+    if (!ota_http_get(http, path, nullptr, nullptr, response) || response.status != 200)
+    {
+        return false;
+    }
+
+    bool ok = http.readStringUntil('\n').startsWith("OTA-MANIFEST 1");
+    while (ok && !http.endOfBodyReached() && (http.connected() || http.available()))
+    {
+        String line = http.readStringUntil('\n');
+        line.trim();
+        ok = ota_manifest_parse_line(manifest, line.c_str());
+    }
+    if (!ok || manifest.size == 0)
+    {
+        Serial.println("Invalid OTA manifest!");
+        return false;
+    }
+    return true;
+}
+
+bool ota_parse_content_range(const String &value, uint32_t *first, uint32_t *total)
+{
+    int dash = value.indexOf('-');
+    int slash = value.indexOf('/');
+    if (!value.startsWith("bytes ") || dash < 0 || slash < dash)
+    {
+        return false;
+    }
+    *first = value.substring(6, dash).toInt();
+    *total = value.substring(slash + 1).toInt();
+    return true;
+}
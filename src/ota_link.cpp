@@ -0,0 +1,121 @@
+#include "ota_link.h"
+
+#include <Preferences.h>
+#include <driver/uart.h>
+
+namespace
+{
+const char *kNamespace = "ota_link";
+const char *kBaudKey = "baud";
+const uint8_t kRtsThreshold = 64; // RX FIFO bytes before RTS drops
+
+struct SerialPort
+{
+    HardwareSerial *serial;
+    int8_t rts_pin;
+    int8_t cts_pin;
+};
+
+SerialPort s_port;
+uint32_t s_baud;        // rate the link is at
+bool s_flow_control;
+
+void serial_set_baud(void *ctx, uint32_t baud)
+{
+    HardwareSerial &serial = *static_cast<SerialPort *>(ctx)->serial;
+    serial.flush();
+    serial.updateBaudRate(baud);
+}
+
+bool serial_set_flow_control(void *ctx, bool on)
+{
+    SerialPort &port = *static_cast<SerialPort *>(ctx);
+    if (port.rts_pin < 0 || port.cts_pin < 0)
+    {
+        return false;
+    }
+    if (on && !port.serial->setPins(-1, -1, port.cts_pin, port.rts_pin))
+    {
+        return false;
+    }
+    return port.serial->setHwFlowCtrlMode(on ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE,
+                                          kRtsThreshold);
+}
+
+void save_baud(uint32_t baud)
+{
+    Preferences prefs;
+    prefs.begin(kNamespace, false);
+    prefs.putUInt(kBaudKey, baud);
+    prefs.end();
+}
+} // namespace
+
+uint32_t ota_link_saved_baud(uint32_t fallback)
+{
+    Preferences prefs;
+    prefs.begin(kNamespace, true);
+    uint32_t baud = prefs.getUInt(kBaudKey, fallback);
+    prefs.end();
+    return baud;
+}
+
+uint32_t ota_link_begin(HardwareSerial &serial, int8_t rts_pin, int8_t cts_pin,
+                        uint32_t max_baud, OtaLinkStats *stats)
+{
+    s_port.serial = &serial;
+    s_port.rts_pin = rts_pin;
+    s_port.cts_pin = cts_pin;
+    OtaLinkPort port = {&serial, serial_set_baud, serial_set_flow_control, &s_port};
+    OtaLink link(port);
+
+    uint32_t saved = ota_link_saved_baud(0);
+    uint32_t current = serial.baudRate();
+    uint32_t baud = saved && saved <= max_baud && link.verify(saved) ? saved : link.negotiate(current, max_baud);
+    if (baud && baud != saved)
+    {
+        save_baud(baud);
+    }
+    s_baud = baud;
+    s_flow_control = link.stats().flow_control;
+    if (stats)
+    {
+        *stats = link.stats();
+    }
+    return baud;
+}
+
+uint32_t ota_link_step_down(uint32_t min_baud, OtaLinkStats *stats)
+{
+    if (!s_port.serial || !s_baud)
+    {
+        return 0;
+    }
+    OtaLinkPort port = {s_port.serial, serial_set_baud, serial_set_flow_control, &s_port};
+    OtaLink link(port);
+    uint32_t baud = link.stepDown(s_baud, min_baud);
+    if (baud && baud != s_baud)
+    {
+        save_baud(baud);
+    }
+    s_baud = baud;
+    if (stats)
+    {
+        *stats = link.stats();
+        stats->flow_control = s_flow_control;
+    }
+    return baud;
+}
+
+void ota_link_print_stats(const OtaLinkStats &stats, Print &out)
+{
+    if (!stats.baud)
+    {
+        out.printf("Modem link: no answer at any rate (%u ms)\n", stats.elapsed_ms);
+        return;
+    }
+    out.printf("Modem link: %u baud, flow control %s, %s in %u ms (%u rate changes, %u failed)\n",
+               stats.baud, stats.flow_control ? "on" : "off",
+               stats.verified ? "stored rate verified" : "negotiated", stats.elapsed_ms,
+               stats.attempts, stats.fallbacks);
+}
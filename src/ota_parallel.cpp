@@ -0,0 +1,292 @@
+#include "ota_parallel.h"
+
+#include <ArduinoHttpClient.h>
+#include <esp_ota_ops.h>
+
+#include "ota_http.h"
+#include "ota_partition.h"
+
+namespace
+{
+const size_t kReadChunk = 1024;
+
+// One socket and the segment it is currently fetching
+struct Slot
+{
+    HttpClient *http;
+    OtaPartitionWriter writer;
+    bool busy;
+    size_t first; // absolute offset of the segment start
+    size_t pos;  // absolute offset of the next byte expected
+    size_t end;  // absolute offset one past the segment
+    uint32_t started_ms;
+    uint32_t last_data_ms;
+};
+
+Slot s_slots[OTA_PARALLEL_MAX_SOCKETS];
+uint8_t s_buffer[kReadChunk];
+
+// Requests [first, first + segment) on `slot`. On the very first request
+// (`total` still 0) the image size is learnt from Content-Range, or from
+// Content-Length if the server ignores ranges and sends the whole file.
+bool start_segment(Slot &slot, const char *path, const esp_partition_t *target,
+                   size_t first, size_t *total)
+{
+    size_t last = first + OTA_PARALLEL_SEGMENT_SIZE - 1;
+    if (*total && last >= *total)
+    {
+        last = *total - 1;
+    }
+    char range[40];
+    snprintf(range, sizeof(range), "bytes=%u-%u", (unsigned)first, (unsigned)last);
+
+    OtaHttpResponse response;
+    if (!ota_http_get(*slot.http, path, range, nullptr, response))
+    {
+        return false;
+    }
+
+    if (response.status == 206)
+    {
+        uint32_t start = 0, size = 0;
+        if (!ota_parse_content_range(response.content_range, &start, &size) || start != first ||
+            (*total && size != *total))
+        {
+            Serial.println("Unexpected Content-Range!");
+            return false;
+        }
+        *total = size;
+        slot.end = min(last + 1, (size_t)size);
+    }
+    else if (response.status == 200 && first == 0 && response.content_length > 0)
+    {
+        // No range support: this socket gets the whole image
+        Serial.println("Server ignores Range, downloading on one socket");
+        *total = response.content_length;
+        slot.end = *total;
+    }
+    else
+    {
+        Serial.print("HTTP GET failed! Error code = ");
+        Serial.println(response.status);
+        return false;
+    }
+
+    if (response.content_length >= 0 && (size_t)response.content_length != slot.end - first)
+    {
+        Serial.println("Content-Length does not match the requested range!");
+        return false;
+    }
+
+    slot.busy = true;
+    slot.first = first;
+    slot.pos = first;
+    slot.last_data_ms = millis();
+    return slot.writer.begin(target, first);
+}
+
+// Moves whatever the socket has buffered into flash. Returns the number of
+// bytes moved, or -1 on failure. `manifest`, if set, has a CRC for every
+// segment, checked as soon as the segment is complete.
+int pump(Slot &slot, OtaSocketStats &st, const OtaPipelineConfig &config,
+         const OtaManifest *manifest)
+{
+    int avail = slot.http->available();
+    if (avail <= 0)
+    {
+        if ((millis() - slot.last_data_ms) > config.network_timeout_ms)
+        {
+            Serial.println("Network timeout during OTA update.");
+            return -1;
+        }
+        return 0;
+    }
+
+    size_t want = min(min((size_t)avail, kReadChunk), slot.end - slot.pos);
+    int n = slot.http->read(s_buffer, want);
+    if (n <= 0)
+    {
+        return 0;
+    }
+    if (!slot.writer.write(s_buffer, n))
+    {
+        return -1;
+    }
+    slot.pos += n;
+    slot.last_data_ms = millis();
+    st.bytes += n;
+
+    if (slot.pos == slot.end)
+    {
+        if (!slot.writer.flush())
+        {
+            return -1;
+        }
+        size_t segment = slot.first / OTA_PARALLEL_SEGMENT_SIZE;
+        if (manifest && slot.end - slot.first <= OTA_PARALLEL_SEGMENT_SIZE &&
+            slot.writer.crc() != manifest->crc[segment])
+        {
+            Serial.print("Segment ");
+            Serial.print(segment);
+            Serial.println(" failed its CRC check!");
+            return -1;
+        }
+        slot.busy = false;
+        st.segments++;
+        st.active_ms = millis() - slot.started_ms;
+    }
+    return n;
+}
+} // namespace
+
+bool ota_parallel_download(Client *const *clients, uint8_t count,
+                           const char *host, uint16_t port, const char *path,
+                           const OtaManifest *manifest,
+                           const OtaPipelineConfig &config, OtaParallelStats *stats)
+{
+    OtaParallelStats local;
+    OtaParallelStats &st = stats ? *stats : local;
+    memset(&st, 0, sizeof(st));
+
+    const esp_partition_t *target = esp_ota_get_next_update_partition(NULL);
+    if (!target || count == 0)
+    {
+        Serial.println("No OTA partition available!");
+        return false;
+    }
+    count = min(count, (uint8_t)OTA_PARALLEL_MAX_SOCKETS);
+    st.sockets = count;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        s_slots[i].http = new HttpClient(*clients[i], host, port);
+        s_slots[i].http->connectionKeepAlive();
+        s_slots[i].busy = false;
+    }
+
+    uint32_t startMillis = millis();
+    size_t total = 0;
+    size_t next = 0;
+    bool ok = false;
+    int progress = 0;
+    OtaFlowControl flow;
+    flow.begin(config.idle_delay_ms);
+
+    // The first segment also tells us how big the image is
+    s_slots[0].started_ms = startMillis;
+    if (start_segment(s_slots[0], path, target, 0, &total))
+    {
+        next = s_slots[0].end;
+        ok = true;
+        Serial.print("Firmware size: ");
+        Serial.print(total / 1024);
+        Serial.print(" KB over ");
+        Serial.print(count);
+        Serial.println(" sockets");
+
+        if (manifest && manifest->size != total)
+        {
+            Serial.println("Manifest is for a different image!");
+            ok = false;
+        }
+    }
+    const OtaManifest *segments =
+        manifest && ota_manifest_has_segments(*manifest, OTA_PARALLEL_SEGMENT_SIZE) ? manifest : nullptr;
+
+    while (ok && st.bytes < total)
+    {
+        bool moved = false;
+        for (uint8_t i = 0; i < count && ok; i++)
+        {
+            Slot &slot = s_slots[i];
+            if (!slot.busy)
+            {
+                if (next < total)
+                {
+                    if (!st.socket[i].segments && !st.socket[i].bytes)
+                    {
+                        slot.started_ms = millis();
+                    }
+                    ok = start_segment(slot, path, target, next, &total);
+                    next = slot.end;
+                }
+                continue;
+            }
+
+            int n = pump(slot, st.socket[i], config, segments);
+            if (n < 0)
+            {
+                ok = false;
+            }
+            else if (n > 0)
+            {
+                moved = true;
+                st.bytes += n;
+            }
+        }
+
+        // Progress indicator every 5%
+        int newProgress = total ? (st.bytes * 100) / total : 0;
+        if (newProgress - progress >= 5)
+        {
+            progress = newProgress;
+            Serial.print("\rOTA Progress: ");
+            Serial.print(progress);
+            Serial.println("%");
+        }
+
+        if (moved)
+        {
+            flow.data();
+        }
+        else if (ok)
+        {
+            flow.idle();
+        }
+    }
+    st.elapsed_ms = millis() - startMillis;
+    flow.end();
+    st.flow = flow.stats();
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        s_slots[i].http->stop();
+        delete s_slots[i].http;
+        s_slots[i].http = nullptr;
+    }
+
+    if (!ok || st.bytes != total)
+    {
+        Serial.println("Incomplete firmware received!");
+        return false;
+    }
+
+    if (manifest && manifest->has_sha256)
+    {
+        uint8_t digest[kOtaSha256Size];
+        if (!ota_digest_partition(target, total, digest) || !ota_digest_check(digest, manifest->sha256))
+        {
+            return false;
+        }
+    }
+    return s_slots[0].writer.activate();
+}
+
+static uint32_t bytes_per_second(size_t bytes, uint32_t ms)
+{
+    return ms ? (uint32_t)(((uint64_t)bytes * 1000) / ms) : 0;
+}
+
+void ota_parallel_print_stats(const OtaParallelStats &stats, Print &out)
+{
+    out.printf("OTA parallel: %u bytes in %u ms, %u B/s aggregate over %u sockets\n",
+               stats.bytes, stats.elapsed_ms, bytes_per_second(stats.bytes, stats.elapsed_ms),
+               stats.sockets);
+    for (uint8_t i = 0; i < stats.sockets; i++)
+    {
+        const OtaSocketStats &s = stats.socket[i];
+        out.printf("  socket %u: %u bytes, %u segments, %u ms, %u B/s\n",
+                   i, s.bytes, s.segments, s.active_ms, bytes_per_second(s.bytes, s.active_ms));
+    }
+    ota_flow_print_stats(stats.flow, out);
+}
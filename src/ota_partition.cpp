@@ -0,0 +1,96 @@
+#include "ota_partition.h"
+
+#include <esp_ota_ops.h>
+#include <esp_rom_crc.h>
+
+bool OtaPartitionWriter::begin(const esp_partition_t *partition, size_t offset, uint32_t crc)
+{
+    if (!partition || offset % kSectorSize || offset > partition->size)
+    {
+        return false;
+    }
+    iPartition = partition;
+    iOffset = offset;
+    iCrc = crc;
+    iFill = 0;
+    return true;
+}
+
+bool OtaPartitionWriter::write(const uint8_t *data, size_t len)
+{
+    if (!iPartition)
+    {
+        return false;
+    }
+    while (len > 0)
+    {
+        size_t chunk = min(len, kSectorSize - iFill);
+        memcpy(iSector + iFill, data, chunk);
+        iFill += chunk;
+        data += chunk;
+        len -= chunk;
+        if (iFill == kSectorSize && !writeSector(kSectorSize))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OtaPartitionWriter::flush()
+{
+    return iFill == 0 || writeSector(iFill);
+}
+
+bool OtaPartitionWriter::writeSector(size_t len)
+{
+    if (iOffset + kSectorSize > iPartition->size)
+    {
+        Serial.println("Firmware does not fit in the OTA partition!");
+        return false;
+    }
+    // Only erase the sector we are about to fill, never anything ahead of it
+    if (esp_partition_erase_range(iPartition, iOffset, kSectorSize) != ESP_OK ||
+        esp_partition_write(iPartition, iOffset, iSector, len) != ESP_OK)
+    {
+        Serial.println("Flash write failed!");
+        return false;
+    }
+    iCrc = esp_rom_crc32_le(iCrc, iSector, len);
+    iOffset += len;
+    iFill = 0;
+    return true;
+}
+
+bool OtaPartitionWriter::activate()
+{
+    if (!iPartition)
+    {
+        return false;
+    }
+    esp_err_t err = esp_ota_set_boot_partition(iPartition);
+    if (err != ESP_OK)
+    {
+        Serial.print("Image rejected: ");
+        Serial.println(esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+bool OtaPartitionWriter::crcOf(const esp_partition_t *partition, size_t len, uint32_t *crc, size_t from)
+{
+    uint8_t buffer[512];
+    uint32_t result = 0;
+    for (size_t pos = 0; pos < len; pos += sizeof(buffer))
+    {
+        size_t chunk = min(sizeof(buffer), len - pos);
+        if (esp_partition_read(partition, from + pos, buffer, chunk) != ESP_OK)
+        {
+            return false;
+        }
+        result = esp_rom_crc32_le(result, buffer, chunk);
+    }
+    *crc = result;
+    return true;
+}
@@ -0,0 +1,301 @@
+#include "ota_pipeline.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+namespace
+{
+const EventBits_t kReaderDone = BIT0;
+const EventBits_t kWriterDone = BIT1;
+
+const uint32_t kReaderStackSize = 8192; // TinyGSM builds Strings while parsing AT replies
+const uint32_t kWriterStackSize = 4096;
+const UBaseType_t kReaderPriority = 1;
+const UBaseType_t kWriterPriority = 2; // start flash writes as soon as a buffer is ready
+
+// How often a blocked stage wakes up to check for an abort
+const TickType_t kAbortPollTicks = pdMS_TO_TICKS(100);
+
+// A filled buffer travelling from the reader to the writer. A zero length
+// marks the end of the stream (sent once, on success or abort).
+struct Block
+{
+    uint8_t index;
+    size_t len;
+};
+
+struct Pipeline
+{
+    Client *source;
+    size_t length;
+    OtaSink sink;
+    OtaPipelineConfig config;
+    QueueHandle_t free_blocks; // indices of empty buffers
+    QueueHandle_t full_blocks; // Blocks waiting to be written
+    EventGroupHandle_t done;
+    OtaFlowControl flow;
+    OtaPipelineStats stats;
+};
+
+uint8_t s_buffers[OTA_PIPELINE_BUFFER_COUNT][OTA_PIPELINE_BUFFER_SIZE];
+Pipeline s_pipeline;
+
+portMUX_TYPE s_error_lock = portMUX_INITIALIZER_UNLOCKED;
+volatile OtaPipelineError s_error = OTA_PIPELINE_OK;
+
+// The first stage to fail decides the reported error
+void fail(OtaPipelineError error)
+{
+    portENTER_CRITICAL(&s_error_lock);
+    if (s_error == OTA_PIPELINE_OK)
+    {
+        s_error = error;
+    }
+    portEXIT_CRITICAL(&s_error_lock);
+}
+
+bool aborted()
+{
+    return s_error != OTA_PIPELINE_OK;
+}
+
+// Fills one buffer from the socket. Returns early with a partial buffer
+// when the modem has nothing more for us, so the writer is never starved
+// while data sits in RAM.
+size_t fill_buffer(Pipeline &p, uint8_t *buffer, size_t want, uint32_t &lastDataMillis)
+{
+    OtaStageStats &st = p.stats.reader;
+    size_t len = 0;
+
+    while (len < want && !aborted())
+    {
+        uint32_t pollStart = millis();
+        int avail = p.source->available();
+        if (avail > 0)
+        {
+            size_t chunk = min((size_t)avail, want - len);
+            int n = p.source->read(buffer + len, chunk);
+            st.busy_ms += millis() - pollStart;
+            if (n > 0)
+            {
+                len += n;
+                lastDataMillis = millis();
+                p.flow.data();
+            }
+            continue;
+        }
+
+        if (len > 0)
+        {
+            break;
+        }
+        if (!p.source->connected())
+        {
+            fail(OTA_PIPELINE_DISCONNECTED);
+            break;
+        }
+        if ((millis() - lastDataMillis) > p.config.network_timeout_ms)
+        {
+            fail(OTA_PIPELINE_NETWORK_TIMEOUT);
+            break;
+        }
+        p.flow.idle();
+    }
+    return len;
+}
+
+void reader_task(void *)
+{
+    Pipeline &p = s_pipeline;
+    OtaStageStats &st = p.stats.reader;
+    size_t remaining = p.length;
+    uint32_t lastDataMillis = millis();
+    p.flow.begin(p.config.idle_delay_ms);
+
+    while (remaining > 0 && !aborted())
+    {
+        uint8_t index;
+        uint32_t waitStart = millis();
+        BaseType_t got = xQueueReceive(p.free_blocks, &index, kAbortPollTicks);
+        st.wait_ms += millis() - waitStart;
+        if (got != pdTRUE)
+        {
+            continue; // writer still busy: back-pressure
+        }
+
+        size_t want = min((size_t)OTA_PIPELINE_BUFFER_SIZE, remaining);
+        size_t len = fill_buffer(p, s_buffers[index], want, lastDataMillis);
+        if (len == 0)
+        {
+            xQueueSend(p.free_blocks, &index, 0);
+            continue;
+        }
+
+        Block block = {index, len};
+        xQueueSend(p.full_blocks, &block, portMAX_DELAY);
+        st.bytes += len;
+        remaining -= len;
+    }
+
+    p.flow.end();
+    p.stats.flow = p.flow.stats();
+    Block end = {0, 0};
+    xQueueSend(p.full_blocks, &end, portMAX_DELAY);
+    xEventGroupSetBits(p.done, kReaderDone);
+    vTaskDelete(NULL);
+}
+
+void writer_task(void *)
+{
+    Pipeline &p = s_pipeline;
+    OtaStageStats &st = p.stats.writer;
+    int progress = 0;
+
+    for (;;)
+    {
+        Block block;
+        uint32_t waitStart = millis();
+        xQueueReceive(p.full_blocks, &block, portMAX_DELAY);
+        st.wait_ms += millis() - waitStart;
+        if (block.len == 0)
+        {
+            break;
+        }
+
+        // After an abort keep draining so the reader can never block on us
+        if (!aborted())
+        {
+            uint32_t writeStart = millis();
+            if (ota_sink_write(p.sink, s_buffers[block.index], block.len))
+            {
+                st.bytes += block.len;
+            }
+            else
+            {
+                fail(OTA_PIPELINE_WRITE_FAILED);
+            }
+            st.busy_ms += millis() - writeStart;
+
+            // Progress indicator every 5%
+            int newProgress = (st.bytes * 100) / p.length;
+            if (newProgress - progress >= 5 || st.bytes == p.length)
+            {
+                progress = newProgress;
+                Serial.print("\rOTA Progress: ");
+                Serial.print(progress);
+                Serial.println("%");
+            }
+        }
+        xQueueSend(p.free_blocks, &block.index, portMAX_DELAY);
+    }
+
+    xEventGroupSetBits(p.done, kWriterDone);
+    vTaskDelete(NULL);
+}
+
+void release(Pipeline &p)
+{
+    if (p.free_blocks)
+        vQueueDelete(p.free_blocks);
+    if (p.full_blocks)
+        vQueueDelete(p.full_blocks);
+    if (p.done)
+        vEventGroupDelete(p.done);
+    p.free_blocks = NULL;
+    p.full_blocks = NULL;
+    p.done = NULL;
+}
+} // namespace
+
+bool ota_pipeline_run(Client &source, size_t length, const OtaSink &sink,
+                      const OtaPipelineConfig &config, OtaPipelineStats *stats)
+{
+    Pipeline &p = s_pipeline;
+    memset(&p, 0, sizeof(p));
+    p.source = &source;
+    p.length = length;
+    p.sink = sink;
+    p.config = config;
+    s_error = OTA_PIPELINE_OK;
+
+    p.free_blocks = xQueueCreate(OTA_PIPELINE_BUFFER_COUNT, sizeof(uint8_t));
+    // One extra slot so the end-of-stream marker always fits
+    p.full_blocks = xQueueCreate(OTA_PIPELINE_BUFFER_COUNT + 1, sizeof(Block));
+    p.done = xEventGroupCreate();
+    if (!p.free_blocks || !p.full_blocks || !p.done)
+    {
+        release(p);
+        p.stats.error = OTA_PIPELINE_NO_RESOURCES;
+        if (stats)
+            *stats = p.stats;
+        return false;
+    }
+    for (uint8_t i = 0; i < OTA_PIPELINE_BUFFER_COUNT; i++)
+    {
+        xQueueSend(p.free_blocks, &i, 0);
+    }
+
+    uint32_t startMillis = millis();
+    EventBits_t waitFor = 0;
+    if (xTaskCreatePinnedToCore(writer_task, "ota_writer", kWriterStackSize, NULL,
+                                kWriterPriority, NULL, OTA_PIPELINE_WRITER_CORE) == pdPASS)
+    {
+        waitFor |= kWriterDone;
+    }
+    else
+    {
+        fail(OTA_PIPELINE_NO_RESOURCES);
+    }
+
+    if (waitFor && xTaskCreatePinnedToCore(reader_task, "ota_reader", kReaderStackSize, NULL,
+                                           kReaderPriority, NULL, OTA_PIPELINE_READER_CORE) == pdPASS)
+    {
+        waitFor |= kReaderDone;
+    }
+    else if (waitFor)
+    {
+        // No reader: stop the writer ourselves
+        fail(OTA_PIPELINE_NO_RESOURCES);
+        Block end = {0, 0};
+        xQueueSend(p.full_blocks, &end, portMAX_DELAY);
+    }
+
+    if (waitFor)
+    {
+        xEventGroupWaitBits(p.done, waitFor, pdTRUE, pdTRUE, portMAX_DELAY);
+    }
+
+    p.stats.elapsed_ms = millis() - startMillis;
+    p.stats.error = s_error;
+    release(p);
+
+    if (stats)
+        *stats = p.stats;
+    return p.stats.error == OTA_PIPELINE_OK && p.stats.writer.bytes == length;
+}
+
+void ota_pipeline_abort()
+{
+    fail(OTA_PIPELINE_ABORTED);
+}
+
+static uint32_t bytes_per_second(size_t bytes, uint32_t ms)
+{
+    return ms ? (uint32_t)(((uint64_t)bytes * 1000) / ms) : 0;
+}
+
+void ota_pipeline_print_stats(const OtaPipelineStats &stats, Print &out)
+{
+    out.printf("OTA pipeline: %u ms, %u B/s overall, error %d\n",
+               stats.elapsed_ms, bytes_per_second(stats.writer.bytes, stats.elapsed_ms),
+               stats.error);
+    out.printf("  reader: %u bytes, busy %u ms (%u B/s), blocked by writer %u ms\n",
+               stats.reader.bytes, stats.reader.busy_ms,
+               bytes_per_second(stats.reader.bytes, stats.reader.busy_ms), stats.reader.wait_ms);
+    out.printf("  writer: %u bytes, busy %u ms (%u B/s), starved %u ms\n",
+               stats.writer.bytes, stats.writer.busy_ms,
+               bytes_per_second(stats.writer.bytes, stats.writer.busy_ms), stats.writer.wait_ms);
+    ota_flow_print_stats(stats.flow, out);
+}
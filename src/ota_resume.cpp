@@ -0,0 +1,303 @@
+#include "ota_resume.h"
+
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+
+#include "ota_http.h"
+#include "ota_partition.h"
+
+namespace
+{
+const char *kNamespace = "ota_resume";
+const size_t kCheckpointBytes = OTA_RESUME_CHECKPOINT_SECTORS * OtaPartitionWriter::kSectorSize;
+
+struct Session
+{
+    OtaPartitionWriter writer;
+    OtaResumeState state;
+    size_t checkpointed;
+    const OtaManifest *segments; // null unless segment CRCs are checked
+    size_t pos;                  // bytes handed to the writer so far
+    size_t segment_start;
+    uint32_t segment_start_crc;  // CRC32 of everything before segment_start
+    uint32_t segment_crc;        // CRC32 of the segment so far
+};
+
+// Static: the writer carries a whole flash sector
+Session s_session;
+
+// Called with pos on a segment boundary. On a mismatch the checkpoint goes
+// back to the segment start, which is sector aligned and fully verified.
+bool segment_done(Session &s)
+{
+    size_t index = s.segment_start / s.segments->segment_size;
+    if (s.segment_crc != s.segments->crc[index])
+    {
+        Serial.print("Segment ");
+        Serial.print(index);
+        Serial.println(" failed its CRC check!");
+        s.state.offset = s.segment_start;
+        s.state.crc = s.segment_start_crc;
+        ota_resume_save(s.state);
+        s.checkpointed = s.segment_start;
+        return false;
+    }
+    s.segment_start = s.pos;
+    s.segment_start_crc = s.writer.crc();
+    s.segment_crc = 0;
+    return true;
+}
+
+bool session_write(void *ctx, const uint8_t *data, size_t len)
+{
+    Session &s = *static_cast<Session *>(ctx);
+    while (len > 0)
+    {
+        size_t chunk = len;
+        size_t segment_end = 0;
+        if (s.segments)
+        {
+            segment_end = min(s.segment_start + s.segments->segment_size, (size_t)s.state.total_size);
+            chunk = min(len, segment_end - s.pos);
+        }
+        if (!s.writer.write(data, chunk))
+        {
+            return false;
+        }
+        if (s.segments)
+        {
+            s.segment_crc = ota_crc32(s.segment_crc, data, chunk);
+            s.pos += chunk;
+            // The last segment is only complete once flush() has run
+            if (s.pos == segment_end && s.pos < s.state.total_size && !segment_done(s))
+            {
+                return false;
+            }
+        }
+        data += chunk;
+        len -= chunk;
+    }
+    if (s.writer.offset() - s.checkpointed >= kCheckpointBytes)
+    {
+        s.state.offset = s.writer.offset();
+        s.state.crc = s.writer.crc();
+        ota_resume_save(s.state);
+        s.checkpointed = s.state.offset;
+    }
+    return true;
+}
+
+// Drops a checkpoint that cannot be continued: different target partition,
+// or flash contents that no longer match the recorded CRC.
+bool checkpoint_valid(const OtaResumeState &state, const esp_partition_t *target)
+{
+    if (strcmp(state.partition, target->label) != 0 ||
+        state.offset > state.total_size ||
+        state.offset % OtaPartitionWriter::kSectorSize)
+    {
+        return false;
+    }
+    uint32_t crc;
+    return OtaPartitionWriter::crcOf(target, state.offset, &crc) && crc == state.crc;
+}
+} // namespace
+
+bool ota_resume_load(OtaResumeState &state)
+{
+    memset(&state, 0, sizeof(state));
+    Preferences prefs;
+    if (!prefs.begin(kNamespace, true))
+    {
+        return false;
+    }
+    prefs.getString("validator", state.validator, sizeof(state.validator));
+    prefs.getString("partition", state.partition, sizeof(state.partition));
+    state.total_size = prefs.getUInt("size", 0);
+    state.offset = prefs.getUInt("offset", 0);
+    state.crc = prefs.getUInt("crc", 0);
+    prefs.end();
+    return state.total_size > 0;
+}
+
+void ota_resume_save(const OtaResumeState &state)
+{
+    Preferences prefs;
+    if (!prefs.begin(kNamespace, false))
+    {
+        return;
+    }
+    prefs.putString("validator", state.validator);
+    prefs.putString("partition", state.partition);
+    prefs.putUInt("size", state.total_size);
+    prefs.putUInt("offset", state.offset);
+    prefs.putUInt("crc", state.crc);
+    prefs.end();
+}
+
+void ota_resume_clear()
+{
+    Preferences prefs;
+    if (prefs.begin(kNamespace, false))
+    {
+        prefs.clear();
+        prefs.end();
+    }
+}
+
+bool ota_resumable_download(HttpClient &http, const char *path,
+                            const OtaManifest *manifest,
+                            const OtaPipelineConfig &config)
+{
+    Session &s = s_session;
+    OtaResumeState &state = s.state;
+
+    const esp_partition_t *target = esp_ota_get_next_update_partition(NULL);
+    if (!target)
+    {
+        Serial.println("No OTA partition available!");
+        return false;
+    }
+
+    if (ota_resume_load(state) && !checkpoint_valid(state, target))
+    {
+        Serial.println("Discarding stale OTA checkpoint");
+        ota_resume_clear();
+        memset(&state, 0, sizeof(state));
+    }
+
+    Serial.println("Sending GET request...");
+    char range[24];
+    if (state.offset > 0)
+    {
+        snprintf(range, sizeof(range), "bytes=%u-", (unsigned)state.offset);
+        Serial.print("Resuming OTA at byte ");
+        Serial.println(state.offset);
+    }
+    OtaHttpResponse response;
+    if (!ota_http_get(http, path, state.offset > 0 ? range : nullptr, state.validator, response))
+    {
+        http.stop();
+        return false;
+    }
+    int httpCode = response.status;
+    long length = response.content_length;
+
+    size_t offset = 0;
+    if (httpCode == 206 && state.offset > 0)
+    {
+        uint32_t first = 0, total = 0;
+        if (!ota_parse_content_range(response.content_range, &first, &total) ||
+            first != state.offset || total != state.total_size)
+        {
+            Serial.println("Unexpected Content-Range, OTA will restart from zero");
+            ota_resume_clear();
+            http.stop();
+            return false;
+        }
+        offset = state.offset;
+    }
+    else if (httpCode == 200)
+    {
+        if (length <= 0)
+        {
+            Serial.println("Invalid firmware size!");
+            http.stop();
+            return false;
+        }
+        if (state.offset > 0)
+        {
+            Serial.println("Firmware changed on the server, OTA restarts from zero");
+        }
+        memset(&state, 0, sizeof(state));
+        const String &validator = response.etag.length() ? response.etag : response.last_modified;
+        strlcpy(state.validator, validator.c_str(), sizeof(state.validator));
+        strlcpy(state.partition, target->label, sizeof(state.partition));
+        state.total_size = length;
+        ota_resume_save(state);
+    }
+    else
+    {
+        Serial.print("HTTP GET failed! Error code = ");
+        Serial.println(httpCode);
+        if (httpCode == 416)
+        {
+            // Our offset is past the end of whatever the server now has
+            ota_resume_clear();
+        }
+        http.stop();
+        return false;
+    }
+
+    size_t remaining = state.total_size - offset;
+    if (length >= 0 && (size_t)length != remaining)
+    {
+        Serial.println("Content-Length does not match the expected remainder!");
+        http.stop();
+        return false;
+    }
+
+    Serial.print("Firmware size: ");
+    Serial.print(state.total_size / 1024);
+    Serial.print(" KB, downloading ");
+    Serial.print(remaining / 1024);
+    Serial.println(" KB");
+
+    if (manifest && manifest->size != state.total_size)
+    {
+        Serial.println("Manifest is for a different image, ignoring it");
+        manifest = nullptr;
+    }
+    s.segments = nullptr;
+    if (manifest && ota_manifest_has_segments(*manifest, manifest->segment_size) &&
+        manifest->segment_size % OtaPartitionWriter::kSectorSize == 0)
+    {
+        // Pick up the segment we stopped in; its head is already in flash
+        s.pos = offset;
+        s.segment_start = offset - offset % manifest->segment_size;
+        s.segment_crc = 0;
+        if (!OtaPartitionWriter::crcOf(target, s.segment_start, &s.segment_start_crc) ||
+            !OtaPartitionWriter::crcOf(target, offset - s.segment_start, &s.segment_crc, s.segment_start))
+        {
+            http.stop();
+            return false;
+        }
+        s.segments = manifest;
+    }
+
+    s.writer.begin(target, offset, state.crc);
+    s.checkpointed = offset;
+    OtaSink sink = {session_write, &s};
+    OtaPipelineStats stats;
+    bool ok = ota_pipeline_run(http, remaining, sink, config, &stats);
+    ota_pipeline_print_stats(stats, Serial);
+    http.stop();
+
+    if (!ok)
+    {
+        Serial.print("OTA interrupted, resumable from byte ");
+        Serial.println(s.checkpointed);
+        return false;
+    }
+
+    // Complete download: whatever happens next, the checkpoint is done with
+    ota_resume_clear();
+    if (!s.writer.flush() || s.writer.offset() != state.total_size)
+    {
+        Serial.println("Incomplete firmware received!");
+        return false;
+    }
+    if (s.segments && !segment_done(s))
+    {
+        return false;
+    }
+    if (manifest && manifest->has_sha256)
+    {
+        uint8_t digest[kOtaSha256Size];
+        if (!ota_digest_partition(target, state.total_size, digest) ||
+            !ota_digest_check(digest, manifest->sha256))
+        {
+            return false;
+        }
+    }
+    return s.writer.activate();
+}
@@ -0,0 +1,14 @@
+#include "ota_sink.h"
+
+#include <Update.h>
+
+static bool update_write(void *, const uint8_t *data, size_t len)
+{
+    return Update.write(const_cast<uint8_t *>(data), len) == len;
+}
+
+OtaSink ota_update_sink()
+{
+    OtaSink sink = {update_write, nullptr};
+    return sink;
+}
@@ -0,0 +1,128 @@
+#include "ota_uart.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#if defined(ESP_ARDUINO_VERSION)
+#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(2, 0, 9)
+#define OTA_UART_HAL_CALLBACKS
+#endif
+#endif
+
+namespace
+{
+HardwareSerial *s_serial = nullptr;
+TaskHandle_t volatile s_waiter = NULL;
+OtaUartStats s_stats;
+
+void wake()
+{
+    TaskHandle_t waiter = s_waiter;
+    if (waiter)
+    {
+        xTaskNotifyGive(waiter);
+    }
+}
+
+#if defined(OTA_UART_HAL_CALLBACKS)
+// Both run in HardwareSerial's UART event task
+void on_receive()
+{
+    s_stats.bursts++;
+    wake();
+}
+
+void on_receive_error(hardwareSerial_error_t error)
+{
+    switch (error)
+    {
+    case UART_FIFO_OVF_ERROR:
+        // Bytes were dropped. The rest is left in place: TinyGSM
+        // resynchronises on the next reply, and flushing here would race
+        // with the task reading it.
+        s_stats.overflows++;
+        break;
+    case UART_BUFFER_FULL_ERROR:
+        // The driver stops emptying the FIFO until the ring buffer has
+        // room again; nothing is lost, the reader has to catch up
+        s_stats.buffer_full++;
+        break;
+    default:
+        s_stats.errors++;
+        break;
+    }
+    wake();
+}
+#endif
+} // namespace
+
+bool ota_uart_attach(HardwareSerial &serial)
+{
+#if defined(OTA_UART_HAL_CALLBACKS)
+    if (s_serial)
+    {
+        return true;
+    }
+    memset(&s_stats, 0, sizeof(s_stats));
+    // Every burst, not only those that end in a timeout; the FIFO
+    // threshold and the timeout are set after, as onReceive() resets them
+    serial.onReceive(on_receive, false);
+    serial.onReceiveError(on_receive_error);
+    serial.setRxFIFOFull(OTA_UART_RX_FIFO_FULL);
+    if (!serial.setRxTimeout(OTA_UART_RX_TIMEOUT))
+    {
+        serial.onReceive(nullptr);
+        serial.onReceiveError(nullptr);
+        return false;
+    }
+    s_serial = &serial;
+    return true;
+#else
+    (void)serial;
+    return false;
+#endif
+}
+
+bool ota_uart_attached()
+{
+    return s_serial != nullptr;
+}
+
+bool ota_uart_wait(uint32_t timeout_ms)
+{
+    if (!s_serial)
+    {
+        delay(0);
+        return false;
+    }
+    s_stats.waits++;
+    // Drop a wakeup left over from traffic nobody waited for, then look
+    // again: bytes that arrived before s_waiter was set wake no one
+    ulTaskNotifyTake(pdTRUE, 0);
+    s_waiter = xTaskGetCurrentTaskHandle();
+    if (s_serial->available() > 0)
+    {
+        s_waiter = NULL;
+        return true;
+    }
+    TickType_t ticks = timeout_ms ? max(pdMS_TO_TICKS(timeout_ms), (TickType_t)1) : 0;
+    bool woken = ulTaskNotifyTake(pdTRUE, ticks) > 0;
+    s_waiter = NULL;
+    if (woken)
+    {
+        s_stats.wakeups++;
+    }
+    return s_serial->available() > 0;
+}
+
+const OtaUartStats &ota_uart_stats()
+{
+    return s_stats;
+}
+
+void ota_uart_print_stats(Print &out)
+{
+    out.printf("Modem UART: %u bursts, %u overflows, %u buffer full, %u errors; %u waits, %u woken by data\n",
+               s_stats.bursts, s_stats.overflows, s_stats.buffer_full, s_stats.errors, s_stats.waits,
+               s_stats.wakeups);
+}
@@ -0,0 +1,242 @@
+// CPU cost of the TinyGSM paths the OTA download runs through, on the host
+// with the Arduino shim (tools/host): AT command round trips through
+// waitResponse(), the RX FIFO, and a socket download through GsmClient
+// with the EC200U's +QIRD framing. The modem end is simulated in memory,
+// so the numbers are parsing overhead only, with no UART or radio time.
+// Heap allocations are counted once the first command has run (the mock
+// modem allocates nothing in steady state).
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target at_bench
+// Run:    ./build/tools/at_bench [download_bytes]
+//
+// Exits 1 if a reply was misread or the download came out corrupt.
+
+#define TINY_GSM_MODEM_EC200U
+#define TINY_GSM_RX_BUFFER 1024
+
+#include <TinyGsmClient.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "alloc_count.h"
+#include "mock_stream.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Keeps benchmark results alive
+static volatile size_t s_sink;
+
+static double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Time stamp counter where there is one (x86), else 0
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Just enough of an EC200U for TinyGSM: AT+CSQ and one buffer-mode socket
+// (connect ID 0) receiving `payload`. The network refills the modem's
+// receive buffer instantly, so it never holds more than kModemBuffer.
+struct Ec200uModel
+{
+    static const size_t kMaxQird = 1500;     // the modem's per-read limit
+    static const size_t kModemBuffer = 16384; // TinyGSM parses the size as int16_t
+
+    std::string payload;
+    size_t delivered;
+    size_t commands;
+
+    Ec200uModel() : delivered(0), commands(0) {}
+
+    void reply(MockModemStream &s, const std::string &line)
+    {
+        char buf[128];
+        unsigned mux, want;
+        commands++;
+
+        if (line == "AT+CSQ")
+        {
+            s.feed("\r\n+CSQ: 23,99\r\n\r\nOK\r\n");
+        }
+        else if (line.compare(0, 10, "AT+QIOPEN=") == 0)
+        {
+            s.feed("\r\nOK\r\n\r\n+QIOPEN: 0,0\r\n");
+            if (delivered < payload.size())
+                s.feed("\r\n+QIURC: \"recv\",0\r\n");
+        }
+        else if (sscanf(line.c_str(), "AT+QIRD=%u,%u", &mux, &want) == 2)
+        {
+            size_t unread = std::min(payload.size() - delivered, kModemBuffer);
+            if (want == 0)
+            {
+                snprintf(buf, sizeof(buf), "\r\n+QIRD: %zu,%zu,%zu\r\n\r\nOK\r\n",
+                         payload.size(), delivered, unread);
+                s.feed(buf);
+                return;
+            }
+            size_t n = std::min(std::min((size_t)want, unread), kMaxQird);
+            snprintf(buf, sizeof(buf), "\r\n+QIRD: %zu\r\n", n);
+            s.feed(buf);
+            s.feed(payload.data() + delivered, n);
+            s.feed("\r\n\r\nOK\r\n");
+            delivered += n;
+        }
+        else if (line.compare(0, 11, "AT+QISTATE=") == 0)
+        {
+            snprintf(buf, sizeof(buf),
+                     "\r\n+QISTATE: 0,\"TCP\",\"10.0.0.1\",80,40000,%d,1,0,0,\"uart1\"\r\n\r\nOK\r\n",
+                     delivered < payload.size() ? 2 : 4);
+            s.feed(buf);
+        }
+        else
+        {
+            s.feed("\r\nOK\r\n");
+        }
+    }
+};
+
+// std::min() binds them by reference
+const size_t Ec200uModel::kMaxQird;
+const size_t Ec200uModel::kModemBuffer;
+
+static bool bench_commands(int count)
+{
+    MockModemStream serial;
+    Ec200uModel model;
+    serial.onLine([&](MockModemStream &s, const std::string &line) { model.reply(s, line); });
+    TinyGsm modem(serial);
+    modem.getSignalQuality();
+    serial.writes = 0;
+
+    size_t allocs = host_alloc_count();
+    Clock::time_point start = Clock::now();
+    int ok = 0;
+    for (int i = 0; i < count; i++)
+        ok += modem.getSignalQuality() == 23;
+    double t = seconds_since(start);
+    allocs = host_alloc_count() - allocs;
+    printf("%-22s %10.0f commands/s  %6.2f us/command  %zu UART writes/command  %.2f heap allocs/command%s\n",
+           "AT+CSQ round trip", count / t, t * 1e6 / count, serial.writes / count, (double)allocs / count,
+           ok == count ? "" : "  (bad replies)");
+    return ok == count;
+}
+
+static bool bench_fifo(size_t bytes)
+{
+    TinyGsmFifo<uint8_t, TINY_GSM_RX_BUFFER> fifo;
+    uint8_t chunk[512];
+    size_t sum = 0;
+    bool ordered = true;
+
+    Clock::time_point start = Clock::now();
+    for (size_t moved = 0; moved < bytes; moved += sizeof(chunk))
+    {
+        for (size_t i = 0; i < sizeof(chunk); i++)
+            fifo.put((uint8_t)i);
+        fifo.get(chunk, sizeof(chunk));
+        sum += chunk[7];
+    }
+    for (size_t i = 0; i < sizeof(chunk); i++)
+        ordered = ordered && chunk[i] == (uint8_t)i;
+    double t_byte = seconds_since(start);
+
+    start = Clock::now();
+    for (size_t moved = 0; moved < bytes; moved += sizeof(chunk))
+    {
+        fifo.put(chunk, sizeof(chunk));
+        fifo.get(chunk, sizeof(chunk));
+        sum += chunk[7];
+    }
+    double t_bulk = seconds_since(start);
+    for (size_t i = 0; i < sizeof(chunk); i++)
+        ordered = ordered && chunk[i] == (uint8_t)i;
+
+    printf("%-22s %10.1f MB/s\n", "fifo put(c)/get(n)", bytes / t_byte / 1e6);
+    printf("%-22s %10.1f MB/s%s\n", "fifo put(n)/get(n)", bytes / t_bulk / 1e6, ordered ? "" : "  (corrupt)");
+    s_sink = sum;
+    return ordered;
+}
+
+// Reads through read(buf, n), or with `spans` in place via readSpan()
+static bool bench_download(size_t bytes, bool spans)
+{
+    MockModemStream serial;
+    Ec200uModel model;
+    model.payload.resize(bytes);
+    for (size_t i = 0; i < bytes; i++)
+        model.payload[i] = (char)(i * 7);
+    serial.onLine([&](MockModemStream &s, const std::string &line) { model.reply(s, line); });
+
+    TinyGsm modem(serial);
+    TinyGsmClient client(modem, 0);
+
+    if (!client.connect("bench", 80))
+    {
+        printf("download: connect failed\n");
+        return false;
+    }
+    Clock::time_point start = Clock::now();
+    uint64_t startCycles = cycles();
+    size_t commands = model.commands;
+    size_t bytesIn = serial.bytesRead;
+    std::vector<uint8_t> buf(4096);
+    size_t got = 0;
+    bool match = true;
+    size_t allocs = host_alloc_count();
+    while (got < bytes)
+    {
+        int avail = client.available();
+        if (avail <= 0)
+        {
+            if (!client.connected())
+                break;
+            continue;
+        }
+        const uint8_t *data = buf.data();
+        int n = spans ? (int)client.readSpan(&data) : client.read(buf.data(), std::min((size_t)avail, buf.size()));
+        if (n > 0)
+        {
+            match = match && memcmp(data, model.payload.data() + got, n) == 0;
+            got += n;
+            if (spans)
+                client.commitRead(n);
+        }
+    }
+    double t = seconds_since(start);
+    double perByte = (double)(cycles() - startCycles) / std::max(got, (size_t)1);
+    commands = model.commands - commands;
+    allocs = host_alloc_count() - allocs;
+    printf("%-22s %10.1f MB/s  %6.1f cycles/byte  %zu AT commands  %.2f UART bytes in per payload byte  "
+           "%.2f heap allocs/AT command%s\n",
+           spans ? "GsmClient readSpan" : "GsmClient read(4096)", got / t / 1e6, perByte, commands,
+           (double)(serial.bytesRead - bytesIn) / bytes, (double)allocs / std::max(commands, (size_t)1),
+           got == bytes && match ? "" : "  (corrupt)");
+    return got == bytes && match;
+}
+
+int main(int argc, char **argv)
+{
+    size_t size = argc > 1 ? strtoul(argv[1], nullptr, 0) : 4 * 1024 * 1024;
+    printf("TinyGSM host benchmark, EC200U model, %zu byte download\n", size);
+    bool ok = bench_commands(20000);
+    ok &= bench_fifo(64 * 1024 * 1024);
+    ok &= bench_download(size, false);
+    ok &= bench_download(size, true);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// How TinyGSM puts an AT command on the serial port, on the host: the
+// previous sendAT() (kept below as legacy_send_at), which called
+// stream.print() once per argument and then flush(), against the current
+// one, which formats the line into a stack buffer, writes it once (see
+// TinyGsmLineWriter.h) and flushes it as before.
+//
+// The stream stands in for the ESP32's UART driver: every write() costs a
+// fixed time (uart_write_bytes() takes the driver's lock and copies into
+// the TX ring buffer), and flush() waits until what was written has left
+// at the baud rate, as uart_wait_tx_done() does. Both costs are spent
+// busy-waiting, so commands/s is the time the caller spends per command.
+// Both paths are checked to produce the same line; the exit status is 1
+// if they do not.
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target at_format_bench
+// Run:    ./build/tools/at_format_bench [call_ns] [baud] [commands]
+
+#define TINY_GSM_MODEM_EC200U
+#define TINY_GSM_RX_BUFFER 1024
+// The host's yield is a system call that would swamp the formatting
+#define TINY_GSM_YIELD() \
+    {                    \
+    }
+
+#include <TinyGsmClient.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+namespace
+{
+uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+void spin_until(uint64_t ns)
+{
+    while (now_ns() < ns)
+    {
+    }
+}
+
+// The UART driver: keeps the line for comparison, counts and charges calls
+class DriverStream : public Stream
+{
+public:
+    DriverStream(uint32_t call_ns, uint32_t baud)
+        : calls(0), keep(false), _callNs(call_ns), _byteNs(10000000000ULL / baud), _txDone(0)
+    {
+    }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        calls++;
+        if (keep)
+            line.append((const char *)buffer, size);
+        uint64_t now = now_ns();
+        _txDone = std::max(_txDone, now) + size * _byteNs;
+        spin_until(now + _callNs);
+        return size;
+    }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override
+    {
+        calls++;
+        spin_until(std::max(_txDone, now_ns() + _callNs));
+    }
+
+    // Lets the line go idle between commands, as the reply would
+    void drain() { spin_until(_txDone); }
+
+    size_t calls;
+    bool keep;
+    std::string line;
+
+private:
+    const uint64_t _callNs;
+    const uint64_t _byteNs;
+    uint64_t _txDone;
+};
+
+// sendAT() as it was
+template <typename T>
+void legacy_write(Stream &s, T last)
+{
+    s.print(last);
+}
+template <typename T, typename... Args>
+void legacy_write(Stream &s, T head, Args... tail)
+{
+    s.print(head);
+    legacy_write(s, tail...);
+}
+template <typename... Args>
+void legacy_send_at(Stream &s, Args... cmd)
+{
+    legacy_write(s, "AT", cmd..., AT_NL);
+    s.flush();
+    TINY_GSM_YIELD();
+}
+
+const char kHost[] = "protocol.electrocus.com";
+const char kCaCert[] = "UFS:certificates/electrocus-protocol-server-root-ca-2026.pem";
+
+uint32_t s_callNs;
+uint32_t s_baud;
+
+// The caller's time in one send, and the driver calls it made
+struct Cost
+{
+    uint64_t ns = 0;
+    size_t calls = 0;
+
+    void print(int count) const
+    {
+        printf(" %9.0f/s %5.1f", count / (ns * 1e-9), (double)calls / count);
+    }
+};
+
+template <typename Send>
+Cost measure(DriverStream &stream, int count, Send send)
+{
+    Cost cost;
+    stream.calls = 0;
+    for (int i = 0; i < count; i++)
+    {
+        stream.drain();
+        uint64_t start = now_ns();
+        send();
+        cost.ns += now_ns() - start;
+    }
+    cost.calls = stream.calls;
+    return cost;
+}
+
+// One command three ways: as it was, as sendAT() does now (one write,
+// still flushed: the driver calls saved alone), and in one write without
+// the flush, for what the flush itself costs
+template <typename... Args>
+bool bench(const char *name, int count, Args... cmd)
+{
+    DriverStream legacy(s_callNs, s_baud);
+    legacy.keep = true;
+    legacy_send_at(legacy, cmd...);
+    DriverStream current(s_callNs, s_baud);
+    TinyGsm modem(current);
+    current.keep = true;
+    modem.sendAT(cmd...);
+    bool same = legacy.line == current.line;
+    legacy.keep = current.keep = false;
+
+    printf("%-32s %4zu", name, current.line.size());
+    measure(legacy, count, [&] { legacy_send_at(legacy, cmd...); }).print(count);
+    measure(current, count, [&] { modem.sendAT(cmd...); }).print(count);
+    measure(current, count, [&] {
+        TinyGsmLineWriter<TINY_GSM_AT_BUFFER> line(current);
+        line.add("AT", cmd..., AT_NL);
+        line.send();
+    }).print(count);
+    printf("%s\n", same ? "" : "  (LINES DIFFER)");
+    return same;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    s_callNs = argc > 1 ? strtoul(argv[1], nullptr, 0) : 2000;
+    s_baud = argc > 2 ? strtoul(argv[2], nullptr, 0) : 115200;
+    int count = argc > 3 ? atoi(argv[3]) : 200;
+    if (!s_baud || count <= 0)
+    {
+        fprintf(stderr, "usage: at_format_bench [call_ns] [baud] [commands]\n");
+        return 2;
+    }
+    printf("UART driver: %u ns per call, flush() drains at %u baud; commands/s and driver calls per command\n",
+           s_callNs, s_baud);
+    printf("%-32s %4s %21s %21s %21s\n", "", "len", "print+flush", "sendAT (write+flush)", "write, no flush");
+    uint8_t mux = 0;
+    uint16_t port = 7000;
+    bool ok = bench("AT+CSQ", count, GF("+CSQ"));
+    ok &= bench("AT+QIRD=<mux>,<len>", count, GF("+QIRD="), mux, ',', (uint16_t)1500);
+    ok &= bench("AT+QIOPEN=1,<mux>,\"TCP\",...", count, GF("+QIOPEN=1,"), mux, GF(",\""), GF("TCP"), GF("\",\""), kHost,
+          GF("\","), port, GF(",0,"), 0);
+    ok &= bench("AT+QSSLCFG=\"cacert\",... (long)", count, GF("+QSSLCFG=\"cacert\",0,\""), kCaCert, kCaCert,
+                GF("\""));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,242 @@
+// The status poll an application runs now and then (+CSQ, +CEREG? and
+// +QENG="servingcell"), three ways on the host: through TinyGSM's blocking
+// calls, through TinyGsmAtQueue one command per line, and through the
+// queue with the three queries concatenated on one line.
+//
+// The modem end answers each command line a fixed latency after it was
+// sent, one line at a time, plus a little per command on the line. The
+// application loop around the queue does nothing but poll(). Reported:
+// status polls per second, command lines sent per poll, and how long the
+// application was blocked in a single call, on average and at worst (the
+// worst includes the host scheduler's hiccups). The exit status is 1 if
+// any poll got a wrong reply.
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target at_queue_bench
+// Run:    ./build/tools/at_queue_bench [latency_ms] [polls]
+
+#define TINY_GSM_MODEM_EC200U
+#define TINY_GSM_RX_BUFFER 1024
+
+#include <TinyGsmClient.h>
+#include <TinyGsmAtQueue.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+namespace
+{
+const std::chrono::microseconds kPerCommand(300); // each extra command on a line
+
+double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Serial link to a modem that runs one command line at a time. Replies are
+// released once due; a line sent while one is in progress waits its turn.
+class ModemLine : public Stream
+{
+public:
+    explicit ModemLine(uint32_t latency_ms) : lines(0), _latency(latency_ms * 1000), _busyUntil(Clock::now()) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            if (buffer[i] == '\r')
+            {
+                run(_line);
+                _line.clear();
+            }
+            else if (buffer[i] != '\n')
+            {
+                _line += (char)buffer[i];
+            }
+        }
+        return size;
+    }
+    using Print::write;
+
+    int available() override
+    {
+        release();
+        return (int)_rx.size();
+    }
+    int read() override
+    {
+        release();
+        if (_rx.empty())
+            return -1;
+        uint8_t c = _rx.front();
+        _rx.pop_front();
+        return c;
+    }
+    int peek() override
+    {
+        release();
+        return _rx.empty() ? -1 : (uint8_t)_rx.front();
+    }
+    void flush() override {}
+
+    size_t lines;
+
+private:
+    struct Reply
+    {
+        Clock::time_point due;
+        std::string text;
+    };
+
+    void release()
+    {
+        Clock::time_point now = Clock::now();
+        while (!_pending.empty() && _pending.front().due <= now)
+        {
+            _rx.insert(_rx.end(), _pending.front().text.begin(), _pending.front().text.end());
+            _pending.pop_front();
+        }
+    }
+
+    // "AT" then commands separated by ';' (V.250 concatenation)
+    void run(const std::string &line)
+    {
+        lines++;
+        Clock::time_point start = std::max(Clock::now(), _busyUntil);
+        Clock::time_point due = start + _latency;
+        std::string reply;
+        size_t pos = 2;
+        while (pos <= line.size())
+        {
+            size_t end = line.find(';', pos);
+            if (end == std::string::npos)
+                end = line.size();
+            std::string cmd = line.substr(pos, end - pos);
+            if (cmd == "+CSQ")
+                reply += "\r\n+CSQ: 23,99\r\n";
+            else if (cmd == "+CEREG?")
+                reply += "\r\n+CEREG: 0,1\r\n";
+            else if (cmd == "+QENG=\"servingcell\"")
+                reply += "\r\n+QENG: \"servingcell\",\"NOCONN\",\"LTE\",\"FDD\",404,10,1A2B3C4,210,1850,3,5,5,"
+                         "2F1,-95,-12,-62,12,27\r\n";
+            if (pos > 2)
+                due += kPerCommand;
+            pos = end + 1;
+        }
+        reply += "\r\nOK\r\n";
+        _pending.push_back(Reply{due, reply});
+        _busyUntil = due;
+    }
+
+    const std::chrono::microseconds _latency;
+    Clock::time_point _busyUntil;
+    std::string _line;
+    std::deque<Reply> _pending;
+    std::deque<char> _rx;
+};
+
+struct Result
+{
+    double seconds;
+    double call_total;
+    size_t calls;
+    double longest_call;
+    size_t lines;
+    int good;
+
+    void note(double call)
+    {
+        call_total += call;
+        calls++;
+        longest_call = std::max(longest_call, call);
+    }
+};
+
+Result blocking(uint32_t latency_ms, int polls)
+{
+    ModemLine line(latency_ms);
+    TinyGsm modem(line);
+    Result r = {0, 0, 0, 0, 0, 0};
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < polls; i++)
+    {
+        Clock::time_point call = Clock::now();
+        bool good = modem.getSignalQuality() == 23;
+        r.note(seconds_since(call));
+        call = Clock::now();
+        good = good && modem.getRegistrationStatus() == REG_OK_HOME;
+        r.note(seconds_since(call));
+        call = Clock::now();
+        modem.sendAT(GF("+QENG=\"servingcell\""));
+        good = good && modem.waitResponse(GF("+QENG:")) == 1;
+        modem.waitResponse();
+        r.note(seconds_since(call));
+        r.good += good;
+    }
+    r.seconds = seconds_since(start);
+    r.lines = line.lines;
+    return r;
+}
+
+Result queued(uint32_t latency_ms, int polls, bool batch)
+{
+    ModemLine line(latency_ms);
+    TinyGsm modem(line);
+    TinyGsmAtQueue<TinyGsm> queue(modem, batch);
+    Result r = {0, 0, 0, 0, 0, 0};
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < polls; i++)
+    {
+        TinyGsmAtCommand csq("+CSQ", "+CSQ:", 300, true);
+        TinyGsmAtCommand cereg("+CEREG?", "+CEREG:", 300, true);
+        TinyGsmAtCommand qeng("+QENG=\"servingcell\"", "+QENG:", 300, true);
+        queue.submit(csq);
+        queue.submit(cereg);
+        queue.submit(qeng);
+        // The application loop
+        while (!queue.idle())
+        {
+            Clock::time_point call = Clock::now();
+            queue.poll();
+            r.note(seconds_since(call));
+        }
+        r.good += csq.ok() && cereg.ok() && qeng.ok() && strcmp(csq.response(), "+CSQ: 23,99") == 0 &&
+                  strcmp(cereg.response(), "+CEREG: 0,1") == 0 && strncmp(qeng.response(), "+QENG:", 6) == 0;
+    }
+    r.seconds = seconds_since(start);
+    r.lines = line.lines;
+    return r;
+}
+
+// False if a poll got a wrong or missing reply
+bool print(const char *name, const Result &r, int polls)
+{
+    printf("%-16s %7.1f polls/s  %4.2f lines/poll  call mean %9.1f us  longest %9.1f us%s\n", name,
+           polls / r.seconds, (double)r.lines / polls, r.calls ? r.call_total * 1e6 / r.calls : 0.0,
+           r.longest_call * 1e6, r.good == polls ? "" : "  (bad replies)");
+    return r.good == polls;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint32_t latency_ms = argc > 1 ? strtoul(argv[1], nullptr, 0) : 20;
+    int polls = argc > 2 ? atoi(argv[2]) : 20;
+    if (polls <= 0)
+    {
+        fprintf(stderr, "usage: at_queue_bench [latency_ms] [polls]\n");
+        return 2;
+    }
+    printf("+CSQ, +CEREG?, +QENG=\"servingcell\" per poll, modem latency %u ms per line\n", latency_ms);
+    bool ok = print("blocking", blocking(latency_ms, polls), polls);
+    ok &= print("queue", queued(latency_ms, polls, false), polls);
+    ok &= print("queue, batched", queued(latency_ms, polls, true), polls);
+    return ok ? 0 : 1;
+}
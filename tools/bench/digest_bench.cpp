@@ -0,0 +1,81 @@
+// Throughput of the software digest paths in include/ota_digest.h: the
+// portable SHA-256 (what OTA_DIGEST_SOFTWARE builds use, and roughly what
+// mbedtls does while the hardware engine is busy) and the table CRC32.
+// Chunk sizes follow the OTA code: 512 B modem reads, 4 KB pipeline
+// buffers and flash sectors. Every chunk size has to give the same
+// digest and CRC, or the exit status is 1.
+//
+// Build:  g++ -O2 -std=c++11 -I include tools/bench/digest_bench.cpp -o digest_bench
+// Run:    ./digest_bench [image_bytes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "ota_digest.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    size_t size = argc > 1 ? strtoul(argv[1], nullptr, 0) : 1536 * 1024;
+    std::vector<uint8_t> image(size);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+
+    const size_t kChunks[] = {512, 4096};
+    const int kRounds = 5;
+    printf("image %zu bytes, best of %d rounds\n", size, kRounds);
+    printf("%-8s %6s %10s %12s\n", "digest", "chunk", "MB/s", "ms/image");
+
+    uint8_t first_digest[kOtaSha256Size];
+    uint32_t first_crc = 0;
+    bool same = true;
+    for (size_t chunk : kChunks)
+    {
+        double best_sha = 1e9, best_crc = 1e9;
+        uint8_t digest[kOtaSha256Size];
+        uint32_t crc = 0;
+        for (int round = 0; round < kRounds; round++)
+        {
+            Clock::time_point start = Clock::now();
+            OtaSha256 sha;
+            sha.begin();
+            for (size_t pos = 0; pos < size; pos += chunk)
+                sha.update(image.data() + pos, std::min(chunk, size - pos));
+            sha.finish(digest);
+            best_sha = std::min(best_sha, seconds_since(start));
+
+            start = Clock::now();
+            crc = 0;
+            for (size_t pos = 0; pos < size; pos += chunk)
+                crc = ota_crc32(crc, image.data() + pos, std::min(chunk, size - pos));
+            best_crc = std::min(best_crc, seconds_since(start));
+        }
+        printf("%-8s %6zu %10.1f %12.2f\n", "sha256", chunk, size / best_sha / 1e6, best_sha * 1e3);
+        printf("%-8s %6zu %10.1f %12.2f\n", "crc32", chunk, size / best_crc / 1e6, best_crc * 1e3);
+        if (chunk == kChunks[0])
+        {
+            memcpy(first_digest, digest, sizeof(digest));
+            first_crc = crc;
+        }
+        else if (memcmp(first_digest, digest, sizeof(digest)) != 0 || crc != first_crc)
+        {
+            printf("(%zu B chunks disagree with %zu B chunks)\n", chunk, kChunks[0]);
+            same = false;
+        }
+    }
+    return same ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+// Fill/drain rate of TinyGSM's socket RX FIFO on the host: the previous
+// modulo-indexed TinyGsmFifo (kept below as LegacyFifo), the current one
+// with a power-of-two and a non-power-of-two size, and TinyGsmSpscFifo
+// both on one thread and filled by a second thread while the first drains.
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target fifo_bench
+// Run:    ./build/tools/fifo_bench [megabytes]
+//
+// Exits 1 if a FIFO handed back bytes out of order.
+
+#include <TinyGsmFifo.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+// Keeps benchmark results alive
+static volatile size_t s_sink;
+
+static double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// TinyGsmFifo as it was: `(i + n) % N` on every index step
+template <class T, unsigned N>
+class LegacyFifo
+{
+public:
+    LegacyFifo() : _w(0), _r(0) {}
+
+    int free()
+    {
+        int s = _r - _w;
+        if (s <= 0)
+            s += N;
+        return s - 1;
+    }
+    bool put(const T &c)
+    {
+        int i = _w;
+        int j = i;
+        i = _inc(i);
+        if (i == _r)
+            return false;
+        _b[j] = c;
+        _w = i;
+        return true;
+    }
+    int put(const T *p, int n)
+    {
+        int c = n;
+        while (c)
+        {
+            int f = free();
+            if (!f)
+                break;
+            if (c < f)
+                f = c;
+            int w = _w;
+            int m = N - w;
+            if (f > m)
+                f = m;
+            memcpy(&_b[w], p, f);
+            _w = _inc(w, f);
+            c -= f;
+            p += f;
+        }
+        return n - c;
+    }
+    size_t size()
+    {
+        int s = _w - _r;
+        if (s < 0)
+            s += N;
+        return s;
+    }
+    bool get(T *p)
+    {
+        int r = _r;
+        if (r == _w)
+            return false;
+        *p = _b[r];
+        _r = _inc(r);
+        return true;
+    }
+    int get(T *p, int n)
+    {
+        int c = n;
+        while (c)
+        {
+            int f = size();
+            if (!f)
+                break;
+            if (c < f)
+                f = c;
+            int r = _r;
+            int m = N - r;
+            if (f > m)
+                f = m;
+            memcpy(p, &_b[r], f);
+            _r = _inc(r, f);
+            c -= f;
+            p += f;
+        }
+        return n - c;
+    }
+
+private:
+    int _inc(int i, int n = 1) { return (i + n) % N; }
+
+    T _b[N];
+    int _w;
+    int _r;
+};
+
+// The way GsmClient uses the FIFO: moveCharFromStreamToFifo() puts one
+// byte at a time, read() drains in blocks. Every block should come out as
+// 0, 1, 2, ... as it went in.
+template <class Fifo>
+static bool bench(const char *name, size_t bytes)
+{
+    static Fifo fifo;
+    uint8_t chunk[512];
+    size_t sum = 0;
+    bool ordered = true;
+
+    Clock::time_point start = Clock::now();
+    for (size_t moved = 0; moved < bytes; moved += sizeof(chunk))
+    {
+        for (size_t i = 0; i < sizeof(chunk); i++)
+            fifo.put((uint8_t)i);
+        fifo.get(chunk, sizeof(chunk));
+        sum += chunk[7];
+    }
+    double t_byte = seconds_since(start);
+    for (size_t i = 0; i < sizeof(chunk); i++)
+        ordered = ordered && chunk[i] == (uint8_t)i;
+
+    start = Clock::now();
+    for (size_t moved = 0; moved < bytes; moved += sizeof(chunk))
+    {
+        fifo.put(chunk, sizeof(chunk));
+        fifo.get(chunk, sizeof(chunk));
+        sum += chunk[7];
+    }
+    double t_bulk = seconds_since(start);
+    for (size_t i = 0; i < sizeof(chunk); i++)
+        ordered = ordered && chunk[i] == (uint8_t)i;
+
+    printf("%-26s %9.1f MB/s put(c)  %9.1f MB/s put(n)%s\n", name, bytes / t_byte / 1e6, bytes / t_bulk / 1e6,
+           ordered ? "" : "  (corrupt)");
+    s_sink = sum;
+    return ordered;
+}
+
+// A producer thread fills byte by byte (the UART reader) while this
+// thread drains in blocks (the client); checks the byte sequence too
+static bool bench_threads(size_t bytes)
+{
+    static TinyGsmSpscFifo<uint8_t, 1024> fifo;
+    Clock::time_point start = Clock::now();
+    std::thread producer([&]() {
+        for (size_t i = 0; i < bytes; i++)
+            while (!fifo.put((uint8_t)(i * 7)))
+                std::this_thread::yield();
+    });
+
+    uint8_t chunk[512];
+    size_t got = 0;
+    bool ordered = true;
+    while (got < bytes)
+    {
+        int n = fifo.get(chunk, sizeof(chunk));
+        if (!n)
+            std::this_thread::yield();
+        for (int i = 0; i < n; i++)
+            ordered = ordered && chunk[i] == (uint8_t)((got + i) * 7);
+        got += n;
+    }
+    producer.join();
+    double t = seconds_since(start);
+    printf("%-26s %9.1f MB/s put(c) on a second thread%s\n", "spsc 1024, 2 threads", bytes / t / 1e6,
+           ordered ? "" : "  (corrupt)");
+    return ordered;
+}
+
+int main(int argc, char **argv)
+{
+    size_t bytes = (argc > 1 ? strtoul(argv[1], nullptr, 0) : 64) * 1024 * 1024;
+    printf("TinyGsmFifo host benchmark, %zu MB through each FIFO\n", bytes >> 20);
+    bool ok = bench<LegacyFifo<uint8_t, 1000> >("legacy modulo, 1000", bytes);
+    ok &= bench<LegacyFifo<uint8_t, 1024> >("legacy modulo, 1024", bytes);
+    ok &= bench<TinyGsmFifo<uint8_t, 1000> >("fifo 1000 (subtract)", bytes);
+    ok &= bench<TinyGsmFifo<uint8_t, 1024> >("fifo 1024 (mask)", bytes);
+    ok &= bench<TinyGsmSpscFifo<uint8_t, 1024> >("spsc 1024, 1 thread", bytes);
+    ok &= bench_threads(bytes / 4);
+    return ok ? 0 : 1;
+}
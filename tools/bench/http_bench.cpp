@@ -0,0 +1,151 @@
+// CPU cost of ArduinoHttpClient's parsing on the host with the Arduino shim
+// (tools/host): status line and header parsing the way ota_http_get()
+// walks them, body reads in pipeline-sized chunks, and WebSocket frame
+// parsing. Responses come from an in-memory Client.
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target http_bench
+// Run:    ./build/tools/http_bench
+//
+// Exits 1 if a response or frame was misparsed.
+
+#include <ArduinoHttpClient.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "mock_stream.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static std::string http_response(size_t body)
+{
+    std::string r = "HTTP/1.1 200 OK\r\n"
+                    "Server: nginx/1.24.0\r\n"
+                    "Date: Sat, 17 Oct 2026 10:00:00 GMT\r\n"
+                    "Content-Type: application/octet-stream\r\n"
+                    "Content-Length: " + std::to_string(body) + "\r\n"
+                    "Last-Modified: Fri, 16 Oct 2026 08:00:00 GMT\r\n"
+                    "Connection: keep-alive\r\n"
+                    "ETag: \"6710a7c0-180000\"\r\n"
+                    "Accept-Ranges: bytes\r\n"
+                    "X-Firmware-SHA256: 9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08\r\n"
+                    "\r\n";
+    r.append(body, 'x');
+    return r;
+}
+
+// One GET: request, status, every header by name/value, then the body
+static size_t fetch(HttpClient &http, MockClient &client, const std::string &response, uint8_t *buf, size_t bufSize)
+{
+    client.setResponse(response);
+    http.beginRequest();
+    http.get("/firmware.bin");
+    http.endRequest();
+    if (http.responseStatusCode() != 200)
+        return 0;
+    size_t headers = 0;
+    while (http.headerAvailable())
+    {
+        headers += http.readHeaderName().length();
+        headers += http.readHeaderValue().length();
+    }
+    size_t body = 0;
+    while (!http.endOfBodyReached())
+    {
+        int n = http.read(buf, bufSize);
+        if (n <= 0)
+            break;
+        body += n;
+    }
+    http.stop();
+    return headers ? body : 0;
+}
+
+static bool bench_headers(int count)
+{
+    MockClient client;
+    HttpClient http(client, "bench", 80);
+    std::string response = http_response(16);
+    uint8_t buf[4096];
+
+    Clock::time_point start = Clock::now();
+    int ok = 0;
+    for (int i = 0; i < count; i++)
+        ok += fetch(http, client, response, buf, sizeof(buf)) == 16;
+    double t = seconds_since(start);
+    printf("%-22s %10.0f responses/s  %6.2f us/response%s\n", "status + 9 headers",
+           count / t, t * 1e6 / count, ok == count ? "" : "  (parse errors)");
+    return ok == count;
+}
+
+static bool bench_body(size_t bytes)
+{
+    MockClient client;
+    HttpClient http(client, "bench", 80);
+    std::string response = http_response(bytes);
+    std::vector<uint8_t> buf(4096);
+
+    Clock::time_point start = Clock::now();
+    size_t got = fetch(http, client, response, buf.data(), buf.size());
+    double t = seconds_since(start);
+    printf("%-22s %10.1f MB/s%s\n", "body read(4096)", got / t / 1e6, got == bytes ? "" : "  (short)");
+    return got == bytes;
+}
+
+static bool bench_websocket(int frames)
+{
+    // Server frames are unmasked: FIN + text opcode, 7-bit length
+    std::string payload(100, 'w');
+    std::string stream = "HTTP/1.1 101 Switching Protocols\r\n"
+                         "Upgrade: websocket\r\n"
+                         "Connection: Upgrade\r\n"
+                         "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+                         "\r\n";
+    for (int i = 0; i < frames; i++)
+    {
+        stream += (char)0x81;
+        stream += (char)payload.size();
+        stream += payload;
+    }
+
+    MockClient client;
+    WebSocketClient ws(client, "bench", 80);
+    client.setResponse(stream);
+    if (ws.begin("/") != 0)
+    {
+        printf("websocket: handshake failed\n");
+        return false;
+    }
+    uint8_t buf[128];
+
+    Clock::time_point start = Clock::now();
+    int parsed = 0;
+    while (ws.parseMessage() > 0)
+    {
+        // read() is not bounded by the frame, so ask for exactly its size
+        if (ws.read(buf, std::min((size_t)ws.available(), sizeof(buf))) == (int)payload.size())
+            parsed++;
+    }
+    double t = seconds_since(start);
+    printf("%-22s %10.0f frames/s  %6.2f us/frame%s\n", "websocket 100 B frames",
+           parsed / t, t * 1e6 / std::max(parsed, 1), parsed == frames ? "" : "  (parse errors)");
+    return parsed == frames;
+}
+
+int main()
+{
+    printf("ArduinoHttpClient host benchmark\n");
+    bool ok = bench_headers(20000);
+    ok &= bench_body(16 * 1024 * 1024);
+    ok &= bench_websocket(100000);
+    return ok ? 0 : 1;
+}
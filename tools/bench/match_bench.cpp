@@ -0,0 +1,156 @@
+// Response scanning in TinyGSM's waitResponseImpl() on the host: the
+// previous loop (kept below as legacy_scan), which ran String::endsWith()
+// for each expected response and for the EC200U's URC triggers after every
+// byte, against the current one, which advances a TinyGsmMatcher and only
+// asks handleURCs() after a byte a URC trigger can end with.
+//
+// Both keep appending to the response String as waitResponseImpl() does;
+// the difference is the matching alone. The exit status is 1 if the two
+// disagree or a reply goes unmatched.
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target match_bench
+// Run:    ./build/tools/match_bench [megabytes]
+
+#include <Arduino.h>
+#include <TinyGsmMatcher.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+// Keeps benchmark results alive
+static volatile size_t s_sink;
+
+static double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static const char kOk[] = "OK\r\n";
+static const char kError[] = "ERROR\r\n";
+static const char kUrc[] = "\r\n+QIURC:";
+static const char kSslUrc[] = "\r\n+QSSLURC:";
+
+// Expected responses for one call; unused ones are null
+struct Responses
+{
+    const char *r[7];
+};
+
+// The loop as it was: every expected response and both URC triggers
+// compared against the end of the String after each byte
+static int legacy_scan(const std::string &input, size_t &pos, const Responses &rs)
+{
+    String data;
+    data.reserve(64);
+    while (pos < input.size())
+    {
+        char a = input[pos++];
+        data += a;
+        for (int i = 0; i < 7; i++)
+        {
+            if (rs.r[i] && data.endsWith(rs.r[i]))
+                return i + 1;
+        }
+        if (data.endsWith(kUrc) || data.endsWith(kSslUrc))
+            data = "";
+    }
+    return 0;
+}
+
+static int matcher_scan(const std::string &input, size_t &pos, const Responses &rs)
+{
+    String data;
+    data.reserve(64);
+    TinyGsmMatcher<7> matcher;
+    for (int i = 0; i < 7; i++)
+        matcher.add(rs.r[i]);
+    while (pos < input.size())
+    {
+        char a = input[pos++];
+        data += a;
+        uint8_t hit = matcher.feed(a);
+        if (hit)
+            return hit;
+        if (a == ':' && (data.endsWith(kUrc) || data.endsWith(kSslUrc)))
+        {
+            data = "";
+            matcher.reset();
+        }
+    }
+    return 0;
+}
+
+typedef int (*Scan)(const std::string &, size_t &, const Responses &);
+
+// Scans `reply` (one complete response) until `bytes` have gone through.
+// Every reply has to end in a match, and in the same slot both ways.
+static bool bench(const char *name, const std::string &reply, const Responses &rs, size_t bytes)
+{
+    std::string input;
+    while (input.size() < 1 << 20)
+        input += reply;
+    size_t replies = input.size() / reply.size();
+
+    const Scan scans[] = {legacy_scan, matcher_scan};
+    const char *labels[] = {"endsWith", "matcher"};
+    double rate[2];
+    size_t slots[2];
+    bool ok = true;
+    for (int s = 0; s < 2; s++)
+    {
+        size_t done = 0;
+        size_t found = 0;
+        size_t missed = 0;
+        size_t passes = 0;
+        Clock::time_point start = Clock::now();
+        while (done < bytes)
+        {
+            size_t pos = 0;
+            for (size_t i = 0; i < replies; i++)
+            {
+                int hit = scans[s](input, pos, rs);
+                found += hit;
+                missed += !hit;
+            }
+            done += pos;
+            passes++;
+        }
+        rate[s] = done / seconds_since(start);
+        s_sink = found;
+        slots[s] = found / passes;
+        ok = ok && !missed;
+        printf("%-34s %-9s %8.1f MB/s%s\n", name, labels[s], rate[s] / 1e6, missed ? "  (missed replies)" : "");
+    }
+    ok = ok && slots[0] == slots[1];
+    printf("%-34s %-9s %8.2fx%s\n", "", "speedup", rate[1] / rate[0],
+           slots[0] == slots[1] ? "" : "  (RESULTS DIFFER)");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    size_t bytes = (argc > 1 ? strtoul(argv[1], nullptr, 0) : 64) << 20;
+
+    // OK / ERROR, a short reply
+    Responses defaults = {{kOk, kError, nullptr, nullptr, nullptr, nullptr, nullptr}};
+    bool ok = bench("AT+CSQ (OK/ERROR)", "\r\n+CSQ: 23,99\r\n\r\nOK\r\n", defaults, bytes);
+
+    // A long multi-line reply against all seven slots
+    Responses seven = {{kOk, kError, "+CME ERROR:", "+QIOPEN:", "SEND OK\r\n", "SEND FAIL\r\n", "> "}};
+    std::string cells;
+    for (int i = 0; i < 40; i++)
+        cells += "\r\n+QENG: \"neighbourcell intra\",\"LTE\",1850,310,-12,-95,-62,0,27,8,74,-,-\r\n";
+    ok &= bench("+QENG, 40 lines (7 responses)", cells + "\r\nOK\r\n", seven, bytes);
+
+    // Socket URCs arriving while a command waits
+    std::string urcs;
+    for (int i = 0; i < 20; i++)
+        urcs += "\r\n+QIURC: \"recv\",0\r\n";
+    ok &= bench("20 +QIURC then OK (OK/ERROR)", urcs + "\r\nOK\r\n", defaults, bytes);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+// How TinyGSM waits for the modem, on the host: with the default
+// TINY_GSM_WAIT_RX, which yields and polls stream.available(), and with an
+// event-driven one as ota_uart.h sets up on the ESP32, where the waiting
+// task sleeps until HardwareSerial's receive callback reports that the
+// line went idle (the RX timeout after a burst) or the FIFO filled.
+//
+// The modem end runs on its own thread. It answers each command after a
+// fixed latency and releases the reply at the baud rate, raising the
+// driver's events itself. For each mode the bench reports AT round trips
+// per second, the latency from the reply's last byte arriving to
+// waitResponse() returning (with events, the RX timeout is part of it),
+// and the CPU time the AT caller burned, both while round trips run and
+// while it waits on a silent line.
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target uart_wait_bench
+// Run:    ./build/tools/uart_wait_bench [baud] [round_trips]
+
+#define TINY_GSM_MODEM_EC200U
+#define TINY_GSM_RX_BUFFER 1024
+
+#include <stdint.h>
+
+static bool bench_wait_rx(uint32_t ms);
+#define TINY_GSM_WAIT_RX(ms) bench_wait_rx(ms)
+
+#include <TinyGsmClient.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+namespace
+{
+const size_t kUartFifo = 64;                                // OTA_UART_RX_FIFO_FULL
+const uint32_t kRxTimeout = 2;                              // OTA_UART_RX_TIMEOUT, in symbols
+const std::chrono::microseconds kModemLatency(2000);        // command to first reply byte
+const char kReply[] = "\r\n+CSQ: 23,99\r\n\r\nOK\r\n";
+
+uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+double thread_cpu_seconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The UART between the AT caller and the modem thread
+class UartLink : public Stream
+{
+public:
+    explicit UartLink(uint32_t baud) : events(false), _byte(10000000000ULL / baud), _pos(0), _stop(false), _event(false)
+    {
+        _modem = std::thread(&UartLink::modem, this);
+    }
+    ~UartLink()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _commandReady.notify_all();
+        _modem.join();
+    }
+
+    // Event mode: what ota_uart_wait() does with its task notification
+    bool waitRx(uint32_t ms)
+    {
+        if (!events)
+        {
+            delay(0);
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        _rxEvent.wait_for(lock, std::chrono::milliseconds(ms),
+                          [this] { return _event || _pos < _rx.size(); });
+        _event = false;
+        return _pos < _rx.size();
+    }
+
+    uint64_t replyEndNs() const { return _replyEnd.load(); }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t i = 0; i < size; i++)
+        {
+            if (buffer[i] == '\r')
+            {
+                _commands.push_back(_line);
+                _line.clear();
+                _commandReady.notify_one();
+            }
+            else if (buffer[i] != '\n')
+            {
+                _line += (char)buffer[i];
+            }
+        }
+        return size;
+    }
+    using Print::write;
+
+    int available() override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return (int)(_rx.size() - _pos);
+    }
+    int read() override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _pos < _rx.size() ? (uint8_t)_rx[_pos++] : -1;
+    }
+    int peek() override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _pos < _rx.size() ? (uint8_t)_rx[_pos] : -1;
+    }
+    void flush() override {}
+
+    bool events;
+
+private:
+    // Answers every command with kReply, one byte per byte time
+    void modem()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;)
+        {
+            _commandReady.wait(lock, [this] { return _stop || !_commands.empty(); });
+            if (_stop)
+                return;
+            _commands.pop_front();
+            Clock::time_point start = Clock::now() + kModemLatency;
+            size_t len = sizeof(kReply) - 1;
+            size_t sent = 0;
+            while (sent < len)
+            {
+                lock.unlock();
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds(sent * _byte));
+                lock.lock();
+                size_t due = std::min(len, (size_t)((Clock::now() - start).count() / _byte) + 1);
+                bool event = false;
+                for (; sent < due; sent++)
+                {
+                    _rx += kReply[sent];
+                    event = event || (sent + 1) % kUartFifo == 0;
+                }
+                if (sent == len)
+                {
+                    // The end of the burst is only known once the line has
+                    // stayed idle for the RX timeout
+                    _replyEnd = now_ns();
+                    lock.unlock();
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(kRxTimeout * _byte));
+                    lock.lock();
+                    event = true;
+                }
+                if (event)
+                {
+                    _event = true;
+                    _rxEvent.notify_one();
+                }
+            }
+        }
+    }
+
+    const uint64_t _byte;
+    std::mutex _mutex;
+    std::condition_variable _commandReady;
+    std::condition_variable _rxEvent;
+    std::string _rx;
+    size_t _pos;
+    std::string _line;
+    std::deque<std::string> _commands;
+    bool _stop;
+    bool _event;
+    std::atomic<uint64_t> _replyEnd{0};
+    std::thread _modem;
+};
+
+UartLink *s_link = nullptr;
+
+// False if a round trip did not end in OK
+bool bench(uint32_t baud, int count, bool events)
+{
+    UartLink link(baud);
+    link.events = events;
+    s_link = &link;
+    TinyGsm modem(link);
+
+    std::vector<double> latency;
+    latency.reserve(count);
+    int ok = 0;
+    double cpuStart = thread_cpu_seconds();
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        modem.sendAT(GF("+CSQ"));
+        ok += modem.waitResponse(1000L) == 1;
+        latency.push_back((now_ns() - link.replyEndNs()) / 1000.0);
+    }
+    double wall = std::chrono::duration<double>(Clock::now() - start).count();
+    double cpu = thread_cpu_seconds() - cpuStart;
+
+    // A maintain()-style wait with nothing arriving
+    const uint32_t kIdleMs = 1000;
+    double idleStart = thread_cpu_seconds();
+    modem.waitResponse(kIdleMs);
+    double idleCpu = thread_cpu_seconds() - idleStart;
+
+    std::sort(latency.begin(), latency.end());
+    double mean = 0;
+    for (size_t i = 0; i < latency.size(); i++)
+        mean += latency[i];
+    mean /= std::max(latency.size(), (size_t)1);
+    printf("%-7s %8.0f commands/s  latency mean %6.1f us p99 %6.1f us  caller CPU %5.1f%%  idle CPU %5.1f%%%s\n",
+           events ? "events" : "yield", count / wall, mean, latency[latency.size() * 99 / 100], 100.0 * cpu / wall,
+           100.0 * idleCpu / (kIdleMs / 1000.0), ok == count ? "" : "  (bad replies)");
+    s_link = nullptr;
+    return ok == count;
+}
+} // namespace
+
+static bool bench_wait_rx(uint32_t ms)
+{
+    return s_link ? s_link->waitRx(ms) : false;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t baud = argc > 1 ? strtoul(argv[1], nullptr, 0) : 115200;
+    int count = argc > 2 ? atoi(argv[2]) : 200;
+    if (!baud || count <= 0)
+    {
+        fprintf(stderr, "usage: uart_wait_bench [baud] [round_trips]\n");
+        return 2;
+    }
+    printf("%u baud, %d AT+CSQ round trips, modem latency %lld us\n", baud, count,
+           (long long)kModemLatency.count());
+    bool ok = bench(baud, count, false);
+    ok &= bench(baud, count, true);
+    return ok ? 0 : 1;
+}
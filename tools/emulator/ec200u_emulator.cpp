@@ -0,0 +1,1071 @@
+#include "ec200u_emulator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <fstream>
+
+namespace
+{
+const uint64_t kNsPerMs = 1000000ULL;
+const size_t kMaxRead = 1500;          // +QIRD/+QSSLRECV return at most this much
+const size_t kUartTxFifo = 128;        // host writes block past this backlog
+const uint64_t kSocketPollNs = 200000; // socket reads while output is still queued
+const uint64_t kRebootNs = 200 * kNsPerMs;
+const uint64_t kEscapeGuardNs = 1000 * kNsPerMs; // silence around "+++"
+const uint32_t kConnectTimeoutMs = 5000;
+const double kLinkErrorRate = 1.0 / 200; // bytes corrupted above linkmax
+const char kLocalIp[] = "10.0.0.2";
+
+std::string trim(const std::string &s)
+{
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos)
+        return std::string();
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+bool starts_with(const char *s, const char *prefix)
+{
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+// A blocking TCP connection to host:port, or the modem's error code: 565
+// DNS parse failed, 566 socket connect failed
+int tcp_connect(const std::string &host, uint16_t port, int *fd_out)
+{
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0)
+        return 565;
+
+    int fd = -1;
+    for (addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc < 0 && errno == EINPROGRESS)
+        {
+            pollfd p = {fd, POLLOUT, 0};
+            int soerr = 0;
+            socklen_t l = sizeof(soerr);
+            rc = poll(&p, 1, kConnectTimeoutMs) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &soerr, &l) == 0 &&
+                         soerr == 0
+                     ? 0
+                     : -1;
+        }
+        if (rc < 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0)
+        return 566;
+
+    // Sends go out whole and blocking, as the modem holds them until acked
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    *fd_out = fd;
+    return 0;
+}
+
+// The parts of an "http://host[:port]/path" URL
+bool parse_http_url(const std::string &url, std::string &host, uint16_t &port, std::string &path)
+{
+    if (url.compare(0, 7, "http://") != 0)
+        return false;
+    std::string rest = url.substr(7);
+    size_t slash = rest.find('/');
+    path = slash == std::string::npos ? "/" : rest.substr(slash);
+    rest = rest.substr(0, slash);
+    size_t colon = rest.rfind(':');
+    port = colon == std::string::npos ? 80 : (uint16_t)atoi(rest.c_str() + colon + 1);
+    host = rest.substr(0, colon);
+    return !host.empty() && port;
+}
+} // namespace
+
+Ec200uEmulator::Ec200uEmulator()
+    : _random(_config.seed), _startNs(nowNs()), _outReady(0), _outPos(0), _txEndNs(0), _lastPollNs(0),
+      _inClockNs(0), _skipLf(false), _rawLeft(0), _rawSocket(0), _rawUrl(false), _dataSocket(-1), _lastDataNs(0),
+      _escapeNs(0), _hostBaud(0), _nextBaud(0), _nextBaudNs(0), _echo(_config.echo), _pdpActive(false),
+      _nextHandle(1)
+{
+}
+
+Ec200uEmulator::~Ec200uEmulator()
+{
+    for (uint8_t id = 0; id < kSockets; id++)
+        close(id);
+}
+
+bool Ec200uEmulator::configure(const std::string &directive)
+{
+    std::string d = trim(directive);
+    size_t sep = d.find_first_of(" \t=");
+    std::string key = d.substr(0, sep);
+    std::string value = sep == std::string::npos ? std::string() : trim(d.substr(sep + 1));
+    const char *v = value.c_str();
+
+    if (key == "baud")
+        _config.baud = strtoul(v, nullptr, 0);
+    else if (key == "linkmax")
+        _config.link_max = strtoul(v, nullptr, 0);
+    else if (key == "latency")
+        _config.latency_ms = strtoul(v, nullptr, 0);
+    else if (key == "bandwidth")
+        _config.bandwidth = strtoul(v, nullptr, 0);
+    else if (key == "loss")
+        _config.loss = atof(v);
+    else if (key == "urcloss")
+        _config.urc_loss = atof(v);
+    else if (key == "rto")
+        _config.rto_ms = strtoul(v, nullptr, 0);
+    else if (key == "segment" && strtoul(v, nullptr, 0) > 0)
+        _config.segment = strtoul(v, nullptr, 0);
+    else if (key == "buffer" && strtoul(v, nullptr, 0) > 0)
+        _config.buffer = strtoul(v, nullptr, 0);
+    else if (key == "attach")
+        _config.attach_ms = strtoul(v, nullptr, 0);
+    else if (key == "echo")
+        _echo = _config.echo = atoi(v) != 0;
+    else if (key == "seed")
+        _random.seed(_config.seed = strtoul(v, nullptr, 0));
+    else if (key == "redirect")
+    {
+        size_t colon = value.rfind(':');
+        if (colon == std::string::npos)
+            return false;
+        _config.redirect_host = value.substr(0, colon);
+        _config.redirect_port = (uint16_t)atoi(value.c_str() + colon + 1);
+    }
+    else if (key == "reply")
+    {
+        size_t space = value.find(' ');
+        if (space == std::string::npos)
+            return false;
+        _replies.push_back(std::make_pair(value.substr(0, space), trim(value.substr(space + 1))));
+    }
+    else if (key == "urc")
+    {
+        char *end;
+        unsigned long ms = strtoul(v, &end, 0);
+        std::string line = trim(end);
+        if (end == v || line.empty())
+            return false;
+        _pending.insert(std::make_pair(_startNs + ms * kNsPerMs, "\r\n" + line + "\r\n"));
+    }
+    else if (key == "ufs")
+        _config.ufs = strtoul(v, nullptr, 0);
+    else if (key == "httplength")
+        _config.http_length_delta = atoi(v);
+    else if (key == "qfreaderror")
+        _config.qfread_error = strtoul(v, nullptr, 0);
+    else if (key == "qfreadstall")
+    {
+        char *end;
+        _config.qfread_stall = strtoul(v, &end, 0);
+        _config.qfread_stall_ms = strtoul(end, nullptr, 0);
+        if (end == v)
+            return false;
+    }
+    else
+        return false;
+    return true;
+}
+
+bool Ec200uEmulator::loadScript(const char *path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    std::string line;
+    for (int n = 1; std::getline(in, line); n++)
+    {
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        if (!configure(line))
+        {
+            fprintf(stderr, "%s:%d: bad directive '%s'\n", path, n, line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int Ec200uEmulator::available()
+{
+    pump();
+    return (int)(_outReady - _outPos);
+}
+
+int Ec200uEmulator::read()
+{
+    pump();
+    if (_outPos >= _outReady)
+        return -1;
+    _stats.uart_to_host++;
+    return (uint8_t)_out[_outPos++];
+}
+
+int Ec200uEmulator::peek()
+{
+    pump();
+    return _outPos < _outReady ? (uint8_t)_out[_outPos] : -1;
+}
+
+size_t Ec200uEmulator::readBytes(char *buffer, size_t length)
+{
+    size_t done = 0;
+    uint32_t start = millis();
+    while (done < length)
+    {
+        pump();
+        size_t n = std::min(length - done, _outReady - _outPos);
+        memcpy(buffer + done, _out.data() + _outPos, n);
+        _outPos += n;
+        done += n;
+        if (!n && millis() - start >= _timeout)
+            break;
+    }
+    _stats.uart_to_host += done;
+    return done;
+}
+
+size_t Ec200uEmulator::write(const uint8_t *buffer, size_t size)
+{
+    uint64_t now = nowNs();
+    _stats.uart_to_modem += size;
+    for (size_t i = 0; i < size; i++)
+    {
+        char c = lineNoise(buffer[i]);
+        _inClockNs = std::max(_inClockNs, now) + byteNs();
+
+        // The "\n" of the command's "\r\n" is not payload
+        bool skip = _skipLf && c == '\n';
+        _skipLf = false;
+        if (skip)
+            continue;
+
+        if (_dataSocket >= 0)
+        {
+            dataModeWrite(c, _inClockNs);
+        }
+        else if (_rawLeft)
+        {
+            _raw += c;
+            if (--_rawLeft == 0 && _rawUrl)
+            {
+                _rawUrl = false;
+                _httpUrl.swap(_raw);
+                _raw.clear();
+                ok(_inClockNs + _config.latency_ms * kNsPerMs);
+            }
+            else if (!_rawLeft)
+            {
+                sendRaw(_inClockNs);
+            }
+        }
+        else if (c == '\r')
+        {
+            std::string line;
+            line.swap(_line);
+            _skipLf = true;
+            command(line, _inClockNs);
+        }
+        else if (c != '\n')
+        {
+            _line += c;
+        }
+    }
+
+    if (_dataSocket >= 0 && !_raw.empty())
+    {
+        sendData(_raw.data(), _raw.size());
+        _raw.clear();
+    }
+
+    // Like a UART driver with only the hardware FIFO: block while it is full
+    uint64_t limit = nowNs() + kUartTxFifo * byteNs();
+    if (_inClockNs > limit)
+        usleep((useconds_t)((_inClockNs - limit) / 1000));
+    return size;
+}
+
+void Ec200uEmulator::pump()
+{
+    uint64_t now = nowNs();
+
+    // "+++" stands once the trailing guard time has passed without data
+    if (_escapeNs && now >= _escapeNs)
+        endDataMode(_escapeNs, "\r\nOK\r\n");
+
+    while (!_pending.empty() && _pending.begin()->first <= now)
+    {
+        emit(_pending.begin()->first, _pending.begin()->second);
+        _pending.erase(_pending.begin());
+    }
+
+    // Due replies go out ahead of data that arrives now. Reading the
+    // sockets is a syscall each; while earlier output is still draining
+    // through the UART there is no hurry
+    if (_outReady == _out.size() || now - _lastPollNs > kSocketPollNs)
+    {
+        _lastPollNs = now;
+        for (uint8_t id = 0; id < kSockets; id++)
+            if (_sockets[id].fd >= 0)
+                pumpSocket(id, _sockets[id], now);
+    }
+
+    while (!_chunks.empty())
+    {
+        Chunk &c = _chunks.front();
+        if (now < c.start_ns)
+            break;
+        size_t len = c.end - c.begin;
+        size_t n = byteNs() ? (size_t)std::min<uint64_t>(len, (now - c.start_ns) / byteNs()) : len;
+        _outReady = c.begin + n;
+        if (n < len)
+            break;
+        _chunks.pop_front();
+    }
+
+    if (_nextBaud && now >= _nextBaudNs && _outReady == _out.size())
+    {
+        _config.baud = _nextBaud;
+        _nextBaud = 0;
+    }
+
+    // Drop what the host has consumed once it dominates the buffer
+    if (_outPos > 65536 && _outPos * 2 > _out.size())
+    {
+        _out.erase(0, _outPos);
+        for (size_t i = 0; i < _chunks.size(); i++)
+        {
+            _chunks[i].begin -= _outPos;
+            _chunks[i].end -= _outPos;
+        }
+        _outReady -= _outPos;
+        _outPos = 0;
+    }
+}
+
+void Ec200uEmulator::pumpSocket(uint8_t id, Socket &s, uint64_t now)
+{
+    if (s.stall_until_ns)
+    {
+        if (now < s.stall_until_ns)
+            return;
+        s.stall_until_ns = 0;
+        deliver(s, id, s.held.data(), s.held.size(), now);
+        s.held.clear();
+    }
+    // Nothing can answer data that is still on its way out of the modem
+    if (s.peer_closed || now < s.sent_ns)
+        return;
+
+    if (_config.bandwidth)
+    {
+        double cap = std::max<double>(_config.segment, _config.bandwidth / 20.0);
+        s.tokens = std::min(cap, s.tokens + (now - s.bucket_ns) * 1e-9 * _config.bandwidth);
+        s.bucket_ns = now;
+    }
+
+    _segment.resize(_config.segment);
+    for (;;)
+    {
+        // Data the modem has no room for stays in the peer's TCP window; in
+        // data mode and for pushes that room is what the host has not taken
+        // off the UART, and what arrives goes out whole
+        bool raw = id == _dataSocket || s.push;
+        size_t buffered = raw ? _out.size() - _outPos : s.unread();
+        size_t space = _config.buffer > buffered ? _config.buffer - buffered : 0;
+        size_t want = raw && space ? _config.segment : std::min((size_t)_config.segment, space);
+        if (!want || (_config.bandwidth && s.tokens < want))
+            return;
+
+        ssize_t n = recv(s.fd, &_segment[0], want, MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            return;
+        if (n <= 0)
+        {
+            s.peer_closed = true;
+            if (id == _dataSocket)
+            {
+                endDataMode(now, "\r\nNO CARRIER\r\n");
+                return;
+            }
+            urc(now, std::string(s.ssl ? "+QSSLURC" : "+QIURC") + ": \"closed\"," + std::to_string(id));
+            return;
+        }
+
+        _stats.network_bytes += n;
+        s.tokens -= n;
+        if (_config.loss > 0 && std::uniform_real_distribution<double>(0, 1)(_random) < _config.loss)
+        {
+            // Lost on the radio: it arrives once the sender retransmits
+            _stats.lost_segments++;
+            s.held.assign(&_segment[0], n);
+            s.stall_until_ns = now + _config.rto_ms * kNsPerMs;
+            return;
+        }
+        deliver(s, id, &_segment[0], n, now);
+    }
+}
+
+void Ec200uEmulator::deliver(Socket &s, uint8_t id, const char *data, size_t len, uint64_t now)
+{
+    if (!len)
+        return;
+    if (id == _dataSocket)
+    {
+        s.total += len;
+        s.read += len;
+        emit(now, std::string(data, len));
+        return;
+    }
+    if (s.push)
+    {
+        for (size_t done = 0; done < len;)
+        {
+            size_t n = std::min(len - done, kMaxRead);
+            _stats.urcs++;
+            emit(now, std::string("\r\n") + (s.ssl ? "+QSSLURC" : "+QIURC") + ": \"recv\"," + std::to_string(id) +
+                          "," + std::to_string(n) + "\r\n" + std::string(data + done, n));
+            done += n;
+        }
+        s.total += len;
+        s.read += len;
+        return;
+    }
+    if (s.data_pos > 65536 && s.data_pos * 2 > s.data.size())
+    {
+        s.data.erase(0, s.data_pos);
+        s.data_pos = 0;
+    }
+    s.data.append(data, len);
+    s.total += len;
+
+    // Buffer access mode reports "recv" once per batch: again only after
+    // the host has read the buffer empty
+    if (!s.urc_pending)
+    {
+        s.urc_pending = true;
+        if (_config.urc_loss > 0 && std::uniform_real_distribution<double>(0, 1)(_random) < _config.urc_loss)
+            _stats.lost_urcs++;
+        else
+            urc(now, std::string(s.ssl ? "+QSSLURC" : "+QIURC") + ": \"recv\"," + std::to_string(id));
+    }
+}
+
+void Ec200uEmulator::emit(uint64_t at, const std::string &text)
+{
+    Chunk c;
+    c.begin = _out.size();
+    c.end = c.begin + text.size();
+    c.start_ns = std::max(at, _txEndNs);
+    _txEndNs = c.start_ns + text.size() * byteNs();
+    _chunks.push_back(c);
+    _out += text;
+    for (size_t i = c.begin; i < c.end; i++)
+        _out[i] = lineNoise(_out[i]);
+}
+
+void Ec200uEmulator::reply(uint64_t at, const std::string &text)
+{
+    _pending.insert(std::make_pair(at, text));
+}
+
+void Ec200uEmulator::ok(uint64_t at, const std::string &info)
+{
+    reply(at, info.empty() ? std::string("\r\nOK\r\n") : "\r\n" + info + "\r\n\r\nOK\r\n");
+}
+
+void Ec200uEmulator::error(uint64_t at)
+{
+    reply(at, "\r\nERROR\r\n");
+}
+
+void Ec200uEmulator::urc(uint64_t at, const std::string &line)
+{
+    _stats.urcs++;
+    reply(at, "\r\n" + line + "\r\n");
+}
+
+bool Ec200uEmulator::registered() const
+{
+    return nowNs() - _startNs >= _config.attach_ms * kNsPerMs;
+}
+
+// A byte as the other end of the UART sees it
+char Ec200uEmulator::lineNoise(char c)
+{
+    if (_hostBaud && _hostBaud != _config.baud)
+    {
+        // Framed at the wrong rate: never a valid character
+        _stats.corrupted++;
+        return (char)(c ^ 0xA5);
+    }
+    if (_config.link_max && _config.baud > _config.link_max &&
+        std::uniform_real_distribution<double>(0, 1)(_random) < kLinkErrorRate)
+    {
+        _stats.corrupted++;
+        return (char)(c ^ 0x10);
+    }
+    return c;
+}
+
+void Ec200uEmulator::command(const std::string &line, uint64_t at)
+{
+    if (line.empty())
+        return;
+    _stats.commands++;
+    if (_echo)
+        reply(at, line + "\r\n");
+    uint64_t t = at + _config.latency_ms * kNsPerMs;
+
+    if (line.size() < 2 || strncasecmp(line.c_str(), "AT", 2) != 0)
+    {
+        error(t);
+        return;
+    }
+    std::string body = line.substr(2);
+    const char *cmd = body.c_str();
+
+    for (size_t i = 0; i < _replies.size(); i++)
+    {
+        if (starts_with(cmd, _replies[i].first.c_str()))
+        {
+            ok(t, _replies[i].second);
+            return;
+        }
+    }
+
+    if (socketCommand(cmd, t) || fileCommand(cmd, t))
+        return;
+
+    if (body == "E0" || body == "E1")
+    {
+        _echo = body == "E1";
+        ok(t);
+    }
+    else if (starts_with(cmd, "+CFUN=1,1"))
+    {
+        ok(t);
+        for (uint8_t id = 0; id < kSockets; id++)
+            close(id);
+        _pdpActive = false;
+        _echo = true;
+        reply(t + kRebootNs / 2, "\r\nRDY\r\n");
+        reply(t + kRebootNs, "\r\nAPP RDY\r\n");
+    }
+    else if (starts_with(cmd, "+IPR="))
+    {
+        unsigned long baud = strtoul(cmd + 5, nullptr, 10);
+        if (!baud)
+        {
+            error(t);
+            return;
+        }
+        ok(t);
+        _nextBaud = baud;
+        _nextBaudNs = t;
+    }
+    else if (body == "+IPR?")
+        ok(t, "+IPR: " + std::to_string(_config.baud));
+    else if (body == "I")
+        ok(t, "Quectel\r\nEC200U\r\nRevision: EC200UCNAAR03A10M08");
+    else if (body == "+CGMI")
+        ok(t, "Quectel");
+    else if (body == "+CGMM")
+        ok(t, "EC200U");
+    else if (body == "+CGMR")
+        ok(t, "EC200UCNAAR03A10M08");
+    else if (body == "+CGSN" || body == "+GSN")
+        ok(t, "861234050000001");
+    else if (body == "+CIMI")
+        ok(t, "001010000000001");
+    else if (body == "+QCCID")
+        ok(t, "+QCCID: 89860000000000000001");
+    else if (body == "+CPIN?")
+        ok(t, "+CPIN: READY");
+    else if (body == "+CSQ")
+        ok(t, registered() ? "+CSQ: 23,99" : "+CSQ: 99,99");
+    else if (body == "+CEREG?" || body == "+CREG?" || body == "+CGREG?")
+        ok(t, body.substr(0, body.size() - 1) + ": 0," + (registered() ? "1" : "2"));
+    else if (body == "+CGATT?")
+        ok(t, std::string("+CGATT: ") + (registered() ? "1" : "0"));
+    else if (body == "+COPS?")
+        ok(t, "+COPS: 0,0,\"Emulator\",7");
+    else if (body == "+QSPN?")
+        ok(t, "+QSPN: \"Emulator\",\"Emulator\",\"\",0,\"00101\"");
+    else if (body == "+QIACT?")
+        ok(t, _pdpActive ? std::string("+QIACT: 1,1,1,\"") + kLocalIp + "\"" : std::string());
+    else if (body == "+QIACT=1")
+    {
+        if (!registered())
+        {
+            error(t);
+            return;
+        }
+        _pdpActive = true;
+        ok(t);
+    }
+    else if (body == "+QIDEACT=1")
+    {
+        for (uint8_t id = 0; id < kSockets; id++)
+            close(id);
+        _pdpActive = false;
+        ok(t);
+    }
+    else if (body == "+CGPADDR=1")
+        ok(t, std::string("+CGPADDR: 1,") + (_pdpActive ? kLocalIp : "0.0.0.0"));
+    else if (body == "+QPOWD=1")
+    {
+        ok(t);
+        reply(t + kRebootNs / 2, "\r\nPOWERED DOWN\r\n");
+    }
+    else
+    {
+        // +CMEE, +CTZR, +CTZU, +QICSGP, +CGATT=1, +QSSLCFG...: accepted
+        ok(t);
+    }
+}
+
+bool Ec200uEmulator::socketCommand(const char *cmd, uint64_t t)
+{
+    unsigned ctx, ssl_ctx, id, port, len, local_port = 0, access_mode = 0;
+    char type[16], host[128];
+
+    if (sscanf(cmd, "+QIOPEN=%u,%u,\"%15[^\"]\",\"%127[^\"]\",%u,%u,%u", &ctx, &id, type, host, &port, &local_port,
+               &access_mode) >= 5)
+    {
+        if (id >= kSockets)
+        {
+            error(t);
+            return true;
+        }
+        if (access_mode == 2)
+        {
+            if (open((uint8_t)id, host, (uint16_t)port, false) != 0)
+            {
+                error(std::max(t, nowNs()));
+                return true;
+            }
+            reply(std::max(t, nowNs()), "\r\nCONNECT\r\n");
+            _dataSocket = id;
+            _lastDataNs = t;
+            return true;
+        }
+        ok(t);
+        int err = open((uint8_t)id, host, (uint16_t)port, false);
+        _sockets[id].push = err == 0 && access_mode == 1;
+        urc(std::max(t, nowNs()), "+QIOPEN: " + std::to_string(id) + "," + std::to_string(err));
+        return true;
+    }
+    if (sscanf(cmd, "+QSSLOPEN=%u,%u,%u,\"%127[^\"]\",%u,%u", &ctx, &ssl_ctx, &id, host, &port, &access_mode) >= 5)
+    {
+        if (id >= kSockets)
+        {
+            error(t);
+            return true;
+        }
+        ok(t);
+        int err = open((uint8_t)id, host, (uint16_t)port, true);
+        _sockets[id].push = err == 0 && access_mode == 1;
+        urc(std::max(t, nowNs()), "+QSSLOPEN: " + std::to_string(id) + "," + std::to_string(err));
+        return true;
+    }
+    if (sscanf(cmd, "+QICLOSE=%u", &id) == 1 || sscanf(cmd, "+QSSLCLOSE=%u", &id) == 1)
+    {
+        if (id < kSockets)
+            close((uint8_t)id);
+        ok(t);
+        return true;
+    }
+
+    bool ssl = starts_with(cmd, "+QSSL");
+    int fields = ssl ? sscanf(cmd, "+QSSLSEND=%u,%u", &id, &len) : sscanf(cmd, "+QISEND=%u,%u", &id, &len);
+    if (fields == 2)
+    {
+        Socket *s = id < kSockets ? &_sockets[id] : nullptr;
+        if (!s || s->fd < 0 || s->peer_closed)
+            error(t);
+        else if (len == 0)
+            ok(t, std::string(ssl ? "+QSSLSEND: " : "+QISEND: ") + std::to_string(s->sent) + "," +
+                      std::to_string(s->sent) + ",0");
+        else
+        {
+            reply(t, "\r\n> ");
+            _rawLeft = len;
+            _rawSocket = (uint8_t)id;
+            _raw.clear();
+        }
+        return true;
+    }
+
+    len = kMaxRead;
+    fields = ssl ? sscanf(cmd, "+QSSLRECV=%u,%u", &id, &len) : sscanf(cmd, "+QIRD=%u,%u", &id, &len);
+    if (fields >= 1)
+    {
+        const char *prefix = ssl ? "+QSSLRECV: " : "+QIRD: ";
+        Socket *s = id < kSockets ? &_sockets[id] : nullptr;
+        if (!s || s->fd < 0)
+        {
+            error(t);
+            return true;
+        }
+        if (len == 0)
+        {
+            ok(t, prefix + std::to_string(s->total) + "," + std::to_string(s->read) + "," +
+                      std::to_string(s->unread()));
+            return true;
+        }
+        size_t n = std::min(std::min((size_t)len, s->unread()), kMaxRead);
+        std::string text = "\r\n" + std::string(prefix) + std::to_string(n) + "\r\n";
+        text.append(s->data, s->data_pos, n);
+        text += n ? "\r\n\r\nOK\r\n" : "\r\nOK\r\n";
+        s->data_pos += n;
+        s->read += n;
+        if (!s->unread())
+            s->urc_pending = false;
+        reply(t, text);
+        return true;
+    }
+
+    if (sscanf(cmd, "+QISTATE=1,%u", &id) == 1 || sscanf(cmd, "+QSSLSTATE=1,%u", &id) == 1)
+    {
+        Socket *s = id < kSockets ? &_sockets[id] : nullptr;
+        if (!s || s->fd < 0)
+        {
+            ok(t);
+            return true;
+        }
+        // 2 = connected, 4 = closing (the peer has closed)
+        char info[256];
+        snprintf(info, sizeof(info), "%s: %u,\"%s\",\"%s\",%u,%u,%d,1,%u,0,\"uart1\"",
+                 ssl ? "+QSSLSTATE" : "+QISTATE", id, ssl ? "SSLClient" : "TCP", s->host.c_str(), s->port,
+                 s->local_port, s->peer_closed ? 4 : 2, id);
+        ok(t, info);
+        return true;
+    }
+    return false;
+}
+
+// The modem's HTTP client and its UFS file system. The body is fetched
+// whole when +QHTTPGET comes in; the bandwidth directive delays the URC.
+bool Ec200uEmulator::fileCommand(const char *cmd, uint64_t t)
+{
+    unsigned len, timeout, handle, offset, mode;
+    char name[128];
+
+    if (sscanf(cmd, "+QHTTPURL=%u,%u", &len, &timeout) >= 1)
+    {
+        if (!len)
+        {
+            error(t);
+            return true;
+        }
+        reply(t, "\r\nCONNECT\r\n");
+        _rawLeft = len;
+        _rawUrl = true;
+        _raw.clear();
+        return true;
+    }
+    if (sscanf(cmd, "+QHTTPGET=%u", &timeout) == 1)
+    {
+        ok(t);
+        httpGet(t);
+        return true;
+    }
+    if (sscanf(cmd, "+QHTTPREADFILE=\"%127[^\"]\"", name) == 1)
+    {
+        ok(t);
+        size_t used = 0;
+        for (std::map<std::string, std::string>::const_iterator f = _files.begin(); f != _files.end(); ++f)
+            used += f->first == name ? 0 : f->second.size();
+        if (used + _httpBody.size() > _config.ufs)
+        {
+            urc(t, "+QHTTPREADFILE: 407");
+            return true;
+        }
+        _files[name] = _httpBody;
+        urc(t, "+QHTTPREADFILE: 0");
+        return true;
+    }
+    if (starts_with(cmd, "+QFLDS="))
+    {
+        size_t used = 0;
+        for (std::map<std::string, std::string>::const_iterator f = _files.begin(); f != _files.end(); ++f)
+            used += f->second.size();
+        ok(t, "+QFLDS: " + std::to_string(_config.ufs - std::min(used, (size_t)_config.ufs)) + "," +
+                  std::to_string(_config.ufs));
+        return true;
+    }
+    if (sscanf(cmd, "+QFLST=\"%127[^\"]\"", name) == 1)
+    {
+        std::map<std::string, std::string>::const_iterator f = _files.find(name);
+        if (f == _files.end())
+            reply(t, "\r\n+CME ERROR: 405\r\n"); // file not found
+        else
+            ok(t, "+QFLST: \"" + f->first + "\"," + std::to_string(f->second.size()));
+        return true;
+    }
+    if (sscanf(cmd, "+QFDEL=\"%127[^\"]\"", name) == 1)
+    {
+        if (_files.erase(name))
+            ok(t);
+        else
+            reply(t, "\r\n+CME ERROR: 405\r\n");
+        return true;
+    }
+    if (sscanf(cmd, "+QFOPEN=\"%127[^\"]\",%u", name, &mode) >= 1)
+    {
+        if (!_files.count(name))
+        {
+            reply(t, "\r\n+CME ERROR: 405\r\n");
+            return true;
+        }
+        unsigned h = _nextHandle++;
+        _handles[h] = std::make_pair(std::string(name), (size_t)0);
+        ok(t, "+QFOPEN: " + std::to_string(h));
+        return true;
+    }
+    len = ~0u;
+    if (sscanf(cmd, "+QFREAD=%u,%u", &handle, &len) >= 1)
+    {
+        _stats.file_reads++;
+        std::map<unsigned, std::pair<std::string, size_t> >::iterator h = _handles.find(handle);
+        if (h == _handles.end() || !_files.count(h->second.first) || _stats.file_reads == _config.qfread_error)
+        {
+            reply(t, "\r\n+CME ERROR: 401\r\n");
+            return true;
+        }
+        const std::string &file = _files[h->second.first];
+        size_t pos = std::min(h->second.second, file.size());
+        size_t n = std::min((size_t)len, file.size() - pos);
+        h->second.second = pos + n;
+        std::string text = "\r\nCONNECT " + std::to_string(n) + "\r\n" + file.substr(pos, n) + "\r\nOK\r\n";
+        if (_stats.file_reads == _config.qfread_stall && n > 1)
+        {
+            // The UART goes quiet halfway through the payload
+            size_t split = text.size() - 6 - n / 2;
+            reply(t, text.substr(0, split));
+            reply(t + _config.qfread_stall_ms * kNsPerMs, text.substr(split));
+            return true;
+        }
+        reply(t, text);
+        return true;
+    }
+    if (sscanf(cmd, "+QFSEEK=%u,%u", &handle, &offset) == 2)
+    {
+        std::map<unsigned, std::pair<std::string, size_t> >::iterator h = _handles.find(handle);
+        if (h == _handles.end() || offset > _files[h->second.first].size())
+        {
+            reply(t, "\r\n+CME ERROR: 401\r\n");
+            return true;
+        }
+        h->second.second = offset;
+        ok(t);
+        return true;
+    }
+    if (sscanf(cmd, "+QFCLOSE=%u", &handle) == 1)
+    {
+        if (_handles.erase(handle))
+            ok(t);
+        else
+            reply(t, "\r\n+CME ERROR: 401\r\n");
+        return true;
+    }
+    return false;
+}
+
+// Fetches _httpUrl over HTTP/1.0 into _httpBody and reports the result as
+// +QHTTPGET: <err>,<status>,<content length>
+void Ec200uEmulator::httpGet(uint64_t t)
+{
+    std::string host, path;
+    uint16_t port = 0;
+    _httpBody.clear();
+    if (!_pdpActive)
+    {
+        urc(t, "+QHTTPGET: 709"); // network deactivated
+        return;
+    }
+    if (!parse_http_url(_httpUrl, host, port, path))
+    {
+        urc(t, "+QHTTPGET: 711"); // URL error
+        return;
+    }
+    int fd = -1;
+    int err = tcp_connect(_config.redirect_host.empty() ? host : _config.redirect_host,
+                          _config.redirect_port ? _config.redirect_port : port, &fd);
+    if (err)
+    {
+        urc(t, err == 565 ? "+QHTTPGET: 714" : "+QHTTPGET: 707"); // DNS error, open failed
+        return;
+    }
+    timeval tv = {30, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    std::string request = "GET " + path + " HTTP/1.0\r\nHost: " + host + "\r\nConnection: close\r\n\r\n";
+    bool sent = send(fd, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size();
+    std::string response;
+    char buf[16384];
+    for (;;)
+    {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        response.append(buf, n);
+    }
+    ::close(fd);
+
+    size_t headerEnd = response.find("\r\n\r\n");
+    int status = 0;
+    if (!sent || headerEnd == std::string::npos || sscanf(response.c_str(), "HTTP/%*s %d", &status) != 1)
+    {
+        urc(t, "+QHTTPGET: 710"); // network error
+        return;
+    }
+    _httpBody = response.substr(headerEnd + 4);
+    _stats.network_bytes += _httpBody.size();
+    uint64_t done = std::max(t, nowNs());
+    if (_config.bandwidth)
+        done += (uint64_t)(_httpBody.size() * 1e9 / _config.bandwidth);
+    urc(done, "+QHTTPGET: 0," + std::to_string(status) + "," +
+                  std::to_string((long)_httpBody.size() + _config.http_length_delta));
+}
+
+void Ec200uEmulator::sendRaw(uint64_t at)
+{
+    Socket &s = _sockets[_rawSocket];
+    uint64_t t = at + _config.latency_ms * kNsPerMs;
+    size_t done = 0;
+    while (s.fd >= 0 && done < _raw.size())
+    {
+        ssize_t n = send(s.fd, _raw.data() + done, _raw.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    s.sent += done;
+    s.sent_ns = t;
+    reply(t, done == _raw.size() ? "\r\nSEND OK\r\n" : "\r\nSEND FAIL\r\n");
+    _raw.clear();
+}
+
+void Ec200uEmulator::dataModeWrite(char c, uint64_t at)
+{
+    // A "+" after a guard time of silence may start the escape; anything
+    // written before the trailing guard time ends makes it data again
+    bool quiet = at - _lastDataNs >= kEscapeGuardNs;
+    _lastDataNs = at;
+    if (c == '+' && _plus.size() < 3 && (!_plus.empty() || quiet))
+    {
+        _plus += c;
+        _escapeNs = _plus.size() == 3 ? at + kEscapeGuardNs : 0;
+        return;
+    }
+    _raw += _plus;
+    _raw += c;
+    _plus.clear();
+    _escapeNs = 0;
+}
+
+void Ec200uEmulator::sendData(const char *data, size_t len)
+{
+    Socket &s = _sockets[_dataSocket];
+    size_t done = 0;
+    while (s.fd >= 0 && done < len)
+    {
+        ssize_t n = send(s.fd, data + done, len - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    s.sent += done;
+}
+
+void Ec200uEmulator::endDataMode(uint64_t at, const char *text)
+{
+    if (_dataSocket >= 0 && !_raw.empty())
+        sendData(_raw.data(), _raw.size());
+    _raw.clear();
+    _plus.clear();
+    _escapeNs = 0;
+    _dataSocket = -1;
+    emit(std::max(at, nowNs()), text);
+}
+
+int Ec200uEmulator::open(uint8_t id, const char *host, uint16_t port, bool ssl)
+{
+    if (_sockets[id].fd >= 0)
+        return 563; // socket identity has been used
+    if (!_pdpActive)
+        return 566;
+
+    std::string target = _config.redirect_host.empty() ? std::string(host) : _config.redirect_host;
+    uint16_t targetPort = _config.redirect_port ? _config.redirect_port : port;
+    int fd = -1;
+    int err = tcp_connect(target, targetPort, &fd);
+    if (err)
+        return err;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    Socket &s = _sockets[id];
+    s = Socket();
+    s.fd = fd;
+    s.ssl = ssl;
+    s.host = host;
+    s.port = port;
+    sockaddr_storage local;
+    socklen_t l = sizeof(local);
+    if (getsockname(fd, (sockaddr *)&local, &l) == 0)
+        s.local_port = ntohs(local.ss_family == AF_INET6 ? ((sockaddr_in6 *)&local)->sin6_port
+                                                         : ((sockaddr_in *)&local)->sin_port);
+    return 0;
+}
+
+void Ec200uEmulator::close(uint8_t id)
+{
+    Socket &s = _sockets[id];
+    if (s.fd >= 0)
+        ::close(s.fd);
+    s = Socket();
+    if (_rawLeft && _rawSocket == id)
+        _rawLeft = 0;
+    if (_dataSocket == id)
+    {
+        _dataSocket = -1;
+        _plus.clear();
+        _escapeNs = 0;
+    }
+}
@@ -0,0 +1,237 @@
+// Software EC200U for host runs. It is the modem end of the UART: hand it
+// to TinyGsm as the Stream. It speaks the AT subset TinyGsmEC200U uses
+// (registration, +QIACT, +QIOPEN/+QISEND/+QIRD/+QISTATE/+QICLOSE, the
+// +QSSL* equivalents and the +QIURC URCs) and backs every socket with a
+// real TCP connection, so an unmodified TinyGSM + HttpClient stack can
+// download from a local HTTP server. The modem's own HTTP client
+// (+QHTTPURL/+QHTTPGET/+QHTTPREADFILE) fetches over real TCP too, into an
+// in-memory UFS that +QFLDS/+QFLST/+QFOPEN/+QFREAD/+QFSEEK/+QFCLOSE/+QFDEL
+// work on, as TinyGsmEC200UHttpFile uses them.
+//
+// The link is shaped by directives, read from a script file or passed one
+// at a time:
+//
+//   baud <bps>             UART rate both ways, 10 bits a byte (0 = unlimited)
+//   linkmax <bps>          above this rate about one byte in 200 is corrupted
+//   latency <ms>           modem time before each command's reply
+//   bandwidth <bytes/s>    downlink rate into the socket buffers (0 = unlimited)
+//   loss <0..1>            chance that a downlink segment is lost
+//   urcloss <0..1>         chance that a "recv" URC is never sent
+//   rto <ms>               stall a lost segment costs before it is retransmitted
+//   segment <bytes>        downlink segment size
+//   buffer <bytes>         receive buffer per socket in the modem
+//   redirect <host:port>   connect every socket there instead
+//   echo <0|1>             command echo until ATE0
+//   attach <ms>            time after start until the network registers
+//   seed <n>               loss pattern
+//   reply <command> <line> answer commands starting with <command> with <line> + OK
+//   urc <ms> <line>        send <line> unsolicited that long after start
+//   ufs <bytes>            UFS capacity
+//   httplength <delta>     +QHTTPGET reports a Content-Length off by <delta>
+//   qfreaderror <n>        the nth +QFREAD answers +CME ERROR
+//   qfreadstall <n> <ms>   the nth +QFREAD pauses that long halfway through
+//                          its payload
+//
+// Sockets opened with access mode 1 (direct push) get their data sent as
+// +QIURC: "recv",<id>,<len> with the payload right behind it, paced like
+// data mode. +QIOPEN with access mode 2 (transparent) answers CONNECT and puts the
+// UART in data mode: host bytes go to the socket as they are, the socket's
+// bytes come back raw, paced by the buffer directive instead of +QIRD, and
+// "+++" between one-second guard times returns to command mode. A peer
+// close ends data mode with NO CARRIER.
+//
+// AT+IPR changes the modem's rate once its OK has gone out. Bytes cross
+// the UART intact only while the host's rate (setHostBaud) matches it.
+//
+// TLS is not emulated: +QSSLOPEN sockets carry plain TCP.
+
+#ifndef EC200U_EMULATOR_H
+#define EC200U_EMULATOR_H
+
+#include <Arduino.h>
+
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Ec200uEmulatorConfig
+{
+    uint32_t baud = 115200;
+    uint32_t link_max = 0;
+    uint32_t latency_ms = 0;
+    uint32_t bandwidth = 0;
+    double loss = 0;
+    double urc_loss = 0;
+    uint32_t rto_ms = 300;
+    uint32_t segment = 1400;
+    uint32_t buffer = 16384; // TinyGSM parses the unread count as int16_t
+    uint32_t attach_ms = 0;
+    std::string redirect_host;
+    uint16_t redirect_port = 0;
+    bool echo = true;
+    uint32_t seed = 1;
+    uint32_t ufs = 6 * 1024 * 1024;
+    int32_t http_length_delta = 0;
+    uint32_t qfread_error = 0;
+    uint32_t qfread_stall = 0;
+    uint32_t qfread_stall_ms = 0;
+};
+
+struct Ec200uEmulatorStats
+{
+    size_t commands = 0;
+    size_t uart_to_modem = 0;   // bytes the host wrote
+    size_t uart_to_host = 0;    // bytes the host read
+    size_t network_bytes = 0;   // downlink payload received from the peers
+    size_t lost_segments = 0;
+    size_t lost_urcs = 0;
+    size_t corrupted = 0;       // UART bytes garbled by a rate mismatch or linkmax
+    size_t urcs = 0;
+    size_t file_reads = 0;      // +QFREAD commands
+};
+
+class Ec200uEmulator : public Stream
+{
+public:
+    static const uint8_t kSockets = 12;
+
+    Ec200uEmulator();
+    ~Ec200uEmulator();
+
+    // One directive ("baud 921600"). Returns false if it is not understood.
+    bool configure(const std::string &directive);
+    // Directives one per line; '#' starts a comment.
+    bool loadScript(const char *path);
+
+    const Ec200uEmulatorConfig &config() const { return _config; }
+    const Ec200uEmulatorStats &stats() const { return _stats; }
+
+    // The rate the host's UART is set to; 0 (the default) follows the modem
+    void setHostBaud(uint32_t baud) { _hostBaud = baud; }
+
+    // Stream, host side
+    int available() override;
+    int read() override;
+    int peek() override;
+    // Bulk copy of what has crossed the UART, like HardwareSerial's
+    size_t readBytes(char *buffer, size_t length) override;
+    using Stream::readBytes;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    void flush() override {}
+    using Print::write;
+
+private:
+    struct Socket
+    {
+        int fd = -1;
+        bool ssl = false;
+        bool peer_closed = false;
+        bool urc_pending = false; // "recv" sent, not yet read out
+        bool push = false;        // direct push access mode
+        std::string host;
+        uint16_t port = 0;
+        uint16_t local_port = 0;
+        std::string data; // modem receive buffer
+        size_t data_pos = 0;
+        std::string held; // lost segment waiting for retransmission
+        size_t total = 0;
+        size_t read = 0;
+        size_t sent = 0;
+        uint64_t sent_ns = 0; // last +QISEND payload left the modem
+        uint64_t stall_until_ns = 0;
+        uint64_t bucket_ns = 0;
+        double tokens = 0;
+
+        size_t unread() const { return data.size() - data_pos; }
+    };
+
+    // A run of output released to the host at the baud rate from start_ns
+    struct Chunk
+    {
+        size_t begin;
+        size_t end;
+        uint64_t start_ns;
+    };
+
+    uint64_t nowNs() const { return micros() * 1000ULL; }
+    uint64_t byteNs() const { return _config.baud ? 10000000000ULL / _config.baud : 0; }
+    bool registered() const;
+    char lineNoise(char c);
+
+    void pump();
+    void pumpSocket(uint8_t id, Socket &s, uint64_t now);
+    void deliver(Socket &s, uint8_t id, const char *data, size_t len, uint64_t now);
+
+    void command(const std::string &line, uint64_t at);
+    bool socketCommand(const char *cmd, uint64_t at);
+    bool fileCommand(const char *cmd, uint64_t at);
+    void httpGet(uint64_t at);
+    void sendRaw(uint64_t at);
+    void dataModeWrite(char c, uint64_t at);
+    void sendData(const char *data, size_t len);
+    void endDataMode(uint64_t at, const char *text);
+    void emit(uint64_t at, const std::string &text);
+    void reply(uint64_t at, const std::string &text);
+    void ok(uint64_t at, const std::string &info = std::string());
+    void error(uint64_t at);
+    void urc(uint64_t at, const std::string &line);
+
+    int open(uint8_t id, const char *host, uint16_t port, bool ssl);
+    void close(uint8_t id);
+
+    Ec200uEmulatorConfig _config;
+    Ec200uEmulatorStats _stats;
+    std::mt19937 _random;
+    uint64_t _startNs;
+
+    // Modem to host: replies wait in _pending until due, then queue in
+    // _out; bytes before _outReady have crossed the UART
+    std::multimap<uint64_t, std::string> _pending;
+    std::string _out;
+    std::deque<Chunk> _chunks;
+    size_t _outReady;
+    size_t _outPos;
+    uint64_t _txEndNs;
+    uint64_t _lastPollNs;
+
+    // Host to modem
+    uint64_t _inClockNs;
+    std::string _line;
+    bool _skipLf;
+    size_t _rawLeft;
+    uint8_t _rawSocket;
+    bool _rawUrl; // the raw bytes are a +QHTTPURL URL, not socket data
+    std::string _raw;
+
+    // Transparent access mode: the socket on the UART, the "+" run that
+    // may be an escape, and when the bytes around it were written
+    int _dataSocket;
+    std::string _plus;
+    uint64_t _lastDataNs;
+    uint64_t _escapeNs;
+
+    // AT+IPR: the rate to switch to once the reply has drained
+    uint32_t _hostBaud;
+    uint32_t _nextBaud;
+    uint64_t _nextBaudNs;
+
+    bool _echo;
+    bool _pdpActive;
+    Socket _sockets[kSockets];
+    std::string _segment;
+
+    // The modem's HTTP client: the URL set, and the last response
+    std::string _httpUrl;
+    std::string _httpBody;
+    // UFS: files by name, and open handles with their position
+    std::map<std::string, std::string> _files;
+    std::map<unsigned, std::pair<std::string, size_t> > _handles;
+    unsigned _nextHandle;
+    std::vector<std::pair<std::string, std::string> > _replies;
+};
+
+#endif
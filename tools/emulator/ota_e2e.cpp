@@ -0,0 +1,367 @@
+// End-to-end OTA download over the emulated EC200U: the firmware's modem
+// bring-up (restart, waitForNetwork, gprsConnect) and ota_task()'s
+// download loop, run on the host through unmodified TinyGSM and
+// ArduinoHttpClient against a real HTTP server. Shaping directives (see
+// ec200u_emulator.h) come from a script and/or the command line.
+//
+// -t downloads through the transparent-mode client (access mode 2)
+// instead of the buffer-mode one the firmware uses by default. The
+// ota_e2e_push build opens its sockets in direct push mode (access mode 1),
+// and ota_e2e_poll checks for unannounced data every 500 ms as TinyGSM did
+// before TINY_GSM_URC_NOTIFY. -i <ms> keeps the socket idle that long after
+// the body (use a server that holds the connection open) and reports the
+// serial traffic it costs. -l <bps> first negotiates the UART up to that
+// rate as the firmware's ota_link_begin() does (see ota_link.h), starting
+// from the baud directive; add -n to negotiate as a board without RTS/CTS
+// wired.
+//
+// -f downloads as OTA_MODEM_FILE does: the modem's HTTP client fetches the
+// URL into UFS and TinyGsmEC200UHttpFile reads it back with AT+QFREAD. The
+// qfreaderror, qfreadstall and httplength directives drive its error
+// paths; result= then says which step failed (download_failed,
+// read_failed) and at_clean whether the AT channel still answers after it.
+//
+// The URCs the firmware registers handlers for (see main.cpp) are counted
+// as app_urcs; inject some with urc directives.
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target ota_e2e
+// Run:    python3 -m http.server 8000 &   # serving firmware.bin
+//         ./build/tools/ota_e2e [-t | -f] [-i ms] [-l bps [-n]] [-s script] [baud=921600 latency=20 ...] http://127.0.0.1:8000/firmware.bin
+//
+// Prints one key=value line: connect (modem bring-up), ttfb (GET sent to
+// status line), bytes/s over the body, AT traffic, how busy each direction
+// of the serial line was (share of the time it carried bytes), +QISENDs
+// saved by the send buffer on the request, and the body's SHA-256.
+
+#define TINY_GSM_MODEM_EC200U
+#if defined(TINY_GSM_EC200U_DIRECT_PUSH)
+#define TINY_GSM_RX_BUFFER 2048 // as in src/main.cpp
+#else
+#define TINY_GSM_RX_BUFFER 1024 // as in src/main.cpp
+#endif
+#define TINY_GSM_TX_BUFFER 512  // as in src/main.cpp
+#if !defined(OTA_E2E_URC_POLL)
+#define TINY_GSM_URC_NOTIFY // as in src/main.cpp
+#endif
+
+#include <TinyGsmClient.h>
+#include <TinyGsmEC200UHttpFile.h>
+#include <ArduinoHttpClient.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+
+#include "ec200u_emulator.h"
+#include "ota_digest.h"
+#include "ota_link.h"
+
+namespace
+{
+const char kApn[] = "airteliot.com";
+const uint32_t kNetworkTimeout = 30 * 1000; // as ota_task()
+const uint32_t kNetworkDelay = 1000;
+#if defined(TINY_GSM_EC200U_DIRECT_PUSH)
+const char kSocketMode[] = "push";
+#elif defined(TINY_GSM_URC_NOTIFY)
+const char kSocketMode[] = "buffer";
+#else
+const char kSocketMode[] = "buffer-poll";
+#endif
+
+void emulator_set_baud(void *ctx, uint32_t baud)
+{
+    static_cast<Ec200uEmulator *>(ctx)->setHostBaud(baud);
+}
+
+// The emulated UART never overruns; RTS/CTS only has to be accepted,
+// unless -n says the pins are not wired
+bool s_rtsCtsWired = true;
+
+bool emulator_set_flow_control(void *, bool)
+{
+    return s_rtsCtsWired;
+}
+
+// The application's URC handlers in main.cpp, reduced to a count
+bool count_urc(void *ctx, TinyGsmUrcFields &)
+{
+    ++*static_cast<unsigned *>(ctx);
+    return true;
+}
+
+// Share of ms during which one direction of the line carried bytes
+double line_busy(size_t bytes, uint32_t baud, uint32_t ms)
+{
+    return baud && ms ? bytes * 10.0 / baud * 1000.0 / ms : 0.0;
+}
+
+struct Url
+{
+    std::string host;
+    uint16_t port = 80;
+    std::string path = "/";
+};
+
+bool parse_url(const char *text, Url &url)
+{
+    if (strncmp(text, "http://", 7) != 0)
+        return false;
+    std::string rest = text + 7;
+    size_t slash = rest.find('/');
+    if (slash != std::string::npos)
+    {
+        url.path = rest.substr(slash);
+        rest.erase(slash);
+    }
+    size_t colon = rest.rfind(':');
+    if (colon != std::string::npos)
+    {
+        url.port = (uint16_t)atoi(rest.c_str() + colon + 1);
+        rest.erase(colon);
+    }
+    url.host = rest;
+    return !url.host.empty() && url.port;
+}
+
+// ota_modem_file_task(): the modem fetches the file, the host reads it out
+// in AT+QFREAD blocks and hashes it
+int run_file_mode(TinyGsm &modem, uint32_t baud, const char *url, uint32_t connectMs)
+{
+    TinyGsmEC200UHttpFile file(modem);
+    file.setBaud(baud);
+    uint32_t start = millis();
+    int status = file.download(url);
+    uint32_t fetchMs = millis() - start;
+    const char *result = "ok";
+    OtaSha256 sha;
+    sha.begin();
+    size_t total = 0;
+    uint32_t readMs = 0;
+    if (status != 200 || !file.open())
+    {
+        result = "download_failed";
+    }
+    else
+    {
+        static uint8_t buffer[TINY_GSM_EC200U_QFREAD_MAX];
+        start = millis();
+        while (file.connected())
+        {
+            int len = file.read(buffer, sizeof(buffer));
+            if (len <= 0)
+                break;
+            sha.update(buffer, len);
+            total += len;
+        }
+        readMs = millis() - start;
+        if (total != file.size())
+            result = file.connected() ? "incomplete" : "read_failed";
+    }
+    // After a failed read the next command must still get its own reply
+    bool atClean = modem.testAT(1000);
+    file.remove();
+
+    uint8_t digest[kOtaSha256Size];
+    sha.finish(digest);
+    char hex[2 * kOtaSha256Size + 1];
+    for (size_t i = 0; i < kOtaSha256Size; i++)
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    printf("result=%s mode=file status=%d size=%u received=%zu connect_ms=%u fetch_ms=%u read_ms=%u "
+           "bytes_per_s=%.0f baud=%u at_clean=%d sha256=%s\n",
+           result, status, file.size(), total, connectMs, fetchMs, readMs, readMs ? total * 1000.0 / readMs : 0.0,
+           baud, atClean, hex);
+    return strcmp(result, "ok") == 0 ? 0 : 1;
+}
+
+int usage()
+{
+    fprintf(stderr, "usage: ota_e2e [-t | -f] [-i ms] [-l bps [-n]] [-s script] [directive=value ...] http://host[:port]/path\n");
+    return 2;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Ec200uEmulator emulator;
+    Url url;
+    bool haveUrl = false;
+    const char *urlText = nullptr;
+    bool transparent = false;
+    bool fileMode = false;
+    uint32_t idleMs = 0;
+    uint32_t linkMax = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0)
+        {
+            transparent = true;
+        }
+        else if (strcmp(argv[i], "-f") == 0)
+        {
+            fileMode = true;
+        }
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+        {
+            idleMs = strtoul(argv[++i], nullptr, 0);
+        }
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+        {
+            linkMax = strtoul(argv[++i], nullptr, 0);
+        }
+        else if (strcmp(argv[i], "-n") == 0)
+        {
+            s_rtsCtsWired = false;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            if (!emulator.loadScript(argv[++i]))
+                return 2;
+        }
+        else if (strncmp(argv[i], "http://", 7) == 0)
+        {
+            if (!parse_url(argv[i], url))
+                return usage();
+            urlText = argv[i];
+            haveUrl = true;
+        }
+        else if (!emulator.configure(argv[i]))
+        {
+            fprintf(stderr, "bad directive '%s'\n", argv[i]);
+            return usage();
+        }
+    }
+    if (!haveUrl || (transparent && fileMode))
+        return usage();
+
+    TinyGsm modem(emulator);
+    unsigned appUrcs = 0;
+    const char *const kAppUrcs[] = {"+CEREG:", "+QIURC:", "+CMTI:", "RDY", "APP RDY", "+QIND:"};
+    for (size_t i = 0; i < sizeof(kAppUrcs) / sizeof(kAppUrcs[0]); i++)
+        modem.onURC(kAppUrcs[i], count_urc, &appUrcs);
+
+    // setup()
+    OtaLinkStats link = OtaLinkStats();
+    if (linkMax)
+    {
+        OtaLinkPort port = {&emulator, emulator_set_baud, emulator_set_flow_control, &emulator};
+        OtaLink negotiation(port);
+        if (!negotiation.negotiate(emulator.config().baud, linkMax))
+        {
+            fprintf(stderr, "link negotiation failed\n");
+            return 1;
+        }
+        link = negotiation.stats();
+    }
+    uint32_t start = millis();
+    if (!modem.restart() || !modem.waitForNetwork() || !modem.gprsConnect(kApn))
+    {
+        fprintf(stderr, "modem bring-up failed\n");
+        return 1;
+    }
+    uint32_t connectMs = millis() - start;
+    if (fileMode)
+        return run_file_mode(modem, linkMax ? link.baud : emulator.config().baud, urlText, connectMs);
+
+    // ota_task(), legacy loop
+    // Either registers itself as the modem's socket 0
+    std::unique_ptr<TinyGsmClient> clientPtr(transparent ? new TinyGsmClientTransparent(modem)
+                                                         : new TinyGsmClient(modem));
+    TinyGsmClient &client = *clientPtr;
+    HttpClient http(client, url.host.c_str(), url.port);
+    uint32_t requestStart = millis();
+    if (http.get(url.path.c_str()) != 0)
+    {
+        fprintf(stderr, "connection failed\n");
+        return 1;
+    }
+    int status = http.responseStatusCode();
+    uint32_t ttfbMs = millis() - requestStart;
+    uint32_t sendsSaved = client.txSendsSaved();
+    if (status != 200)
+    {
+        fprintf(stderr, "HTTP GET failed, status %d\n", status);
+        http.stop();
+        return 1;
+    }
+    long size = http.contentLength();
+    if (size <= 0)
+    {
+        fprintf(stderr, "no Content-Length\n");
+        http.stop();
+        return 1;
+    }
+    http.skipResponseHeaders();
+
+    const Ec200uEmulatorStats before = emulator.stats();
+    OtaSha256 sha;
+    sha.begin();
+    uint8_t buffer[1500];
+    size_t total = 0;
+    uint32_t bodyStart = millis();
+    uint32_t lastData = bodyStart;
+    uint32_t wait = 1;
+    while ((http.connected() || http.available()) && total < (size_t)size)
+    {
+        int len = 0;
+        int avail = http.available();
+        if (avail > 0)
+            len = http.read(buffer, std::min(std::min((size_t)avail, sizeof(buffer)), (size_t)size - total));
+        if (len > 0)
+        {
+            sha.update(buffer, len);
+            total += len;
+            lastData = millis();
+            wait = 1;
+            continue;
+        }
+        if (millis() - lastData > kNetworkTimeout)
+            break;
+        // OtaFlowControl's backoff, without the UART event to cut it short
+        delay(wait);
+        wait = std::min(wait * 2, kNetworkDelay);
+    }
+    uint32_t bodyMs = millis() - bodyStart;
+    const Ec200uEmulatorStats body = emulator.stats();
+
+    // An open socket with nothing arriving, polled as the download loop
+    // polls it
+    for (uint32_t idleStart = millis(); millis() - idleStart < idleMs;)
+    {
+        client.available();
+        delay(10);
+    }
+    const Ec200uEmulatorStats idle = emulator.stats();
+    http.stop();
+
+    uint8_t digest[kOtaSha256Size];
+    sha.finish(digest);
+    char hex[2 * kOtaSha256Size + 1];
+    for (size_t i = 0; i < kOtaSha256Size; i++)
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+
+    const Ec200uEmulatorConfig &config = emulator.config();
+    printf("result=%s mode=%s size=%ld received=%zu connect_ms=%u ttfb_ms=%u body_ms=%u bytes_per_s=%.0f "
+           "baud=%u latency_ms=%u bandwidth=%u loss=%g at_commands=%zu uart_in_per_byte=%.3f "
+           "line_busy_down=%.3f line_busy_up=%.3f lost_segments=%zu urcs=%zu lost_urcs=%zu",
+           total == (size_t)size ? "ok" : "incomplete", transparent ? "transparent" : kSocketMode, size, total,
+           connectMs, ttfbMs, bodyMs, bodyMs ? total * 1000.0 / bodyMs : 0.0, config.baud, config.latency_ms,
+           config.bandwidth, config.loss, body.commands - before.commands,
+           total ? (double)(body.uart_to_host - before.uart_to_host) / total : 0.0,
+           line_busy(body.uart_to_host - before.uart_to_host, config.baud, bodyMs),
+           line_busy(body.uart_to_modem - before.uart_to_modem, config.baud, bodyMs),
+           body.lost_segments - before.lost_segments, body.urcs - before.urcs, body.lost_urcs - before.lost_urcs);
+    if (idleMs)
+        printf(" idle_ms=%u idle_at_commands=%zu idle_line_busy_down=%.4f idle_line_busy_up=%.4f", idleMs,
+               idle.commands - body.commands, line_busy(idle.uart_to_host - body.uart_to_host, config.baud, idleMs),
+               line_busy(idle.uart_to_modem - body.uart_to_modem, config.baud, idleMs));
+    if (linkMax)
+        printf(" link_ms=%u link_attempts=%u link_fallbacks=%u link_flow_control=%d corrupted_bytes=%zu",
+               link.elapsed_ms, link.attempts, link.fallbacks, link.flow_control, idle.corrupted);
+    printf(" app_urcs=%u request_sends_saved=%u sha256=%s\n", appUrcs, sendsSaved, hex);
+    return total == (size_t)size ? 0 : 1;
+}
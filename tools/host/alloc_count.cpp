@@ -0,0 +1,64 @@
+#include "alloc_count.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+static std::atomic<size_t> s_allocs(0);
+
+size_t host_alloc_count()
+{
+    return s_allocs.load(std::memory_order_relaxed);
+}
+
+static void *counted_alloc(size_t size)
+{
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size)
+{
+    return counted_alloc(size);
+}
+
+void *operator new[](size_t size)
+{
+    return counted_alloc(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
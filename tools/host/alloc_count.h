@@ -0,0 +1,14 @@
+// Heap allocation counter for host benchmarks. Linking alloc_count.cpp
+// replaces the global operator new/delete with counting versions; String,
+// std::string and the containers all allocate through them, so a path that
+// leaves host_alloc_count() unchanged made no heap allocation.
+
+#ifndef HOST_ALLOC_COUNT_H
+#define HOST_ALLOC_COUNT_H
+
+#include <stddef.h>
+
+// Allocations since start-up
+size_t host_alloc_count();
+
+#endif
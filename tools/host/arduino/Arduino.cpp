@@ -0,0 +1,77 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static Clock::time_point s_start = Clock::now();
+static std::minstd_rand s_random;
+
+HostSerial Serial;
+
+unsigned long millis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - s_start).count();
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - s_start).count();
+}
+
+void delay(unsigned long ms)
+{
+    if (ms == 0)
+    {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+
+long random(long howbig)
+{
+    return howbig > 0 ? (long)(s_random() % (unsigned long)howbig) : 0;
+}
+
+long random(long howsmall, long howbig)
+{
+    return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+    if (seed != 0)
+        s_random.seed(seed);
+}
+
+size_t HostSerial::write(uint8_t c)
+{
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t HostSerial::write(const uint8_t *buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HostSerial::flush()
+{
+    fflush(stdout);
+}
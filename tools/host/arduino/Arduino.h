@@ -0,0 +1,88 @@
+// Minimal Arduino core for building the libraries under lib/ on a Linux
+// host. Only what TinyGSM and ArduinoHttpClient use is provided; the API
+// and the integer/formatting behaviour follow the ESP32 core so code
+// compiles and behaves the same as on the device. Pins, interrupts and
+// peripherals are not emulated.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "Print.h"
+#include "Stream.h"
+#include "WString.h"
+#include "IPAddress.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define memcpy_P memcpy
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+
+using std::max;
+using std::min;
+
+// Time since the first call (process start, in practice)
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+inline bool isDigit(int c) { return isdigit(c) != 0; }
+inline bool isSpace(int c) { return isspace(c) != 0; }
+inline bool isAlpha(int c) { return isalpha(c) != 0; }
+inline bool isAlphaNumeric(int c) { return isalnum(c) != 0; }
+inline bool isHexadecimalDigit(int c) { return isxdigit(c) != 0; }
+
+// Serial console on stdout; reads always come back empty
+class HostSerial : public Stream
+{
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override;
+    operator bool() const { return true; }
+    using Print::write;
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,50 @@
+#include "IPAddress.h"
+
+#include <stdio.h>
+
+#include "Print.h"
+
+bool IPAddress::fromString(const char *address)
+{
+    uint16_t acc = 0;
+    uint8_t dots = 0;
+    bool digits = false;
+
+    while (*address)
+    {
+        char c = *address++;
+        if (c >= '0' && c <= '9')
+        {
+            acc = acc * 10 + (c - '0');
+            digits = true;
+            if (acc > 255)
+                return false;
+        }
+        else if (c == '.' && digits && dots < 3)
+        {
+            _bytes[dots++] = acc;
+            acc = 0;
+            digits = false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    if (dots != 3 || !digits)
+        return false;
+    _bytes[3] = acc;
+    return true;
+}
+
+size_t IPAddress::printTo(Print &p) const
+{
+    return p.print(toString());
+}
+
+String IPAddress::toString() const
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+    return String(buf);
+}
@@ -0,0 +1,50 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Printable.h"
+#include "WString.h"
+
+// IPv4 address, stored in network byte order like the ESP32 core
+class IPAddress : public Printable
+{
+public:
+    IPAddress() { memset(_bytes, 0, sizeof(_bytes)); }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    {
+        _bytes[0] = a;
+        _bytes[1] = b;
+        _bytes[2] = c;
+        _bytes[3] = d;
+    }
+    IPAddress(uint32_t address) { memcpy(_bytes, &address, sizeof(_bytes)); }
+    IPAddress(const uint8_t *address) { memcpy(_bytes, address, sizeof(_bytes)); }
+
+    bool fromString(const char *address);
+    bool fromString(const String &address) { return fromString(address.c_str()); }
+
+    operator uint32_t() const
+    {
+        uint32_t v;
+        memcpy(&v, _bytes, sizeof(v));
+        return v;
+    }
+    bool operator==(const IPAddress &other) const { return memcmp(_bytes, other._bytes, sizeof(_bytes)) == 0; }
+    bool operator!=(const IPAddress &other) const { return !(*this == other); }
+
+    uint8_t operator[](int index) const { return _bytes[index]; }
+    uint8_t &operator[](int index) { return _bytes[index]; }
+
+    size_t printTo(Print &p) const override;
+    String toString() const;
+
+private:
+    friend class Client;
+    uint8_t *raw_address() { return _bytes; }
+
+    uint8_t _bytes[4];
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        if (!write(*buffer++))
+            break;
+        n++;
+    }
+    return n;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char small[64];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (len < 0)
+        return 0;
+    if ((size_t)len < sizeof(small))
+        return write((const uint8_t *)small, len);
+
+    std::vector<char> big(len + 1);
+    va_start(args, format);
+    vsnprintf(big.data(), big.size(), format, args);
+    va_end(args);
+    return write((const uint8_t *)big.data(), len);
+}
+
+size_t Print::print(long n, int base)
+{
+    if (base == DEC && n < 0)
+    {
+        size_t t = print('-');
+        return t + printNumber(-(unsigned long long)n, DEC);
+    }
+    return printNumber((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    return printNumber(n, base);
+}
+
+size_t Print::print(long long n, int base)
+{
+    if (base == DEC && n < 0)
+    {
+        size_t t = print('-');
+        return t + printNumber(-(unsigned long long)n, DEC);
+    }
+    return printNumber((unsigned long long)n, base);
+}
+
+size_t Print::print(unsigned long long n, int base)
+{
+    return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+    char buf[64];
+    int len = snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return len > 0 ? write((const uint8_t *)buf, std::min((size_t)len, sizeof(buf) - 1)) : 0;
+}
+
+size_t Print::printNumber(unsigned long long n, uint8_t base)
+{
+    // Base 0 prints the raw byte, as the Arduino core does
+    if (base == 0)
+        return write((uint8_t)n);
+    if (base < 2)
+        base = 10;
+
+    char buf[8 * sizeof(n) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    do
+    {
+        char c = n % base;
+        n /= base;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+}
@@ -0,0 +1,180 @@
+#include "Stream.h"
+
+#include "Arduino.h"
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+            return c;
+        yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+int Stream::timedPeek()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = peek();
+        if (c >= 0)
+            return c;
+        yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+int Stream::peekNextDigit(bool detectDecimal)
+{
+    for (;;)
+    {
+        int c = timedPeek();
+        if (c < 0 || c == '-' || (c >= '0' && c <= '9') || (detectDecimal && c == '.'))
+            return c;
+        read();
+    }
+}
+
+bool Stream::findUntil(const char *target, size_t targetLen, const char *terminate, size_t termLen)
+{
+    if (targetLen == 0)
+        return true;
+
+    size_t index = 0;
+    size_t termIndex = 0;
+    int c;
+    while ((c = timedRead()) >= 0)
+    {
+        // Simple restart-on-mismatch matching, as in the core
+        if (c == target[index])
+        {
+            if (++index >= targetLen)
+                return true;
+        }
+        else
+        {
+            index = c == target[0] ? 1 : 0;
+        }
+
+        if (termLen > 0)
+        {
+            if (c == terminate[termIndex])
+            {
+                if (++termIndex >= termLen)
+                    return false;
+            }
+            else
+            {
+                termIndex = 0;
+            }
+        }
+    }
+    return false;
+}
+
+long Stream::parseInt()
+{
+    bool negative = false;
+    long value = 0;
+
+    int c = peekNextDigit(false);
+    if (c < 0)
+        return 0;
+    do
+    {
+        if (c == '-')
+            negative = true;
+        else if (c >= '0' && c <= '9')
+            value = value * 10 + c - '0';
+        read();
+        c = timedPeek();
+    } while (c >= '0' && c <= '9');
+
+    return negative ? -value : value;
+}
+
+float Stream::parseFloat()
+{
+    bool negative = false;
+    bool fraction = false;
+    double value = 0;
+    double scale = 1;
+
+    int c = peekNextDigit(true);
+    if (c < 0)
+        return 0;
+    do
+    {
+        if (c == '-')
+            negative = true;
+        else if (c == '.')
+            fraction = true;
+        else if (c >= '0' && c <= '9')
+        {
+            value = value * 10 + c - '0';
+            if (fraction)
+                scale *= 0.1;
+        }
+        read();
+        c = timedPeek();
+    } while ((c >= '0' && c <= '9') || (c == '.' && !fraction));
+
+    value *= scale;
+    return negative ? -value : value;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+            break;
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+    size_t index = 0;
+    while (index < length)
+    {
+        int c = timedRead();
+        if (c < 0 || c == terminator)
+            break;
+        *buffer++ = (char)c;
+        index++;
+    }
+    return index;
+}
+
+String Stream::readString()
+{
+    String ret;
+    int c = timedRead();
+    while (c >= 0)
+    {
+        ret += (char)c;
+        c = timedRead();
+    }
+    return ret;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String ret;
+    int c = timedRead();
+    while (c >= 0 && c != terminator)
+    {
+        ret += (char)c;
+        c = timedRead();
+    }
+    return ret;
+}
@@ -0,0 +1,53 @@
+#ifndef HOST_STREAM_H
+#define HOST_STREAM_H
+
+#include "Print.h"
+
+// Byte stream with the Arduino timed-read helpers. Every helper is built
+// on read()/peek()/available() with the same timeout rules as the core:
+// a read gives up once `_timeout` ms pass without a new byte.
+class Stream : public Print
+{
+public:
+    Stream() : _timeout(1000) {}
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    bool find(const char *target) { return findUntil(target, strlen(target), NULL, 0); }
+    bool find(const char *target, size_t length) { return findUntil(target, length, NULL, 0); }
+    bool find(char target) { return find(&target, 1); }
+    bool findUntil(const char *target, const char *terminator)
+    {
+        return findUntil(target, strlen(target), terminator, terminator ? strlen(terminator) : 0);
+    }
+    bool findUntil(const char *target, size_t targetLen, const char *terminate, size_t termLen);
+
+    long parseInt();
+    float parseFloat();
+
+    virtual size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+    size_t readBytesUntil(char terminator, char *buffer, size_t length);
+    size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length)
+    {
+        return readBytesUntil(terminator, (char *)buffer, length);
+    }
+
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    int timedRead();
+    int timedPeek();
+    // Next char that can start a number (skips everything else)
+    int peekNextDigit(bool detectDecimal);
+
+    unsigned long _timeout;
+};
+
+#endif
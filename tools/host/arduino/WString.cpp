@@ -0,0 +1,174 @@
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+
+static std::string to_base(unsigned long long value, unsigned char base, bool negative)
+{
+    if (base < 2 || base > 36)
+        base = 10;
+    char buf[8 * sizeof(value) + 2];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    do
+    {
+        char c = value % base;
+        value /= base;
+        *--str = c < 10 ? c + '0' : c + 'a' - 10;
+    } while (value);
+    if (negative)
+        *--str = '-';
+    return str;
+}
+
+// Negative numbers only carry a sign in base 10, as with ltoa()
+String::String(unsigned char value, unsigned char base) : _s(to_base(value, base, false)) {}
+String::String(int value, unsigned char base)
+    : _s(base == 10 && value < 0 ? to_base(-(long long)value, 10, true) : to_base((unsigned int)value, base, false)) {}
+String::String(unsigned int value, unsigned char base) : _s(to_base(value, base, false)) {}
+String::String(long value, unsigned char base)
+    : _s(base == 10 && value < 0 ? to_base(-(unsigned long long)value, 10, true) : to_base((unsigned long)value, base, false)) {}
+String::String(unsigned long value, unsigned char base) : _s(to_base(value, base, false)) {}
+String::String(long long value, unsigned char base)
+    : _s(base == 10 && value < 0 ? to_base(-(unsigned long long)value, 10, true) : to_base((unsigned long long)value, base, false)) {}
+String::String(unsigned long long value, unsigned char base) : _s(to_base(value, base, false)) {}
+
+String::String(float value, unsigned int decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+    _s = buf;
+}
+
+bool String::equalsIgnoreCase(const String &s) const
+{
+    return _s.length() == s._s.length() && strcasecmp(_s.c_str(), s._s.c_str()) == 0;
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const
+{
+    return offset + prefix._s.length() <= _s.length() &&
+           _s.compare(offset, prefix._s.length(), prefix._s) == 0;
+}
+
+bool String::endsWith(const char *suffix) const
+{
+    return suffix && endsWith(suffix, strlen(suffix));
+}
+
+bool String::endsWith(const char *suffix, size_t length) const
+{
+    return length <= _s.length() && memcmp(_s.data() + _s.length() - length, suffix, length) == 0;
+}
+
+// Writes past the end go to a dummy, as in the core
+char &String::operator[](unsigned int index)
+{
+    static char dummy;
+    if (index >= _s.length())
+    {
+        dummy = 0;
+        return dummy;
+    }
+    return _s[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
+{
+    if (!bufsize || !buf)
+        return;
+    if (index >= _s.length())
+    {
+        buf[0] = 0;
+        return;
+    }
+    size_t n = std::min((size_t)bufsize - 1, _s.length() - index);
+    memcpy(buf, _s.data() + index, n);
+    buf[n] = 0;
+}
+
+String String::substring(unsigned int left, unsigned int right) const
+{
+    if (left > right)
+        std::swap(left, right);
+    if (left >= _s.length())
+        return String();
+    if (right > _s.length())
+        right = _s.length();
+    String out;
+    out._s = _s.substr(left, right - left);
+    return out;
+}
+
+void String::replace(char find, char replace)
+{
+    for (size_t i = 0; i < _s.length(); i++)
+    {
+        if (_s[i] == find)
+            _s[i] = replace;
+    }
+}
+
+void String::replace(const String &find, const String &replace)
+{
+    if (find._s.empty())
+        return;
+    size_t pos = 0;
+    while ((pos = _s.find(find._s, pos)) != std::string::npos)
+    {
+        _s.replace(pos, find._s.length(), replace._s);
+        pos += replace._s.length();
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index >= _s.length())
+        return;
+    _s.erase(index, count);
+}
+
+void String::toLowerCase()
+{
+    for (size_t i = 0; i < _s.length(); i++)
+        _s[i] = tolower((unsigned char)_s[i]);
+}
+
+void String::toUpperCase()
+{
+    for (size_t i = 0; i < _s.length(); i++)
+        _s[i] = toupper((unsigned char)_s[i]);
+}
+
+void String::trim()
+{
+    size_t begin = 0;
+    size_t end = _s.length();
+    while (begin < end && isspace((unsigned char)_s[begin]))
+        begin++;
+    while (end > begin && isspace((unsigned char)_s[end - 1]))
+        end--;
+    _s = _s.substr(begin, end - begin);
+}
+
+long String::toInt() const
+{
+    return atol(_s.c_str());
+}
+
+float String::toFloat() const
+{
+    return atof(_s.c_str());
+}
+
+double String::toDouble() const
+{
+    return atof(_s.c_str());
+}
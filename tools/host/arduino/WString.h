@@ -0,0 +1,187 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+// Flash strings are ordinary strings on the host
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// Arduino String on top of std::string. Numbers concatenate as decimal
+// text (unsigned char too, as in the core); char appends the character.
+class String
+{
+public:
+    String() {}
+    String(const char *cstr) : _s(cstr ? cstr : "") {}
+    String(const char *cstr, unsigned int length) : _s(cstr ? cstr : "", cstr ? length : 0) {}
+    String(const __FlashStringHelper *str) : String(reinterpret_cast<const char *>(str)) {}
+    String(const String &str) : _s(str._s) {}
+    String(String &&str) : _s(std::move(str._s)) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String &operator=(const String &rhs)
+    {
+        _s = rhs._s;
+        return *this;
+    }
+    String &operator=(String &&rhs)
+    {
+        _s = std::move(rhs._s);
+        return *this;
+    }
+    String &operator=(const char *cstr)
+    {
+        _s = cstr ? cstr : "";
+        return *this;
+    }
+    String &operator=(const __FlashStringHelper *str) { return *this = reinterpret_cast<const char *>(str); }
+
+    bool reserve(unsigned int size)
+    {
+        _s.reserve(size);
+        return true;
+    }
+    unsigned int length() const { return _s.length(); }
+    bool isEmpty() const { return _s.empty(); }
+    void clear() { _s.clear(); }
+    const char *c_str() const { return _s.c_str(); }
+    explicit operator bool() const { return true; }
+
+    bool concat(const String &str)
+    {
+        _s += str._s;
+        return true;
+    }
+    bool concat(const char *cstr)
+    {
+        if (!cstr)
+            return false;
+        _s += cstr;
+        return true;
+    }
+    bool concat(const char *cstr, unsigned int length)
+    {
+        if (!cstr)
+            return false;
+        _s.append(cstr, length);
+        return true;
+    }
+    bool concat(const __FlashStringHelper *str) { return concat(reinterpret_cast<const char *>(str)); }
+    bool concat(char c)
+    {
+        _s += c;
+        return true;
+    }
+    bool concat(unsigned char num) { return concat(String(num)); }
+    bool concat(int num) { return concat(String(num)); }
+    bool concat(unsigned int num) { return concat(String(num)); }
+    bool concat(long num) { return concat(String(num)); }
+    bool concat(unsigned long num) { return concat(String(num)); }
+    bool concat(long long num) { return concat(String(num)); }
+    bool concat(unsigned long long num) { return concat(String(num)); }
+    bool concat(float num) { return concat(String(num)); }
+    bool concat(double num) { return concat(String(num)); }
+
+    template <typename T>
+    String &operator+=(const T &rhs)
+    {
+        concat(rhs);
+        return *this;
+    }
+
+    int compareTo(const String &s) const { return _s.compare(s._s); }
+    bool equals(const String &s) const { return _s == s._s; }
+    bool equals(const char *cstr) const { return _s == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String &s) const;
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+    bool operator>(const String &rhs) const { return compareTo(rhs) > 0; }
+    bool operator<=(const String &rhs) const { return compareTo(rhs) <= 0; }
+    bool operator>=(const String &rhs) const { return compareTo(rhs) >= 0; }
+
+    bool startsWith(const String &prefix) const { return startsWith(prefix, 0); }
+    bool startsWith(const String &prefix, unsigned int offset) const;
+    bool endsWith(const String &suffix) const { return endsWith(suffix._s.data(), suffix._s.length()); }
+    bool endsWith(const char *suffix) const;
+    bool endsWith(const char *suffix, size_t length) const;
+    bool endsWith(const __FlashStringHelper *suffix) const { return endsWith(reinterpret_cast<const char *>(suffix)); }
+
+    char charAt(unsigned int index) const { return index < _s.length() ? _s[index] : 0; }
+    void setCharAt(unsigned int index, char c)
+    {
+        if (index < _s.length())
+            _s[index] = c;
+    }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index);
+    void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const
+    {
+        getBytes((unsigned char *)buf, bufsize, index);
+    }
+
+    int indexOf(char ch) const { return indexOf(ch, 0); }
+    int indexOf(char ch, unsigned int fromIndex) const { return npos(_s.find(ch, fromIndex)); }
+    int indexOf(const String &str) const { return indexOf(str, 0); }
+    int indexOf(const String &str, unsigned int fromIndex) const { return npos(_s.find(str._s, fromIndex)); }
+    int lastIndexOf(char ch) const { return npos(_s.rfind(ch)); }
+    int lastIndexOf(char ch, unsigned int fromIndex) const { return npos(_s.rfind(ch, fromIndex)); }
+    int lastIndexOf(const String &str) const { return npos(_s.rfind(str._s)); }
+    int lastIndexOf(const String &str, unsigned int fromIndex) const { return npos(_s.rfind(str._s, fromIndex)); }
+
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _s.length()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    static int npos(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    std::string _s;
+};
+
+template <typename T>
+String operator+(const String &lhs, const T &rhs)
+{
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+inline String operator+(const char *lhs, const String &rhs)
+{
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+inline bool operator==(const char *lhs, const String &rhs) { return rhs == lhs; }
+inline bool operator!=(const char *lhs, const String &rhs) { return rhs != lhs; }
+
+#endif
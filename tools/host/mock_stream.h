@@ -0,0 +1,181 @@
+// In-memory streams for driving the libraries under lib/ on the host.
+//
+// MockModemStream plays the modem end of the AT serial link: every line
+// the code under test writes is handed to a responder, which queues the
+// modem's reply with feed(). A responder that expects a binary payload
+// after a "> " prompt calls expectRaw() and gets the bytes in one piece.
+//
+// MockClient is a Client whose receive side is a prepared byte string, for
+// feeding canned HTTP/WebSocket traffic to ArduinoHttpClient.
+
+#ifndef HOST_MOCK_STREAM_H
+#define HOST_MOCK_STREAM_H
+
+#include <Client.h>
+
+#include <string.h>
+
+#include <functional>
+#include <string>
+
+class MockModemStream : public Stream
+{
+public:
+    typedef std::function<void(MockModemStream &, const std::string &)> Responder;
+
+    MockModemStream() : writes(0), bytesWritten(0), bytesRead(0), _pos(0), _raw(0), _lf(false) {}
+
+    void onLine(Responder responder) { _onLine = responder; }
+    void onRaw(Responder responder) { _onRaw = responder; }
+    // The next `length` written bytes go to the raw responder as one block
+    // (the '\n' ending the command line is not part of them)
+    void expectRaw(size_t length) { _raw = length; }
+
+    void feed(const void *data, size_t length)
+    {
+        compact();
+        _rx.append((const char *)data, length);
+    }
+    void feed(const std::string &data) { feed(data.data(), data.size()); }
+    void feed(const char *text) { feed(text, strlen(text)); }
+    void reset()
+    {
+        _rx.clear();
+        _pos = 0;
+        _line.clear();
+        _raw = 0;
+        _lf = false;
+    }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        writes++;
+        bytesWritten += size;
+        for (size_t i = 0; i < size; i++)
+        {
+            char c = buffer[i];
+            bool lf = _lf && c == '\n';
+            _lf = false;
+            if (lf)
+                continue;
+            if (_raw)
+            {
+                _line += c;
+                if (--_raw == 0)
+                    dispatch(_onRaw);
+            }
+            else if (c == '\r')
+            {
+                dispatch(_onLine);
+                _lf = true;
+            }
+            else if (c != '\n')
+            {
+                _line += c;
+            }
+        }
+        return size;
+    }
+    using Print::write;
+
+    int available() override { return (int)(_rx.size() - _pos); }
+    int read() override
+    {
+        if (_pos >= _rx.size())
+            return -1;
+        bytesRead++;
+        return (uint8_t)_rx[_pos++];
+    }
+    int peek() override { return _pos < _rx.size() ? (uint8_t)_rx[_pos] : -1; }
+    // Bulk copy like HardwareSerial's; nothing more will arrive, so no wait
+    size_t readBytes(char *buffer, size_t length) override
+    {
+        size_t n = std::min(length, _rx.size() - _pos);
+        memcpy(buffer, _rx.data() + _pos, n);
+        _pos += n;
+        bytesRead += n;
+        return n;
+    }
+    using Stream::readBytes;
+    void flush() override {}
+
+    size_t writes;       // write calls, i.e. UART driver calls on the device
+    size_t bytesWritten;
+    size_t bytesRead;
+
+private:
+    // The line keeps its capacity, so steady traffic allocates nothing
+    void dispatch(const Responder &responder)
+    {
+        if (responder)
+            responder(*this, _line);
+        _line.clear();
+    }
+
+    // Drops consumed input once it dominates the buffer
+    void compact()
+    {
+        if (_pos > 4096 && _pos * 2 > _rx.size())
+        {
+            _rx.erase(0, _pos);
+            _pos = 0;
+        }
+    }
+
+    std::string _rx;
+    size_t _pos;
+    std::string _line;
+    size_t _raw;
+    bool _lf; // a '\n' after the last line's '\r' belongs to the line
+    Responder _onLine;
+    Responder _onRaw;
+};
+
+class MockClient : public Client
+{
+public:
+    MockClient() : _pos(0), _connected(false) {}
+
+    void setResponse(const std::string &data)
+    {
+        _rx = data;
+        _pos = 0;
+    }
+    const std::string &sent() const { return _tx; }
+
+    int connect(IPAddress, uint16_t) override { return _connected = true; }
+    int connect(const char *, uint16_t) override { return _connected = true; }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t size) override
+    {
+        _tx.append((const char *)buf, size);
+        return size;
+    }
+    int available() override { return (int)(_rx.size() - _pos); }
+    int read() override { return _pos < _rx.size() ? (uint8_t)_rx[_pos++] : -1; }
+    int read(uint8_t *buf, size_t size) override
+    {
+        size_t n = std::min(size, _rx.size() - _pos);
+        memcpy(buf, _rx.data() + _pos, n);
+        _pos += n;
+        return (int)n;
+    }
+    int peek() override { return _pos < _rx.size() ? (uint8_t)_rx[_pos] : -1; }
+    void flush() override {}
+    void stop() override
+    {
+        _connected = false;
+        _tx.clear();
+    }
+    uint8_t connected() override { return _connected || _pos < _rx.size(); }
+    operator bool() override { return _connected; }
+
+private:
+    std::string _rx;
+    size_t _pos;
+    std::string _tx;
+    bool _connected;
+};
+
+#endif
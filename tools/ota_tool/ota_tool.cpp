@@ -0,0 +1,720 @@
+// Host-side companion for the OTA code in src/.
+//
+//   ota_tool diff   <old.bin> <new.bin> <out.patch>   create an ODP1 delta patch
+//   ota_tool apply  <old.bin> <in.patch> <out.bin>    rebuild an image from a patch
+//   ota_tool verify <old.bin> <new.bin> <in.patch>    apply and compare with new.bin
+//   ota_tool compress deflate|heatshrink <in.bin> <out.bin> [window lookahead]
+//                                                     write an OTAZ image
+//   ota_tool decompress <in.bin> <out.bin>            expand an OTAZ image
+//   ota_tool manifest <image.bin> <out.manifest> [segment_size]
+//                                                     write an OTA manifest
+//
+// "apply" and "verify" run the same OtaDeltaDecoder the device uses
+// (include/ota_delta.h), fed in small uneven chunks the way the network
+// delivers them, so a patch that verifies here applies on the device.
+// "compress heatshrink" checks its output the same way with the device's
+// OtaHeatshrinkDecoder (include/ota_decompress.h); deflate uses zlib.
+//
+// Build:  g++ -O2 -std=c++11 -I include tools/ota_tool/ota_tool.cpp -lz -o ota_tool
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "ota_decompress.h"
+#include "ota_delta.h"
+#include "ota_digest.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool read_file(const char *path, Bytes &data)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return false;
+    }
+    data.clear();
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool write_file(const char *path, const Bytes &data)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(data.data(), 1, data.size(), f) != data.size())
+    {
+        perror(path);
+        if (f)
+            fclose(f);
+        return false;
+    }
+    return fclose(f) == 0;
+}
+
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    return ota_crc32(0, data, len);
+}
+
+static uint32_t crc32(const Bytes &data)
+{
+    return crc32(data.data(), data.size());
+}
+
+/*
+ * Patch generation: bsdiff's match search over a suffix array of the old
+ * image, re-encoded into the ODP1 record format.
+ */
+
+// Suffix array by prefix doubling with radix sort. Returns n + 1 entries,
+// the first being the empty suffix, as bsdiff's search expects.
+static std::vector<int> suffix_array(const Bytes &s)
+{
+    int n = s.size();
+    std::vector<int> sa(n), rank(n), tmp(n), cnt(std::max(n, 256) + 1);
+    for (int i = 0; i < n; i++)
+    {
+        sa[i] = i;
+        rank[i] = s[i];
+    }
+    // Initial sort by first byte
+    std::fill(cnt.begin(), cnt.end(), 0);
+    for (int i = 0; i < n; i++)
+        cnt[rank[i]]++;
+    for (int i = 1; i < (int)cnt.size(); i++)
+        cnt[i] += cnt[i - 1];
+    for (int i = n - 1; i >= 0; i--)
+        sa[--cnt[rank[i]]] = i;
+
+    int classes = 256;
+    for (int k = 1; k < n; k <<= 1)
+    {
+        // Sort by second key: suffixes without a second half come first
+        int p = 0;
+        for (int i = n - k; i < n; i++)
+            tmp[p++] = i;
+        for (int i = 0; i < n; i++)
+            if (sa[i] >= k)
+                tmp[p++] = sa[i] - k;
+        // Stable counting sort by first key
+        std::fill(cnt.begin(), cnt.begin() + classes + 1, 0);
+        for (int i = 0; i < n; i++)
+            cnt[rank[i]]++;
+        for (int i = 1; i <= classes; i++)
+            cnt[i] += cnt[i - 1];
+        for (int i = n - 1; i >= 0; i--)
+            sa[--cnt[rank[tmp[i]]]] = tmp[i];
+        // Re-rank
+        tmp[sa[0]] = 0;
+        classes = 1;
+        for (int i = 1; i < n; i++)
+        {
+            int a = sa[i - 1], b = sa[i];
+            int a2 = a + k < n ? rank[a + k] : -1;
+            int b2 = b + k < n ? rank[b + k] : -1;
+            if (rank[a] != rank[b] || a2 != b2)
+                classes++;
+            tmp[b] = classes - 1;
+        }
+        rank.swap(tmp);
+        if (classes == n)
+            break;
+    }
+
+    std::vector<int> result(n + 1);
+    result[0] = n;
+    for (int i = 0; i < n; i++)
+        result[i + 1] = sa[i];
+    return result;
+}
+
+static int match_len(const uint8_t *a, int alen, const uint8_t *b, int blen)
+{
+    int i = 0;
+    while (i < alen && i < blen && a[i] == b[i])
+        i++;
+    return i;
+}
+
+// Longest match of `target` in `old` using the suffix array
+static int search(const std::vector<int> &sa, const Bytes &old, const uint8_t *target,
+                  int tlen, int st, int en, int *pos)
+{
+    int oldsize = old.size();
+    while (en - st >= 2)
+    {
+        int x = st + (en - st) / 2;
+        int cmp = memcmp(old.data() + sa[x], target, std::min(oldsize - sa[x], tlen));
+        if (cmp < 0)
+            st = x;
+        else
+            en = x;
+    }
+    int x = match_len(old.data() + sa[st], oldsize - sa[st], target, tlen);
+    int y = match_len(old.data() + sa[en], oldsize - sa[en], target, tlen);
+    if (x > y)
+    {
+        *pos = sa[st];
+        return x;
+    }
+    *pos = sa[en];
+    return y;
+}
+
+static void put_varint(Bytes &out, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(v);
+}
+
+// Add data: alternating zero runs and literal diff bytes
+static void put_add(Bytes &out, const uint8_t *diff, uint32_t len)
+{
+    uint32_t i = 0;
+    while (i < len)
+    {
+        uint32_t zeros = 0;
+        while (i + zeros < len && diff[i + zeros] == 0)
+            zeros++;
+        i += zeros;
+        // A literal run ends at the first stretch of zeros worth a new pair
+        uint32_t lits = 0;
+        while (i + lits < len)
+        {
+            if (diff[i + lits] == 0)
+            {
+                uint32_t z = 0;
+                while (i + lits + z < len && diff[i + lits + z] == 0 && z < 3)
+                    z++;
+                if (z >= 3 || i + lits + z == len)
+                    break;
+            }
+            lits++;
+        }
+        put_varint(out, zeros);
+        put_varint(out, lits);
+        out.insert(out.end(), diff + i, diff + i + lits);
+        i += lits;
+    }
+}
+
+static Bytes make_patch(const Bytes &old, const Bytes &neu)
+{
+    OtaDeltaHeader header = {(uint32_t)old.size(), crc32(old), (uint32_t)neu.size(), crc32(neu)};
+    Bytes out(kOtaDeltaHeaderSize);
+    OtaDeltaDecoder::writeHeader(header, out.data());
+
+    std::vector<int> sa = suffix_array(old);
+    int oldsize = old.size(), newsize = neu.size();
+    int scan = 0, len = 0, pos = 0;
+    int lastscan = 0, lastpos = 0, lastoffset = 0;
+    Bytes diff;
+
+    while (scan < newsize)
+    {
+        int oldscore = 0;
+        int scsc;
+        for (scsc = scan += len; scan < newsize; scan++)
+        {
+            len = search(sa, old, neu.data() + scan, newsize - scan, 0, oldsize, &pos);
+            for (; scsc < scan + len; scsc++)
+                if (scsc + lastoffset < oldsize && old[scsc + lastoffset] == neu[scsc])
+                    oldscore++;
+            if ((len == oldscore && len != 0) || len > oldscore + 8)
+                break;
+            if (scan + lastoffset < oldsize && old[scan + lastoffset] == neu[scan])
+                oldscore--;
+        }
+
+        if (len != oldscore || scan == newsize)
+        {
+            // Extend the previous match forwards...
+            int s = 0, sf = 0, lenf = 0;
+            for (int i = 0; lastscan + i < scan && lastpos + i < oldsize;)
+            {
+                if (old[lastpos + i] == neu[lastscan + i])
+                    s++;
+                i++;
+                if (s * 2 - i > sf * 2 - lenf)
+                {
+                    sf = s;
+                    lenf = i;
+                }
+            }
+            // ...and the new one backwards
+            int lenb = 0;
+            if (scan < newsize)
+            {
+                int sb = 0;
+                s = 0;
+                for (int i = 1; scan >= lastscan + i && pos >= i; i++)
+                {
+                    if (old[pos - i] == neu[scan - i])
+                        s++;
+                    if (s * 2 - i > sb * 2 - lenb)
+                    {
+                        sb = s;
+                        lenb = i;
+                    }
+                }
+            }
+            // Split any overlap where it scores best
+            if (lastscan + lenf > scan - lenb)
+            {
+                int overlap = (lastscan + lenf) - (scan - lenb);
+                int ss = 0, lens = 0;
+                s = 0;
+                for (int i = 0; i < overlap; i++)
+                {
+                    if (neu[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i])
+                        s++;
+                    if (neu[scan - lenb + i] == old[pos - lenb + i])
+                        s--;
+                    if (s > ss)
+                    {
+                        ss = s;
+                        lens = i + 1;
+                    }
+                }
+                lenf += lens - overlap;
+                lenb -= lens;
+            }
+
+            int extra = (scan - lenb) - (lastscan + lenf);
+            int seek = (pos - lenb) - (lastpos + lenf);
+            put_varint(out, lenf);
+            put_varint(out, extra);
+            put_varint(out, ((uint32_t)seek << 1) ^ (uint32_t)(seek >> 31));
+
+            diff.resize(lenf);
+            for (int i = 0; i < lenf; i++)
+                diff[i] = neu[lastscan + i] - old[lastpos + i];
+            put_add(out, diff.data(), lenf);
+            out.insert(out.end(), neu.begin() + lastscan + lenf, neu.begin() + scan - lenb);
+
+            lastscan = scan - lenb;
+            lastpos = pos - lenb;
+            lastoffset = pos - scan;
+        }
+    }
+    return out;
+}
+
+/*
+ * Patch application through the device decoder
+ */
+
+static bool read_old(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+    const Bytes &old = *static_cast<const Bytes *>(ctx);
+    if (offset + len > old.size())
+        return false;
+    memcpy(buf, old.data() + offset, len);
+    return true;
+}
+
+static bool append(void *ctx, const uint8_t *data, size_t len)
+{
+    Bytes &out = *static_cast<Bytes *>(ctx);
+    out.insert(out.end(), data, data + len);
+    return true;
+}
+
+static bool apply_patch(const Bytes &old, const Bytes &patch, Bytes &out)
+{
+    OtaDeltaHeader header;
+    if (patch.size() < kOtaDeltaHeaderSize || !OtaDeltaDecoder::parseHeader(patch.data(), header))
+    {
+        fprintf(stderr, "not an ODP1 patch\n");
+        return false;
+    }
+    if (header.old_size != old.size() || header.old_crc != crc32(old))
+    {
+        fprintf(stderr, "patch was made for a different old image\n");
+        return false;
+    }
+
+    static OtaDeltaDecoder decoder;
+    OtaSink sink = {append, &out};
+    out.clear();
+    decoder.begin(header, read_old, (void *)&old, sink);
+
+    // Uneven chunks, like reads from the modem
+    static const size_t kChunks[] = {1, 7, 512, 1460, 3, 4096};
+    size_t pos = kOtaDeltaHeaderSize;
+    OtaDeltaDecoder::Result result = header.new_size ? OtaDeltaDecoder::kMoreData : OtaDeltaDecoder::kComplete;
+    for (int i = 0; pos < patch.size(); i++)
+    {
+        size_t n = std::min(kChunks[i % 6], patch.size() - pos);
+        result = decoder.feed(patch.data() + pos, n);
+        pos += n;
+        if (result != OtaDeltaDecoder::kMoreData)
+            break;
+    }
+    if (result != OtaDeltaDecoder::kComplete || pos != patch.size())
+    {
+        fprintf(stderr, "patch decode failed (result %d at byte %zu)\n", result, pos);
+        return false;
+    }
+    if (crc32(out) != header.new_crc)
+    {
+        fprintf(stderr, "rebuilt image CRC mismatch\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Compressed images
+ */
+
+// Heatshrink encoder: greedy longest match through hash chains on the
+// next two bytes. A back-reference costs 1 + window + lookahead bits
+// against 9 bits per literal, so short matches are not worth taking.
+class BitWriter
+{
+public:
+    explicit BitWriter(Bytes &out) : iOut(out), iBits(0), iCount(0) {}
+
+    void put(uint32_t value, int bits)
+    {
+        while (bits-- > 0)
+        {
+            iBits = (iBits << 1) | ((value >> bits) & 1);
+            if (++iCount == 8)
+            {
+                iOut.push_back(iBits);
+                iBits = 0;
+                iCount = 0;
+            }
+        }
+    }
+
+    void finish()
+    {
+        if (iCount)
+            iOut.push_back(iBits << (8 - iCount));
+    }
+
+private:
+    Bytes &iOut;
+    uint8_t iBits;
+    int iCount;
+};
+
+static void heatshrink_encode(const Bytes &in, int window, int lookahead, Bytes &out)
+{
+    const int kMaxChain = 256;
+    const size_t max_dist = (size_t)1 << window;
+    const size_t max_len = (size_t)1 << lookahead;
+    const size_t min_len = (1 + window + lookahead) / 9 + 1;
+
+    std::vector<int> head(65536, -1), prev(in.size(), -1);
+    BitWriter bits(out);
+    size_t i = 0;
+    while (i < in.size())
+    {
+        size_t best_len = 0, best_dist = 0;
+        if (i + 1 < in.size())
+        {
+            int key = in[i] << 8 | in[i + 1];
+            int chain = 0;
+            for (int j = head[key]; j >= 0 && i - j <= max_dist && chain < kMaxChain; j = prev[j], chain++)
+            {
+                size_t len = 0;
+                while (len < max_len && i + len < in.size() && in[j + len] == in[i + len])
+                    len++;
+                if (len > best_len)
+                {
+                    best_len = len;
+                    best_dist = i - j;
+                    if (len == max_len)
+                        break;
+                }
+            }
+        }
+
+        size_t step = best_len >= min_len ? best_len : 1;
+        if (step == 1)
+        {
+            bits.put(1, 1);
+            bits.put(in[i], 8);
+        }
+        else
+        {
+            bits.put(0, 1);
+            bits.put(best_dist - 1, window);
+            bits.put(best_len - 1, lookahead);
+        }
+        for (size_t k = 0; k < step; k++, i++)
+        {
+            if (i + 1 < in.size())
+            {
+                int key = in[i] << 8 | in[i + 1];
+                prev[i] = head[key];
+                head[key] = i;
+            }
+        }
+    }
+    bits.finish();
+}
+
+static bool heatshrink_decode(const uint8_t *data, size_t len, const OtaCompressedHeader &header, Bytes &out)
+{
+    static OtaHeatshrinkDecoder decoder;
+    OtaSink sink = {append, &out};
+    out.clear();
+    if (!decoder.begin(header.window_bits, header.lookahead_bits, sink))
+        return false;
+    // Uneven chunks, like pipeline buffers of varying fill
+    static const size_t kChunks[] = {1, 4096, 3, 1460, 512};
+    for (size_t pos = 0, i = 0; pos < len; i++)
+    {
+        size_t n = std::min(kChunks[i % 5], len - pos);
+        if (!decoder.feed(data + pos, n))
+            return false;
+        pos += n;
+    }
+    return decoder.finish() && out.size() == header.size;
+}
+
+static bool compressed_decode(const Bytes &in, Bytes &out)
+{
+    OtaCompressedHeader header;
+    if (in.size() < kOtaCompressedHeaderSize || !ota_parse_compressed_header(in.data(), header))
+    {
+        fprintf(stderr, "not an OTAZ image\n");
+        return false;
+    }
+    const uint8_t *body = in.data() + kOtaCompressedHeaderSize;
+    size_t body_len = in.size() - kOtaCompressedHeaderSize;
+    if (header.format == OTA_COMPRESSION_HEATSHRINK)
+    {
+        if (!heatshrink_decode(body, body_len, header, out))
+        {
+            fprintf(stderr, "heatshrink decode failed\n");
+            return false;
+        }
+        return true;
+    }
+    out.resize(header.size);
+    uLongf out_len = out.size();
+    if (uncompress(out.data(), &out_len, body, body_len) != Z_OK || out_len != header.size)
+    {
+        fprintf(stderr, "inflate failed\n");
+        return false;
+    }
+    return true;
+}
+
+static bool compress_image(const std::string &format, const Bytes &in, int window, int lookahead, Bytes &out)
+{
+    OtaCompressedHeader header = {0, 0, 0, (uint32_t)in.size()};
+    out.assign(kOtaCompressedHeaderSize, 0);
+    if (format == "heatshrink")
+    {
+        if (window < 4 || window > OTA_HEATSHRINK_MAX_WINDOW_BITS || lookahead < 3 || lookahead >= window)
+        {
+            fprintf(stderr, "window must be 4..%d and lookahead 3..window-1\n", OTA_HEATSHRINK_MAX_WINDOW_BITS);
+            return false;
+        }
+        header.format = OTA_COMPRESSION_HEATSHRINK;
+        header.window_bits = window;
+        header.lookahead_bits = lookahead;
+        heatshrink_encode(in, window, lookahead, out);
+    }
+    else if (format == "deflate")
+    {
+        header.format = OTA_COMPRESSION_DEFLATE;
+        uLongf len = compressBound(in.size());
+        out.resize(kOtaCompressedHeaderSize + len);
+        if (compress2(out.data() + kOtaCompressedHeaderSize, &len, in.data(), in.size(), 9) != Z_OK)
+        {
+            fprintf(stderr, "deflate failed\n");
+            return false;
+        }
+        out.resize(kOtaCompressedHeaderSize + len);
+    }
+    else
+    {
+        fprintf(stderr, "unknown format %s\n", format.c_str());
+        return false;
+    }
+    ota_write_compressed_header(header, out.data());
+
+    // Round trip before anything is published
+    Bytes check;
+    if (!compressed_decode(out, check) || check != in)
+    {
+        fprintf(stderr, "compressed image does not decode back to the input\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Manifests
+ */
+
+static std::string hex(const uint8_t *data, size_t len)
+{
+    std::string out;
+    char buf[3];
+    for (size_t i = 0; i < len; i++)
+    {
+        snprintf(buf, sizeof(buf), "%02x", data[i]);
+        out += buf;
+    }
+    return out;
+}
+
+// The default segment size matches OTA_PARALLEL_SEGMENT_SIZE
+static bool write_manifest(const char *path, const Bytes &image, uint32_t segment, OtaManifest &parsed)
+{
+    if (segment == 0 || segment % 4096 || (image.size() + segment - 1) / segment > OTA_MANIFEST_MAX_SEGMENTS)
+    {
+        fprintf(stderr, "segment size must be a multiple of 4096 giving at most %d segments\n",
+                OTA_MANIFEST_MAX_SEGMENTS);
+        return false;
+    }
+    OtaSha256 sha;
+    uint8_t digest[kOtaSha256Size];
+    sha.begin();
+    sha.update(image.data(), image.size());
+    sha.finish(digest);
+
+    std::string text = "OTA-MANIFEST 1\n";
+    text += "size " + std::to_string(image.size()) + "\n";
+    text += "sha256 " + hex(digest, sizeof(digest)) + "\n";
+    text += "segment " + std::to_string(segment) + "\n";
+    for (size_t pos = 0; pos < image.size(); pos += segment)
+    {
+        char line[32];
+        snprintf(line, sizeof(line), "crc32 %08x\n", crc32(image.data() + pos, std::min<size_t>(segment, image.size() - pos)));
+        text += line;
+    }
+
+    // Parse it back the way the device will
+    memset(&parsed, 0, sizeof(parsed));
+    size_t start = 0, end;
+    while ((end = text.find('\n', start)) != std::string::npos)
+    {
+        if (!ota_manifest_parse_line(parsed, text.substr(start, end - start).c_str()))
+            return false;
+        start = end + 1;
+    }
+    if (parsed.size != image.size() || !parsed.has_sha256 || memcmp(parsed.sha256, digest, sizeof(digest)) ||
+        !ota_manifest_has_segments(parsed, segment))
+    {
+        fprintf(stderr, "manifest does not parse back\n");
+        return false;
+    }
+    return write_file(path, Bytes(text.begin(), text.end()));
+}
+
+static int usage()
+{
+    fprintf(stderr,
+            "usage: ota_tool diff   <old.bin> <new.bin> <out.patch>\n"
+            "       ota_tool apply  <old.bin> <in.patch> <out.bin>\n"
+            "       ota_tool verify <old.bin> <new.bin> <in.patch>\n"
+            "       ota_tool compress deflate|heatshrink <in.bin> <out.bin> [window lookahead]\n"
+            "       ota_tool decompress <in.bin> <out.bin>\n"
+            "       ota_tool manifest <image.bin> <out.manifest> [segment_size]\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+        return usage();
+    std::string cmd = argv[1];
+
+    if (cmd == "diff" && argc == 5)
+    {
+        Bytes old, neu, patch;
+        if (!read_file(argv[2], old) || !read_file(argv[3], neu))
+            return 1;
+        patch = make_patch(old, neu);
+        if (!write_file(argv[4], patch))
+            return 1;
+        printf("%zu -> %zu bytes, patch %zu bytes (%.1f%%)\n", old.size(), neu.size(),
+               patch.size(), neu.empty() ? 0.0 : 100.0 * patch.size() / neu.size());
+        return 0;
+    }
+    if (cmd == "apply" && argc == 5)
+    {
+        Bytes old, patch, out;
+        if (!read_file(argv[2], old) || !read_file(argv[3], patch))
+            return 1;
+        if (!apply_patch(old, patch, out) || !write_file(argv[4], out))
+            return 1;
+        printf("rebuilt %zu bytes\n", out.size());
+        return 0;
+    }
+    if (cmd == "verify" && argc == 5)
+    {
+        Bytes old, neu, patch, out;
+        if (!read_file(argv[2], old) || !read_file(argv[3], neu) || !read_file(argv[4], patch))
+            return 1;
+        if (!apply_patch(old, patch, out))
+            return 1;
+        if (out != neu)
+        {
+            fprintf(stderr, "rebuilt image differs from %s\n", argv[3]);
+            return 1;
+        }
+        printf("patch OK: %zu bytes rebuilt\n", out.size());
+        return 0;
+    }
+    if (cmd == "compress" && (argc == 5 || argc == 7))
+    {
+        Bytes in, out;
+        int window = argc == 7 ? atoi(argv[5]) : OTA_HEATSHRINK_MAX_WINDOW_BITS;
+        int lookahead = argc == 7 ? atoi(argv[6]) : 5;
+        if (!read_file(argv[3], in) || !compress_image(argv[2], in, window, lookahead, out) ||
+            !write_file(argv[4], out))
+            return 1;
+        printf("%zu -> %zu bytes (%.1f%%)\n", in.size(), out.size(),
+               in.empty() ? 0.0 : 100.0 * out.size() / in.size());
+        return 0;
+    }
+    if (cmd == "decompress" && argc == 4)
+    {
+        Bytes in, out;
+        if (!read_file(argv[2], in) || !compressed_decode(in, out) || !write_file(argv[3], out))
+            return 1;
+        printf("expanded %zu bytes\n", out.size());
+        return 0;
+    }
+    if (cmd == "manifest" && (argc == 4 || argc == 5))
+    {
+        Bytes image;
+        OtaManifest manifest;
+        uint32_t segment = argc == 5 ? strtoul(argv[4], nullptr, 0) : 64 * 1024;
+        if (!read_file(argv[2], image) || !write_manifest(argv[3], image, segment, manifest))
+            return 1;
+        printf("%u segments; serve the image with\nX-Firmware-SHA256: %s\n", manifest.segments,
+               hex(manifest.sha256, kOtaSha256Size).c_str());
+        return 0;
+    }
+    return usage();
+}
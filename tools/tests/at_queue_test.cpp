@@ -0,0 +1,212 @@
+// TinyGsmAtQueue against a scripted modem: queries batched on one line,
+// a batch that fails part way, URCs passed to the modem's handlers while
+// commands are in flight, timeouts, and callbacks that queue more.
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target at_queue_test
+// Run:    ctest --test-dir build/tools -R at_queue
+
+#define TINY_GSM_MODEM_EC200U
+#define TINY_GSM_RX_BUFFER 1024
+
+#include <TinyGsmClient.h>
+#include <TinyGsmAtQueue.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../host/mock_stream.h"
+#include "check.h"
+
+// Answers each command line from a script; a line not in it gets no reply
+struct ScriptedModem
+{
+    ScriptedModem() : modem(stream)
+    {
+        stream.onLine([this](MockModemStream &s, const std::string &line) {
+            sent.push_back(line);
+            std::map<std::string, std::string>::const_iterator reply = replies.find(line);
+            if (reply != replies.end())
+                s.feed(reply->second);
+        });
+    }
+
+    MockModemStream stream;
+    TinyGsm modem;
+    std::map<std::string, std::string> replies;
+    std::vector<std::string> sent;
+};
+
+static void test_batch()
+{
+    ScriptedModem m;
+    m.replies["AT+CSQ;+CEREG?;+QENG=\"servingcell\""] =
+        "\r\n+CSQ: 20,99\r\n\r\n+CEREG: 0,1\r\n\r\n+QENG: \"servingcell\",\"NOCONN\"\r\n\r\nOK\r\n";
+    TinyGsmAtQueue<TinyGsm> queue(m.modem);
+    TinyGsmAtCommand csq("+CSQ", "+CSQ:", 1000, true);
+    TinyGsmAtCommand cereg("+CEREG?", "+CEREG:", 1000, true);
+    TinyGsmAtCommand qeng("+QENG=\"servingcell\"", "+QENG:", 1000, true);
+    CHECK(queue.submit(csq));
+    CHECK(queue.submit(cereg));
+    CHECK(queue.submit(qeng));
+    CHECK(!queue.submit(csq)); // already queued
+
+    CHECK(queue.wait(qeng) == AT_CMD_OK);
+    CHECK(csq.ok() && cereg.ok());
+    CHECK_STR(csq.response(), "+CSQ: 20,99");
+    CHECK_STR(cereg.response(), "+CEREG: 0,1");
+    CHECK_STR(qeng.response(), "+QENG: \"servingcell\",\"NOCONN\"");
+    CHECK(queue.linesSent() == 1);
+    CHECK(queue.commandsDone() == 3);
+    CHECK(queue.idle());
+}
+
+// Without batching, and for commands that are not queries, one per line
+static void test_no_batch()
+{
+    ScriptedModem m;
+    m.replies["AT+CSQ"] = "\r\n+CSQ: 20,99\r\n\r\nOK\r\n";
+    m.replies["AT+QIACT=1"] = "\r\nOK\r\n";
+    m.replies["AT+CEREG?"] = "\r\n+CEREG: 0,1\r\n\r\nOK\r\n";
+    TinyGsmAtQueue<TinyGsm> queue(m.modem);
+    TinyGsmAtCommand csq("+CSQ", "+CSQ:", 1000, true);
+    TinyGsmAtCommand qiact("+QIACT=1", nullptr, 1000);
+    TinyGsmAtCommand cereg("+CEREG?", "+CEREG:", 1000, true);
+    queue.submit(csq);
+    queue.submit(qiact);
+    queue.submit(cereg);
+    CHECK(queue.wait(cereg) == AT_CMD_OK);
+    CHECK(csq.ok() && qiact.ok());
+    CHECK(m.sent.size() == 3);
+
+    ScriptedModem single;
+    single.replies = m.replies;
+    TinyGsmAtQueue<TinyGsm> unbatched(single.modem, false);
+    unbatched.submit(csq);
+    unbatched.submit(cereg);
+    CHECK(unbatched.wait(cereg) == AT_CMD_OK);
+    CHECK(unbatched.linesSent() == 2);
+}
+
+// The command that failed gets the error, those before it their answers,
+// and those after it, which never ran, go out again on lines of their own
+static void test_batch_error()
+{
+    ScriptedModem m;
+    m.replies["AT+CSQ;+CEREG?;+CGATT?"] = "\r\n+CSQ: 20,99\r\n\r\n+CME ERROR: 30\r\n";
+    m.replies["AT+CGATT?"] = "\r\n+CGATT: 1\r\n\r\nOK\r\n";
+    TinyGsmAtQueue<TinyGsm> queue(m.modem);
+    TinyGsmAtCommand csq("+CSQ", "+CSQ:", 1000, true);
+    TinyGsmAtCommand cereg("+CEREG?", "+CEREG:", 1000, true);
+    TinyGsmAtCommand cgatt("+CGATT?", "+CGATT:", 1000, true);
+    queue.submit(csq);
+    queue.submit(cereg);
+    queue.submit(cgatt);
+    CHECK(queue.wait(cgatt) == AT_CMD_OK);
+    CHECK(csq.ok());
+    CHECK(cereg.status() == AT_CMD_ERROR);
+    CHECK_STR(cereg.response(), "+CME ERROR: 30");
+    CHECK_STR(cgatt.response(), "+CGATT: 1");
+    CHECK(m.sent.size() == 2 && m.sent[1] == "AT+CGATT?");
+}
+
+static int s_urcs;
+
+static bool count_urc(void *ctx, TinyGsmUrcFields &fields)
+{
+    (void)ctx;
+    const char *storage = fields.next();
+    if (storage && strcmp(storage, "SM") == 0 && fields.nextInt() == 3)
+        s_urcs++;
+    return true;
+}
+
+// A URC in the middle of a reply is the modem's, not the command's
+static void test_urc()
+{
+    ScriptedModem m;
+    m.replies["AT+CSQ"] = "\r\n+CMTI: \"SM\",3\r\n\r\n+CSQ: 20,99\r\n\r\nOK\r\n";
+    m.replies["AT+QIACT?"] = "\r\n+QIACT: 1,1,1,\"10.0.0.2\"\r\n\r\n+CMTI: \"SM\",3\r\n\r\nOK\r\n";
+    CHECK(m.modem.onURC("+CMTI:", count_urc));
+    TinyGsmAtQueue<TinyGsm> queue(m.modem);
+    TinyGsmAtCommand csq("+CSQ", "+CSQ:", 1000, true);
+    CHECK(queue.wait(csq) == AT_CMD_IDLE); // not submitted
+    queue.submit(csq);
+    CHECK(queue.wait(csq) == AT_CMD_OK);
+    CHECK_STR(csq.response(), "+CSQ: 20,99");
+
+    // Without a prefix the command takes every line the handlers leave
+    TinyGsmAtCommand qiact("+QIACT?");
+    queue.submit(qiact);
+    CHECK(queue.wait(qiact) == AT_CMD_OK);
+    CHECK_STR(qiact.response(), "+QIACT: 1,1,1,\"10.0.0.2\"");
+    CHECK(s_urcs == 2);
+}
+
+static void test_timeout()
+{
+    ScriptedModem m;
+    m.replies["AT+CSQ"] = "\r\n+CSQ: 20,99\r\n\r\nOK\r\n";
+    TinyGsmAtQueue<TinyGsm> queue(m.modem);
+    TinyGsmAtCommand silent("+QPING=1,\"10.0.0.1\"", nullptr, 20);
+    TinyGsmAtCommand csq("+CSQ", "+CSQ:", 1000, true);
+    queue.submit(silent);
+    queue.submit(csq);
+    unsigned long start = millis();
+    CHECK(queue.wait(silent) == AT_CMD_TIMEOUT);
+    CHECK(millis() - start >= 20);
+    // The queue moves on to the next command
+    CHECK(queue.wait(csq) == AT_CMD_OK);
+}
+
+// A queue of one: the command a callback submits only fits because the
+// one that finished is already off the queue
+typedef TinyGsmAtQueue<TinyGsm, 1> SmallQueue;
+
+struct Chain
+{
+    SmallQueue *queue;
+    TinyGsmAtCommand *next;
+    int calls;
+};
+
+static void on_done(void *ctx, TinyGsmAtCommand &command)
+{
+    Chain *chain = static_cast<Chain *>(ctx);
+    chain->calls++;
+    if (command.ok() && chain->next)
+    {
+        TinyGsmAtCommand *next = chain->next;
+        chain->next = nullptr;
+        CHECK(chain->queue->submit(*next, on_done, chain));
+    }
+}
+
+static void test_callback()
+{
+    ScriptedModem m;
+    m.replies["AT+QIACT=1"] = "\r\nOK\r\n";
+    m.replies["AT+QIACT?"] = "\r\n+QIACT: 1,1,1,\"10.0.0.2\"\r\n\r\nOK\r\n";
+    SmallQueue queue(m.modem);
+    TinyGsmAtCommand qiact("+QIACT=1", nullptr, 1000);
+    TinyGsmAtCommand query("+QIACT?", "+QIACT:", 1000, true);
+    Chain chain = {&queue, &query, 0};
+    CHECK(queue.submit(qiact, on_done, &chain));
+    CHECK(!queue.submit(query)); // full
+    CHECK(queue.wait(qiact) == AT_CMD_OK);
+    CHECK(chain.calls == 1);
+    CHECK(query.status() == AT_CMD_QUEUED || query.status() == AT_CMD_SENT);
+    CHECK(queue.wait(query) == AT_CMD_OK);
+    CHECK(chain.calls == 2);
+}
+
+int main()
+{
+    test_batch();
+    test_no_batch();
+    test_batch_error();
+    test_urc();
+    test_timeout();
+    test_callback();
+    return check_result("at_queue_test");
+}
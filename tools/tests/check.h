@@ -0,0 +1,46 @@
+// Assertions for the host tests. CHECK() reports a failing expression with
+// its file and line and carries on, so one run lists every failure; a
+// test's main() returns check_result(), which is non-zero after any.
+
+#ifndef HOST_TESTS_CHECK_H
+#define HOST_TESTS_CHECK_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int s_checks;
+static int s_failures;
+
+#define CHECK(expr)                                                       \
+    do                                                                    \
+    {                                                                     \
+        s_checks++;                                                       \
+        if (!(expr))                                                      \
+        {                                                                 \
+            s_failures++;                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+        }                                                                 \
+    } while (0)
+
+// Two C strings, printed both when they differ
+#define CHECK_STR(actual, expected)                                                          \
+    do                                                                                       \
+    {                                                                                        \
+        s_checks++;                                                                          \
+        const char *a_ = (actual);                                                           \
+        const char *e_ = (expected);                                                         \
+        if (!a_ || strcmp(a_, e_) != 0)                                                      \
+        {                                                                                    \
+            s_failures++;                                                                    \
+            fprintf(stderr, "%s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, \
+                    a_ ? a_ : "(null)", e_);                                                 \
+        }                                                                                    \
+    } while (0)
+
+static inline int check_result(const char *name)
+{
+    printf("%s: %d checks, %d failed\n", name, s_checks, s_failures);
+    return s_failures ? 1 : 0;
+}
+
+#endif
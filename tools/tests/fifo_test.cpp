@@ -0,0 +1,150 @@
+// TinyGsmFifo and TinyGsmSpscFifo: fill levels, wrap-around, the span
+// API, and both index paths (power-of-two mask and conditional subtract).
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target fifo_test
+// Run:    ctest --test-dir build/tools -R fifo
+
+#include <TinyGsmFifo.h>
+
+#include <thread>
+
+#include "check.h"
+
+template <class Fifo, unsigned N>
+static void test_levels(Fifo &fifo)
+{
+    // One slot always stays empty to tell full from empty
+    CHECK(!fifo.readable());
+    CHECK(fifo.size() == 0);
+    CHECK(fifo.free() == (int)N - 1);
+    for (unsigned i = 0; i < N - 1; i++)
+        CHECK(fifo.put((uint8_t)i));
+    CHECK(!fifo.writeable());
+    CHECK(!fifo.put(0xFF));
+    CHECK(fifo.size() == N - 1);
+    CHECK(fifo.peek() == 0);
+
+    uint8_t c = 0xFF;
+    CHECK(fifo.get(&c) && c == 0);
+    CHECK(fifo.free() == 1);
+    fifo.clear();
+    CHECK(fifo.size() == 0);
+    CHECK(!fifo.get(&c));
+}
+
+// Blocks that do not divide N walk the indices over the end many times
+template <class Fifo, unsigned N>
+static void test_wrap(Fifo &fifo)
+{
+    uint8_t in[N];
+    uint8_t out[N];
+    // One byte stays behind, so reads lag writes across the end too
+    CHECK(fifo.put((uint8_t)0));
+    uint32_t next_in = 1;
+    uint32_t next_out = 0;
+    bool ordered = true;
+    for (int round = 0; round < 50; round++)
+    {
+        int n = (int)(N / 3 + round % 7);
+        for (int i = 0; i < n; i++)
+            in[i] = (uint8_t)(next_in + i);
+        CHECK(fifo.put(in, n) == n);
+        next_in += n;
+        int got = fifo.get(out, n);
+        CHECK(got == n);
+        for (int i = 0; i < got; i++)
+            ordered = ordered && out[i] == (uint8_t)(next_out + i);
+        next_out += got;
+    }
+    CHECK(ordered);
+    CHECK(fifo.size() == next_in - next_out);
+
+    // A put larger than the room left stops at the room left
+    int room = fifo.free();
+    CHECK(fifo.put(in, N) == room);
+    CHECK(fifo.free() == 0);
+    fifo.clear();
+}
+
+// writeSpan()/commitWrite() and readSpan()/commitRead() across the end
+template <class Fifo, unsigned N>
+static void test_spans(Fifo &fifo)
+{
+    uint8_t scratch[N];
+    memset(scratch, 0, sizeof(scratch));
+    // Move both indices to 3 before the end
+    CHECK(fifo.put(scratch, N - 3) == (int)N - 3);
+    CHECK(fifo.get(scratch, N - 3) == (int)N - 3);
+
+    TinyGsmFifoSpan<uint8_t> w = fifo.writeSpan();
+    CHECK(w.size() == (int)N - 1);
+    CHECK(w.firstSize == 3);
+    CHECK(w.secondSize == (int)N - 4);
+    for (int i = 0; i < 3; i++)
+        w.first[i] = (uint8_t)(100 + i);
+    for (int i = 0; i < 5; i++)
+        w.second[i] = (uint8_t)(103 + i);
+    fifo.commitWrite(8);
+    CHECK(fifo.size() == 8);
+
+    TinyGsmFifoSpan<uint8_t> r = fifo.readSpan();
+    CHECK(r.firstSize == 3);
+    CHECK(r.secondSize == 5);
+    CHECK(r.first[0] == 100 && r.first[2] == 102);
+    CHECK(r.second[0] == 103 && r.second[4] == 107);
+    fifo.commitRead(4);
+    CHECK(fifo.size() == 4);
+    CHECK(fifo.peek() == 104);
+
+    uint8_t rest[4];
+    CHECK(fifo.get(rest, 4) == 4);
+    CHECK(rest[0] == 104 && rest[3] == 107);
+    fifo.clear();
+}
+
+template <class Fifo, unsigned N>
+static void test_fifo()
+{
+    static Fifo fifo;
+    test_levels<Fifo, N>(fifo);
+    test_wrap<Fifo, N>(fifo);
+    test_spans<Fifo, N>(fifo);
+}
+
+// A producer thread byte by byte, the consumer in blocks: nothing lost,
+// nothing reordered
+static void test_spsc_threads()
+{
+    static TinyGsmSpscFifo<uint8_t, 100> fifo;
+    const size_t kBytes = 1 << 20;
+    std::thread producer([&]() {
+        for (size_t i = 0; i < kBytes; i++)
+            while (!fifo.put((uint8_t)(i * 7)))
+                std::this_thread::yield();
+    });
+    uint8_t chunk[64];
+    size_t got = 0;
+    bool ordered = true;
+    while (got < kBytes)
+    {
+        int n = fifo.get(chunk, sizeof(chunk));
+        if (!n)
+            std::this_thread::yield();
+        for (int i = 0; i < n; i++)
+            ordered = ordered && chunk[i] == (uint8_t)((got + i) * 7);
+        got += n;
+    }
+    producer.join();
+    CHECK(got == kBytes);
+    CHECK(ordered);
+}
+
+int main()
+{
+    test_fifo<TinyGsmFifo<uint8_t, 64>, 64>();
+    test_fifo<TinyGsmFifo<uint8_t, 100>, 100>();
+    test_fifo<TinyGsmSpscFifo<uint8_t, 64>, 64>();
+    test_fifo<TinyGsmSpscFifo<uint8_t, 100>, 100>();
+    test_spsc_threads();
+    return check_result("fifo_test");
+}
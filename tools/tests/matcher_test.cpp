@@ -0,0 +1,122 @@
+// TinyGsmMatcher against the strings waitResponse() hands it: slots in
+// the order added, overlapping input, null and empty strings, strings cut
+// to TINY_GSM_MATCH_MAX, and reset().
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target matcher_test
+// Run:    ctest --test-dir build/tools -R matcher
+
+#include <TinyGsmMatcher.h>
+
+#include <string>
+
+#include "check.h"
+
+// Feeds `input`; the slot found on its last byte, and how many bytes matched
+template <uint8_t N>
+static uint8_t feed(TinyGsmMatcher<N> &matcher, const char *input, int *hits = nullptr)
+{
+    uint8_t found = 0;
+    int n = 0;
+    for (const char *p = input; *p; p++)
+    {
+        found = matcher.feed(*p);
+        if (found)
+            n++;
+    }
+    if (hits)
+        *hits = n;
+    return found;
+}
+
+static void test_slots()
+{
+    TinyGsmMatcher<5> m;
+    m.add(GFP("OK\r\n"));
+    m.add(GFP("ERROR\r\n"));
+    m.add(nullptr);
+    m.add(GFP("+CME ERROR:"));
+    CHECK(feed(m, "AT+CSQ\r\r\n+CSQ: 20,99\r\n\r\nOK\r\n") == 1);
+    m.reset();
+    CHECK(feed(m, "\r\nERROR\r\n") == 2);
+    m.reset();
+    CHECK(feed(m, "\r\n+CME ERROR:") == 4);
+    m.reset();
+    CHECK(feed(m, "\r\nOKAY\r\n") == 0);
+}
+
+// The lowest slot wins when two strings end on the same byte
+static void test_priority()
+{
+    TinyGsmMatcher<2> m;
+    m.add(GFP("LONG OK"));
+    m.add(GFP("OK"));
+    CHECK(feed(m, "SO OK") == 2);
+    m.reset();
+    CHECK(feed(m, "LONG OK") == 1);
+}
+
+// The failure table keeps overlapping occurrences: "aaa" in "aaaaa" ends
+// three times, "abab" in "abababab" three times
+static void test_overlap()
+{
+    TinyGsmMatcher<1> a;
+    a.add(GFP("aaa"));
+    int hits = 0;
+    feed(a, "aaaaa", &hits);
+    CHECK(hits == 3);
+
+    TinyGsmMatcher<1> ab;
+    ab.add(GFP("abab"));
+    feed(ab, "abababab", &hits);
+    CHECK(hits == 3);
+
+    // A partial match that breaks falls back instead of starting over
+    TinyGsmMatcher<1> p;
+    p.add(GFP("+QIRD: "));
+    CHECK(feed(p, "++QIRD+QIRD: ") == 1);
+}
+
+static void test_empty()
+{
+    TinyGsmMatcher<2> m;
+    m.add(nullptr);
+    m.add(GFP(""));
+    // "" ends every input, the null slot none
+    CHECK(m.feed('x') == 2);
+    CHECK(m.feed('\n') == 2);
+}
+
+// Only the last TINY_GSM_MATCH_MAX characters of a longer string count
+static void test_long()
+{
+    std::string pattern(TINY_GSM_MATCH_MAX + 8, 'x');
+    for (size_t i = 0; i < pattern.size(); i++)
+        pattern[i] = (char)('a' + i % 26);
+    TinyGsmMatcher<1> m;
+    m.add(GFP(pattern.c_str()));
+    std::string tail = "noise" + pattern.substr(pattern.size() - TINY_GSM_MATCH_MAX);
+    CHECK(feed(m, tail.c_str()) == 1);
+    m.reset();
+    CHECK(feed(m, pattern.c_str()) == 1);
+}
+
+static void test_reset()
+{
+    TinyGsmMatcher<1> m;
+    m.add(GFP("OK\r\n"));
+    feed(m, "OK\r");
+    m.reset();
+    CHECK(m.feed('\n') == 0);
+    CHECK(feed(m, "OK\r\n") == 1);
+}
+
+int main()
+{
+    test_slots();
+    test_priority();
+    test_overlap();
+    test_empty();
+    test_long();
+    test_reset();
+    return check_result("matcher_test");
+}
@@ -0,0 +1,71 @@
+# Image tools round trip, run by ctest:
+#   cmake -DOTA_TOOL=<path to ota_tool> -DWORK_DIR=<scratch dir> -P ota_tool_roundtrip.cmake
+#
+# Builds an old and a new image that share most of their bytes, then
+# checks that the delta patch rebuilds the new one (apply and verify) and
+# that heatshrink and deflate both decompress to what went in.
+
+if(NOT OTA_TOOL OR NOT WORK_DIR)
+    message(FATAL_ERROR "OTA_TOOL and WORK_DIR must be set")
+endif()
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# About 100 kB of records, as firmware sections look to the tools: the
+# same layout over and over, different values
+set(old "")
+set(value 12345)
+foreach(i RANGE 2999)
+    math(EXPR value "(${value} * 1103 + 12345) % 65536")
+    string(APPEND old "record ${i} value ${value} flags 0x${i}\n")
+endforeach()
+# The new image changes a few values, inserts a block and drops another
+string(REPLACE "value 1" "value 9" new "${old}")
+string(REPLACE "record 1500 " "record 1500 inserted in the new build " new "${new}")
+string(REPLACE "record 2500 " "" new "${new}")
+file(WRITE ${WORK_DIR}/old.bin "${old}")
+file(WRITE ${WORK_DIR}/new.bin "${new}")
+
+function(run)
+    execute_process(COMMAND ${OTA_TOOL} ${ARGN} RESULT_VARIABLE result WORKING_DIRECTORY ${WORK_DIR})
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "ota_tool ${ARGN} failed: ${result}")
+    endif()
+endfunction()
+
+function(expect_same a b)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK_DIR}/${a} ${WORK_DIR}/${b} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${a} differs from ${b}")
+    endif()
+endfunction()
+
+run(diff old.bin new.bin delta.patch)
+run(verify old.bin new.bin delta.patch)
+run(apply old.bin delta.patch rebuilt.bin)
+expect_same(rebuilt.bin new.bin)
+file(SIZE ${WORK_DIR}/delta.patch patch_size)
+file(SIZE ${WORK_DIR}/new.bin new_size)
+if(NOT patch_size LESS new_size)
+    message(FATAL_ERROR "delta.patch (${patch_size} bytes) is no smaller than new.bin (${new_size} bytes)")
+endif()
+
+# A patch for another base must not verify
+run(diff new.bin old.bin reverse.patch)
+execute_process(COMMAND ${OTA_TOOL} verify old.bin new.bin reverse.patch
+                RESULT_VARIABLE result OUTPUT_QUIET ERROR_QUIET WORKING_DIRECTORY ${WORK_DIR})
+if(result EQUAL 0)
+    message(FATAL_ERROR "verify accepted a patch made for another image")
+endif()
+
+run(compress heatshrink new.bin new.hs)
+run(decompress new.hs new.hs.out)
+expect_same(new.hs.out new.bin)
+
+run(compress heatshrink delta.patch delta.hs 8 4)
+run(decompress delta.hs delta.hs.out)
+expect_same(delta.hs.out delta.patch)
+
+run(compress deflate new.bin new.z)
+run(decompress new.z new.z.out)
+expect_same(new.z.out new.bin)
@@ -0,0 +1,95 @@
+// TinyGsmResponseBuffer, the fixed-size stand-in for String in
+// waitResponse(): dropping the older half when full, and the part of
+// String's interface the URC handlers use.
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target response_test
+// Run:    ctest --test-dir build/tools -R response
+
+#include <TinyGsmResponse.h>
+
+#include "check.h"
+
+static void test_drop_half()
+{
+    TinyGsmResponseBuffer<8> b;
+    const char *in = "0123456789AB";
+    for (const char *p = in; *p; p++)
+        b += *p;
+    // Full at "01234567"; '8' dropped "0123", 'C' would drop the next half
+    CHECK_STR(b.c_str(), "456789AB");
+    CHECK(b.droppedBytes() == 4);
+    b += 'C';
+    CHECK_STR(b.c_str(), "89ABC");
+    CHECK(b.droppedBytes() == 8);
+    CHECK(b.length() == 5);
+
+    // clear() keeps the count, which is for the whole run
+    b.clear();
+    CHECK(b.length() == 0);
+    CHECK_STR(b.c_str(), "");
+    CHECK(b.droppedBytes() == 8);
+}
+
+static void test_assign()
+{
+    TinyGsmResponseBuffer<16> b;
+    b = "+CSQ: 20,99";
+    CHECK_STR(b.c_str(), "+CSQ: 20,99");
+    b += String("\r\n");
+    CHECK(b.length() == 13);
+    b = "";
+    CHECK(b.length() == 0);
+    b = nullptr;
+    CHECK(b.length() == 0);
+}
+
+static void test_ends_with()
+{
+    TinyGsmResponseBuffer<32> b;
+    b = "\r\nOK\r\n";
+    CHECK(b.endsWith(GFP("OK\r\n")));
+    CHECK(b.endsWith(GFP("")));
+    CHECK(!b.endsWith(GFP("ERROR\r\n")));
+    CHECK(!b.endsWith(GFP("longer than the whole reply\r\nOK\r\n")));
+}
+
+static void test_trim()
+{
+    TinyGsmResponseBuffer<32> b;
+    b = " \r\n+QIURC: \"closed\",0\r\n";
+    b.trim();
+    CHECK_STR(b.c_str(), "+QIURC: \"closed\",0");
+    b = " \t\r\n";
+    b.trim();
+    CHECK(b.length() == 0);
+}
+
+static void test_replace()
+{
+    TinyGsmResponseBuffer<16> b;
+    b = "a\nb\nc";
+    b.replace("\n", "\r\n");
+    CHECK_STR(b.c_str(), "a\r\nb\r\nc");
+    b.replace("\r", "");
+    CHECK_STR(b.c_str(), "a\nb\nc");
+    // Multi-character `from` is not supported and leaves the text alone
+    b.replace("\nb", "x");
+    CHECK_STR(b.c_str(), "a\nb\nc");
+
+    // Expansion stops at the capacity instead of dropping the front
+    TinyGsmResponseBuffer<8> small;
+    small = "aaaa";
+    small.replace("a", "bbb");
+    CHECK_STR(small.c_str(), "bbbbbbbb");
+    CHECK(small.droppedBytes() == 0);
+}
+
+int main()
+{
+    test_drop_half();
+    test_assign();
+    test_ends_with();
+    test_trim();
+    test_replace();
+    return check_result("response_test");
+}
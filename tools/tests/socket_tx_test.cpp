@@ -0,0 +1,146 @@
+// The socket send buffer (TINY_GSM_TX_BUFFER) against a scripted modem:
+// gathered writes going out as one +QISEND, and a send the modem refuses
+// closing the socket at once for connected(), available(), read() and
+// write() until stop().
+//
+// Build:  cmake -S tools -B build/tools && cmake --build build/tools --target socket_tx_test
+// Run:    ctest --test-dir build/tools -R socket_tx
+
+#define TINY_GSM_MODEM_EC200U
+#define TINY_GSM_RX_BUFFER 1024
+#define TINY_GSM_TX_BUFFER 512 // as in src/main.cpp
+#define TINY_GSM_URC_NOTIFY    // as in src/main.cpp
+
+#include <TinyGsmClient.h>
+
+#include <string>
+#include <vector>
+
+#include "../host/mock_stream.h"
+#include "check.h"
+
+// One buffer-mode socket. +QISEND takes its payload and answers SEND OK,
+// or SEND FAIL while `refuse` is set; every other command just gets OK.
+struct SocketModem
+{
+    SocketModem() : modem(stream), refuse(false)
+    {
+        stream.onLine([this](MockModemStream &s, const std::string &line) {
+            sent.push_back(line);
+            unsigned mux, len;
+            if (sscanf(line.c_str(), "AT+QISEND=%u,%u", &mux, &len) == 2)
+            {
+                s.feed("> ");
+                s.expectRaw(len);
+            }
+            else if (line.compare(0, 10, "AT+QIOPEN=") == 0)
+                s.feed("\r\nOK\r\n\r\n+QIOPEN: 0,0\r\n");
+            else if (line == "AT+QIRD=0,0")
+                s.feed("\r\n+QIRD: 0,0,0\r\n\r\nOK\r\n");
+            else
+                s.feed("\r\nOK\r\n");
+        });
+        stream.onRaw([this](MockModemStream &s, const std::string &data) {
+            payloads.push_back(data);
+            s.feed(refuse ? "\r\nSEND FAIL\r\n" : "\r\nSEND OK\r\n");
+        });
+    }
+
+    size_t sends() const
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < sent.size(); i++)
+            n += sent[i].compare(0, 10, "AT+QISEND=") == 0;
+        return n;
+    }
+
+    MockModemStream stream;
+    TinyGsm modem;
+    bool refuse;
+    std::vector<std::string> sent;
+    std::vector<std::string> payloads;
+};
+
+// Small writes gather until the next read, then go as one +QISEND
+static void test_gather()
+{
+    SocketModem m;
+    TinyGsmClient client(m.modem);
+    CHECK(client.connect("example.com", 80));
+    CHECK(client.write((const uint8_t *)"GET / ", 6) == 6);
+    CHECK(client.write((const uint8_t *)"HTTP/1.0\r\n\r\n", 12) == 12);
+    CHECK(m.sends() == 0);
+    CHECK(client.available() == 0);
+    CHECK(m.sends() == 1);
+    CHECK(m.payloads.size() == 1 && m.payloads[0] == "GET / HTTP/1.0\r\n\r\n");
+    CHECK(client.connected());
+    client.stop();
+}
+
+// A refused flush ends the socket without waiting for any timeout, and
+// stop() plus a new connect() make it usable again
+static void test_refused_flush()
+{
+    SocketModem m;
+    TinyGsmClient client(m.modem);
+    CHECK(client.connect("example.com", 80));
+    CHECK(client.write((const uint8_t *)"GET / HTTP/1.0\r\n\r\n", 18) == 18);
+    m.refuse = true;
+    uint32_t start = millis();
+    CHECK(client.available() == 0);
+    CHECK(!client.connected());
+    uint8_t buf[16];
+    CHECK(client.read(buf, sizeof(buf)) == -1);
+    CHECK(client.read() == -1);
+    CHECK(client.write((const uint8_t *)"x", 1) == 0);
+    CHECK(millis() - start < 100);
+    CHECK(m.sends() == 1); // nothing after the refused send went out
+
+    client.stop();
+    m.refuse = false;
+    CHECK(client.connect("example.com", 80));
+    CHECK(client.write((const uint8_t *)"x", 1) == 1);
+    CHECK(client.available() == 0);
+    CHECK(client.connected());
+    CHECK(m.sends() == 2);
+    client.stop();
+}
+
+// A write that fills the buffer reports only what the modem took
+static void test_refused_full_buffer()
+{
+    SocketModem m;
+    TinyGsmClient client(m.modem);
+    CHECK(client.connect("example.com", 80));
+    uint8_t data[600];
+    memset(data, 'a', sizeof(data));
+    CHECK(client.write(data, 100) == 100);
+    m.refuse = true;
+    CHECK(client.write(data, 500) == 0);
+    CHECK(!client.connected());
+    client.stop();
+}
+
+// The same for a write large enough to bypass the buffer
+static void test_refused_direct()
+{
+    SocketModem m;
+    TinyGsmClient client(m.modem);
+    CHECK(client.connect("example.com", 80));
+    uint8_t data[600];
+    memset(data, 'a', sizeof(data));
+    m.refuse = true;
+    CHECK(client.write(data, sizeof(data)) == 0);
+    CHECK(!client.connected());
+    CHECK(client.available() == 0);
+    client.stop();
+}
+
+int main()
+{
+    test_gather();
+    test_refused_flush();
+    test_refused_full_buffer();
+    test_refused_direct();
+    return check_result("socket_tx_test");
+}